@@ -0,0 +1,211 @@
+/*
+ * Copyright (C) 2014. See COPYRIGHT in top-level directory.
+ */
+
+#include <dalec.h>
+#include <dalec_guts.h>
+#include <debug.h>
+
+/** Check that a patch lies within the block owned by the caller.  For a
+  * block-cyclic array that means within one of the blocks of the caller
+  * along each dimension, unless the grid has a single coordinate there.
+  *
+  * @return            Zero on success
+  */
+static int DALECI_Check_local_patch(const DALEC_Array_handle * h, const size_t lo[], const size_t hi[])
+{
+    if (h==NULL || lo==NULL || hi==NULL) {
+        DALECI_Error("h (%p), lo (%p) or hi (%p) is a null pointer", h, lo, hi);
+        return DALEC_INPUT_ERROR;
+    }
+    for (int i=0; i<h->ndim; i++) {
+        if (lo[i] > hi[i] || hi[i] >= h->dims[i] || h->local_dims[i] == 0 ||
+            DALECI_Block_coord(h, i, lo[i]) != h->coords[i] || DALECI_Block_coord(h, i, hi[i]) != h->coords[i] ||
+            DALECI_Local_index(h, i, hi[i]) - DALECI_Local_index(h, i, lo[i]) != hi[i] - lo[i]) {
+            DALECI_Error("patch [%zu,%zu] is not within the local block in dimension %d", lo[i], hi[i], i);
+            return DALEC_INPUT_ERROR;
+        }
+    }
+    return DALEC_SUCCESS;
+}
+
+/** Synchronize the public and private copies of the local block.
+  *
+  * @return            Zero on success
+  */
+static int DALECI_Local_sync(const DALEC_Array_handle * h)
+{
+    int rc; /* MPI return code */
+
+    rc = MPI_Win_sync(h->win);
+    DALECI_Check_MPI(__func__, "MPI_Win_sync", rc);
+
+    if (h->shm != NULL && h->shm->win != h->win) {
+        rc = MPI_Win_sync(h->shm->win);
+        DALECI_Check_MPI(__func__, "MPI_Win_sync", rc);
+    }
+
+    return DALEC_SUCCESS;
+}
+
+/** Prepare the whole local block for load/store access.  Updates by other
+  * processes that completed before the call become visible.  Local.
+  *
+  * @param[in]  h      Array handle
+  * @param[out] ptr    Address of the first element of the local block
+  * @param[out] ld     Extents of dimensions 1..ndim-1 of the local block, ghosts included
+  * @return            Zero on success
+  */
+int DALECI_Access_block(const DALEC_Array_handle * h, void ** ptr, size_t ld[])
+{
+    int rc;
+
+    /* our own queued and in-flight updates must land first */
+    int me;
+    MPI_Comm_rank(h->comm, &me);
+    if (h->aggregate != NULL) {
+        rc = DALECI_Aggregate_flush_target(h, me);
+        if (rc != DALEC_SUCCESS) return rc;
+    }
+    rc = DALECI_Dirty_flush_target(h, me);
+    if (rc != DALEC_SUCCESS) return rc;
+
+    rc = DALECI_Local_sync(h);
+    if (rc != DALEC_SUCCESS) return rc;
+
+    int type_size = 0;
+    MPI_Type_size(h->type, &type_size);
+
+    size_t offset = 0;
+    for (int i=0; i<h->ndim; i++) {
+        offset = offset * (h->local_dims[i] + 2*h->ghosts[i]) + h->ghosts[i];
+        if (i>0) ld[i-1] = h->local_dims[i] + 2*h->ghosts[i];
+    }
+    *ptr = (char*)h->base + offset * type_size;
+
+    return DALEC_SUCCESS;
+}
+
+/** End load/store access to the local block, making stores visible if
+  * update is nonzero.  Local.
+  *
+  * @return            Zero on success
+  */
+int DALECI_Release_block(const DALEC_Array_handle * h, int update)
+{
+    return update ? DALECI_Local_sync(h) : DALEC_SUCCESS;
+}
+
+/* -- begin weak symbols block -- */
+#if defined(HAVE_PRAGMA_WEAK)
+#  pragma weak DALEC_Access = PDALEC_Access
+#elif defined(HAVE_PRAGMA_HP_SEC_DEF)
+#  pragma _HP_SECONDARY_DEF PDALEC_Access DALEC_Access
+#elif defined(HAVE_PRAGMA_CRI_DUP)
+#  pragma _CRI duplicate DALEC_Access as PDALEC_Access
+#elif defined(HAVE_WEAK_ATTRIBUTE)
+int DALEC_Access(const DALEC_Array_handle * h, const size_t lo[], const size_t hi[], void ** ptr, size_t ld[])
+    __attribute__ ((weak, alias("PDALEC_Access")));
+#else
+#define DALEC_Access PDALEC_Access
+#endif
+/* -- end weak symbols block -- */
+
+/** Get direct access to a patch of the block owned by the caller.  The
+  * patch is not copied: ptr points into the memory of the array and ld
+  * describes its row-major layout.  Updates by other processes that completed
+  * before the call are visible through ptr.  The ghost cells, if any,
+  * surround the local block in the same layout.  In a block-cyclic array,
+  * the blocks of the caller follow each other in memory, and ld spans all
+  * of them, as ScaLAPACK's local matrix.  Local.
+  *
+  * @param[in]  h      Array handle
+  * @param[in]  lo     Lowest global index of the patch in each dimension
+  * @param[in]  hi     Highest global index of the patch in each dimension (inclusive)
+  * @param[out] ptr    Address of element lo
+  * @param[out] ld     Extents of dimensions 1..ndim-1 of the local block, ghosts included
+  * @return            Zero on success
+  */
+int DALEC_Access(const DALEC_Array_handle * h, const size_t lo[], const size_t hi[], void ** ptr, size_t ld[])
+{
+    int rc = DALECI_Check_local_patch(h, lo, hi);
+    if (rc != DALEC_SUCCESS) return rc;
+
+    if (ptr == NULL || (ld == NULL && h->ndim > 1)) {
+        DALECI_Error("ptr (%p) or ld (%p) is a null pointer", ptr, ld);
+        return DALEC_INPUT_ERROR;
+    }
+
+    void * block;
+    rc = DALECI_Access_block(h, &block, ld);
+    if (rc != DALEC_SUCCESS) return rc;
+
+    int type_size = 0;
+    MPI_Type_size(h->type, &type_size);
+
+    size_t offset = 0;
+    for (int i=0; i<h->ndim; i++) {
+        offset = offset * (h->local_dims[i] + 2*h->ghosts[i]) + DALECI_Local_index(h, i, lo[i]);
+    }
+    *ptr = (char*)block + offset * type_size;
+
+    return DALEC_SUCCESS;
+}
+
+/* -- begin weak symbols block -- */
+#if defined(HAVE_PRAGMA_WEAK)
+#  pragma weak DALEC_Release = PDALEC_Release
+#elif defined(HAVE_PRAGMA_HP_SEC_DEF)
+#  pragma _HP_SECONDARY_DEF PDALEC_Release DALEC_Release
+#elif defined(HAVE_PRAGMA_CRI_DUP)
+#  pragma _CRI duplicate DALEC_Release as PDALEC_Release
+#elif defined(HAVE_WEAK_ATTRIBUTE)
+int DALEC_Release(const DALEC_Array_handle * h, const size_t lo[], const size_t hi[])
+    __attribute__ ((weak, alias("PDALEC_Release")));
+#else
+#define DALEC_Release PDALEC_Release
+#endif
+/* -- end weak symbols block -- */
+
+/** End direct access to a patch that was only read.  Local.
+  *
+  * @param[in] h       Array handle
+  * @param[in] lo      Lowest global index of the patch, as given to DALEC_Access
+  * @param[in] hi      Highest global index of the patch, as given to DALEC_Access
+  * @return            Zero on success
+  */
+int DALEC_Release(const DALEC_Array_handle * h, const size_t lo[], const size_t hi[])
+{
+    return DALECI_Check_local_patch(h, lo, hi);
+}
+
+/* -- begin weak symbols block -- */
+#if defined(HAVE_PRAGMA_WEAK)
+#  pragma weak DALEC_Release_update = PDALEC_Release_update
+#elif defined(HAVE_PRAGMA_HP_SEC_DEF)
+#  pragma _HP_SECONDARY_DEF PDALEC_Release_update DALEC_Release_update
+#elif defined(HAVE_PRAGMA_CRI_DUP)
+#  pragma _CRI duplicate DALEC_Release_update as PDALEC_Release_update
+#elif defined(HAVE_WEAK_ATTRIBUTE)
+int DALEC_Release_update(const DALEC_Array_handle * h, const size_t lo[], const size_t hi[])
+    __attribute__ ((weak, alias("PDALEC_Release_update")));
+#else
+#define DALEC_Release_update PDALEC_Release_update
+#endif
+/* -- end weak symbols block -- */
+
+/** End direct access to a patch that was modified, making the stores
+  * visible to RMA and to other processes on the node.  Local.
+  *
+  * @param[in] h       Array handle
+  * @param[in] lo      Lowest global index of the patch, as given to DALEC_Access
+  * @param[in] hi      Highest global index of the patch, as given to DALEC_Access
+  * @return            Zero on success
+  */
+int DALEC_Release_update(const DALEC_Array_handle * h, const size_t lo[], const size_t hi[])
+{
+    int rc = DALECI_Check_local_patch(h, lo, hi);
+    if (rc != DALEC_SUCCESS) return rc;
+
+    return DALECI_Release_block(h, 1);
+}
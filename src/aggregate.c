@@ -0,0 +1,490 @@
+/*
+ * Copyright (C) 2014. See COPYRIGHT in top-level directory.
+ */
+
+#include <dalec.h>
+#include <dalec_guts.h>
+#include <debug.h>
+
+/* Small puts and accumulates to an array with aggregation enabled are not
+ * issued immediately.  Instead, the runs of contiguous target elements they
+ * update are copied into a queue per owner.  A queue is pushed to its owner
+ * as a single RMA operation with an hindexed target datatype when it fills,
+ * when the oldest buffered operation is older than the age threshold, before
+ * any other operation on the same owner, and when the user flushes.  Runs are
+ * sorted and merged before pushing, so adjacent or overlapping updates of the
+ * same elements travel as one block. */
+
+#define DALECI_AGGREGATE_BUCKETS 256
+
+typedef struct DALECI_Aggregate_queue {
+    int        target;
+    int        op;       /* DALECI_OP_PUT or DALECI_OP_ACC, only one kind is queued at a time */
+    int        count;    /* number of runs */
+    int        maxcount;
+    MPI_Aint * disps;    /* target displacement of each run, in elements */
+    int      * lens;     /* length of each run, in elements */
+    char     * data;     /* payload of all runs, packed in order of arrival */
+    size_t     bytes;
+    double     oldest;   /* MPI_Wtime of the oldest run, or 0 if empty */
+    struct DALECI_Aggregate_queue * next;
+} DALECI_Aggregate_queue;
+
+struct DALECI_Aggregate_s {
+    size_t max_bytes;    /* queue capacity                                  */
+    size_t max_op;       /* largest payload per owner that is queued        */
+    double max_age;      /* seconds an operation may stay queued            */
+    double oldest;       /* oldest of the queues, or 0 if all are empty     */
+    int    type_size;
+    DALECI_Aggregate_queue * buckets[DALECI_AGGREGATE_BUCKETS];
+};
+
+static DALECI_Aggregate_queue * DALECI_Aggregate_find(struct DALECI_Aggregate_s * a, int target)
+{
+    DALECI_Aggregate_queue * q = a->buckets[target % DALECI_AGGREGATE_BUCKETS];
+    while (q != NULL && q->target != target) {
+        q = q->next;
+    }
+    return q;
+}
+
+/* Find the oldest queued operation again, after a queue was pushed. */
+static void DALECI_Aggregate_age(struct DALECI_Aggregate_s * a)
+{
+    a->oldest = 0.0;
+    for (int b=0; b<DALECI_AGGREGATE_BUCKETS; b++) {
+        for (DALECI_Aggregate_queue * q = a->buckets[b]; q != NULL; q = q->next) {
+            if (q->count > 0 && (a->oldest == 0.0 || q->oldest < a->oldest)) {
+                a->oldest = q->oldest;
+            }
+        }
+    }
+}
+
+/* qsort has no context argument, so the displacements being sorted are
+ * passed through a file-scope pointer. */
+static const MPI_Aint * DALECI_Aggregate_sort_disps = NULL;
+
+static int DALECI_Aggregate_cmp(const void * a, const void * b)
+{
+    const int i = *(const int *)a;
+    const int j = *(const int *)b;
+    const MPI_Aint di = DALECI_Aggregate_sort_disps[i];
+    const MPI_Aint dj = DALECI_Aggregate_sort_disps[j];
+    /* ties are broken by arrival to keep the order deterministic */
+    return (di < dj) ? -1 : (di > dj) ? 1 : (i - j);
+}
+
+/** Push the queue for one owner to the array and wait for it to complete.
+  *
+  * @return            Zero on success
+  */
+static int DALECI_Aggregate_push(const DALEC_Array_handle * h, DALECI_Aggregate_queue * q)
+{
+    int rc; /* MPI return code */
+
+    if (q->count == 0) {
+        return DALEC_SUCCESS;
+    }
+
+    const int type_size = h->aggregate->type_size;
+    const int count     = q->count;
+
+    /* sort runs by target displacement and merge those that touch */
+    int * order = malloc(count * sizeof(int));
+    MPI_Aint * mdisps = malloc(count * sizeof(MPI_Aint));
+    int * mlens = malloc(count * sizeof(int));
+    size_t * offsets = malloc(count * sizeof(size_t));
+    if (order == NULL || mdisps == NULL || mlens == NULL || offsets == NULL) {
+        DALECI_Error("malloc of aggregation metadata for %d runs failed", count);
+        return DALEC_INPUT_ERROR;
+    }
+    for (int j=0; j<count; j++) {
+        order[j] = j;
+    }
+    DALECI_Aggregate_sort_disps = q->disps;
+    qsort(order, count, sizeof(int), DALECI_Aggregate_cmp);
+
+    int mcount = 0;
+    size_t total = 0;
+    for (int j=0; j<count; j++) {
+        const MPI_Aint d   = q->disps[order[j]];
+        const MPI_Aint end = d + q->lens[order[j]];
+        if (mcount > 0 && d <= mdisps[mcount-1] + mlens[mcount-1]) {
+            const MPI_Aint mend = mdisps[mcount-1] + mlens[mcount-1];
+            if (end > mend) {
+                mlens[mcount-1] += (int)(end - mend);
+            }
+        } else {
+            mdisps[mcount] = d;
+            mlens[mcount]  = q->lens[order[j]];
+            mcount++;
+        }
+    }
+    for (int j=0; j<mcount; j++) {
+        offsets[j] = total;
+        total += mlens[j];
+    }
+
+    /* replay the runs in order of arrival into the merged layout */
+    char * staging = NULL;
+    if (mcount == count && total * type_size == q->bytes) {
+        int sorted = 1;
+        for (int j=0; j<count; j++) {
+            sorted &= (order[j] == j);
+        }
+        if (sorted) staging = q->data;
+    }
+    if (staging == NULL) {
+        staging = (q->op == DALECI_OP_ACC) ? calloc(total, type_size) : malloc(total * type_size);
+        if (staging == NULL) {
+            DALECI_Error("malloc of %zu aggregation bytes failed", total * type_size);
+            return DALEC_INPUT_ERROR;
+        }
+        size_t pos = 0;
+        for (int j=0; j<count; j++) {
+            /* find the merged run that contains this run */
+            int lo = 0, hi = mcount-1;
+            while (lo < hi) {
+                const int mid = lo + (hi-lo+1)/2;
+                if (mdisps[mid] <= q->disps[j]) {
+                    lo = mid;
+                } else {
+                    hi = mid-1;
+                }
+            }
+            char * dst = staging + (offsets[lo] + (q->disps[j] - mdisps[lo])) * type_size;
+            if (q->op == DALECI_OP_ACC) {
+                rc = MPI_Reduce_local(q->data + pos, dst, q->lens[j], h->type, MPI_SUM);
+                DALECI_Check_MPI(__func__, "MPI_Reduce_local", rc);
+            } else {
+                memcpy(dst, q->data + pos, (size_t)q->lens[j] * type_size);
+            }
+            pos += (size_t)q->lens[j] * type_size;
+        }
+    }
+
+    DALECI_Dbg_print(DEBUG_CAT_RMA, "target = %d runs = %d merged = %d elements = %zu\n", q->target, count, mcount, total);
+
+    MPI_Aint tdisp = DALECI_Target_disp(h, q->target, 0);
+    MPI_Datatype ttype = h->type;
+    int tcount = (int)total;
+    if (mcount > 1) {
+        for (int j=0; j<mcount; j++) {
+            mdisps[j] *= type_size;
+        }
+        rc = MPI_Type_create_hindexed(mcount, mlens, mdisps, h->type, &ttype);
+        DALECI_Check_MPI(__func__, "MPI_Type_create_hindexed", rc);
+        rc = MPI_Type_commit(&ttype);
+        DALECI_Check_MPI(__func__, "MPI_Type_commit", rc);
+        tcount = 1;
+    } else {
+        tdisp = DALECI_Target_disp(h, q->target, mdisps[0]);
+    }
+
+    rc = DALECI_Dirty_order(h, q->target, q->op);
+    if (rc != DALEC_SUCCESS) return rc;
+
+    if (q->op == DALECI_OP_ACC) {
+        rc = MPI_Accumulate(staging, (int)total, h->type, q->target, tdisp, tcount, ttype, MPI_SUM, h->win);
+        DALECI_Check_MPI(__func__, "MPI_Accumulate", rc);
+    } else {
+        rc = MPI_Put(staging, (int)total, h->type, q->target, tdisp, tcount, ttype, h->win);
+        DALECI_Check_MPI(__func__, "MPI_Put", rc);
+    }
+    rc = MPI_Win_flush_local(q->target, h->win);
+    DALECI_Check_MPI(__func__, "MPI_Win_flush_local", rc);
+    DALECI_Dirty_mark(h, q->target, q->op);
+
+    if (mcount > 1) {
+        MPI_Type_free(&ttype);
+    }
+    if (staging != q->data) {
+        free(staging);
+    }
+    free(offsets);
+    free(mlens);
+    free(mdisps);
+    free(order);
+
+    q->count  = 0;
+    q->bytes  = 0;
+    q->oldest = 0.0;
+
+    return DALEC_SUCCESS;
+}
+
+/** Push whatever is queued for one owner.  Called before any operation that
+  * is not aggregated so that the order of operations to an owner is kept.
+  *
+  * @return            Zero on success
+  */
+int DALECI_Aggregate_flush_target(const DALEC_Array_handle * h, int target)
+{
+    DALECI_Aggregate_queue * q = DALECI_Aggregate_find(h->aggregate, target);
+    if (q == NULL || q->count == 0) {
+        return DALEC_SUCCESS;
+    }
+    int rc = DALECI_Aggregate_push(h, q);
+    DALECI_Aggregate_age(h->aggregate);
+    return rc;
+}
+
+/** Push the queues of all owners.
+  *
+  * @return            Zero on success
+  */
+int DALECI_Aggregate_flush_all(const DALEC_Array_handle * h)
+{
+    for (int b=0; b<DALECI_AGGREGATE_BUCKETS; b++) {
+        for (DALECI_Aggregate_queue * q = h->aggregate->buckets[b]; q != NULL; q = q->next) {
+            int rc = DALECI_Aggregate_push(h, q);
+            if (rc != DALEC_SUCCESS) return rc;
+        }
+    }
+    h->aggregate->oldest = 0.0;
+    return DALEC_SUCCESS;
+}
+
+/** Whether a put or accumulate of the given number of elements to one owner
+  * should be queued.
+  */
+int DALECI_Aggregate_eligible(const DALEC_Array_handle * h, size_t elements)
+{
+    return (elements * h->aggregate->type_size <= h->aggregate->max_op);
+}
+
+/** Queue a put or accumulate of a subarray to one owner.  The subarray is
+  * described as for MPI_Type_create_subarray on both sides.
+  *
+  * @return            Zero on success
+  */
+int DALECI_Aggregate_enqueue(const DALEC_Array_handle * h, enum DALECI_Op_e op, int target, const void * buf,
+                             const int osizes[], const int ostarts[],
+                             const int tsizes[], const int tstarts[], const int subsizes[])
+{
+    struct DALECI_Aggregate_s * a = h->aggregate;
+    const int ndim = h->ndim;
+    const int type_size = a->type_size;
+
+    DALECI_Aggregate_queue * q = DALECI_Aggregate_find(a, target);
+    if (q == NULL) {
+        q = calloc(1, sizeof(DALECI_Aggregate_queue));
+        if (q == NULL || (q->data = malloc(a->max_bytes + a->max_op)) == NULL) {
+            DALECI_Error("allocation of an aggregation queue failed");
+            return DALEC_INPUT_ERROR;
+        }
+        q->target = target;
+        q->next = a->buckets[target % DALECI_AGGREGATE_BUCKETS];
+        a->buckets[target % DALECI_AGGREGATE_BUCKETS] = q;
+    }
+
+    /* puts and accumulates to the same elements must not be reordered */
+    const int switched = (q->count > 0 && q->op != (int)op);
+    if (switched) {
+        int rc = DALECI_Aggregate_push(h, q);
+        if (rc != DALEC_SUCCESS) return rc;
+    }
+    q->op = op;
+
+    /* one run per row of the subarray */
+    const int rowlen = subsizes[ndim-1];
+    int nrows = 1;
+    for (int i=0; i<ndim-1; i++) {
+        nrows *= subsizes[i];
+    }
+    if (q->count + nrows > q->maxcount) {
+        int maxcount = (q->maxcount > 0) ? 2*q->maxcount : 64;
+        while (maxcount < q->count + nrows) maxcount *= 2;
+        q->disps = realloc(q->disps, maxcount * sizeof(MPI_Aint));
+        q->lens  = realloc(q->lens, maxcount * sizeof(int));
+        if (q->disps == NULL || q->lens == NULL) {
+            DALECI_Error("realloc of %d aggregation runs failed", maxcount);
+            return DALEC_INPUT_ERROR;
+        }
+        q->maxcount = maxcount;
+    }
+
+    int idx[DALEC_ARRAY_MAX_DIM] = {0};
+    for (int r=0; r<nrows; r++) {
+        MPI_Aint tdisp = 0, odisp = 0;
+        for (int i=0; i<ndim; i++) {
+            tdisp = tdisp * tsizes[i] + tstarts[i] + idx[i];
+            odisp = odisp * osizes[i] + ostarts[i] + idx[i];
+        }
+        q->disps[q->count] = tdisp;
+        q->lens[q->count]  = rowlen;
+        q->count++;
+        memcpy(q->data + q->bytes, (const char *)buf + odisp * type_size, (size_t)rowlen * type_size);
+        q->bytes += (size_t)rowlen * type_size;
+
+        for (int i=ndim-2; i>=0; i--) {
+            if (++idx[i] < subsizes[i]) break;
+            idx[i] = 0;
+        }
+    }
+
+    /* the age of the other queues counts only while they hold operations */
+    const double now = MPI_Wtime();
+    if (q->oldest == 0.0) {
+        q->oldest = now;
+    }
+    if (switched) {
+        DALECI_Aggregate_age(a);
+    } else if (a->oldest == 0.0) {
+        a->oldest = now;
+    }
+    if (now - a->oldest > a->max_age) {
+        return DALECI_Aggregate_flush_all(h);
+    }
+    if (q->bytes >= a->max_bytes) {
+        int rc = DALECI_Aggregate_push(h, q);
+        DALECI_Aggregate_age(a);
+        return rc;
+    }
+    return DALEC_SUCCESS;
+}
+
+/* -- begin weak symbols block -- */
+#if defined(HAVE_PRAGMA_WEAK)
+#  pragma weak DALEC_Aggregate_begin = PDALEC_Aggregate_begin
+#elif defined(HAVE_PRAGMA_HP_SEC_DEF)
+#  pragma _HP_SECONDARY_DEF PDALEC_Aggregate_begin DALEC_Aggregate_begin
+#elif defined(HAVE_PRAGMA_CRI_DUP)
+#  pragma _CRI duplicate DALEC_Aggregate_begin as PDALEC_Aggregate_begin
+#elif defined(HAVE_WEAK_ATTRIBUTE)
+int DALEC_Aggregate_begin(DALEC_Array_handle * h) __attribute__ ((weak, alias("PDALEC_Aggregate_begin")));
+#else
+#define DALEC_Aggregate_begin PDALEC_Aggregate_begin
+#endif
+/* -- end weak symbols block -- */
+
+#undef FUNCNAME
+#define FUNCNAME DALEC_Aggregate_begin
+#undef FNAME
+#define FCNAME DALECI_QUOTE_STRING(FUNCNAME)
+
+/** Start aggregating small puts and accumulates to an array.  Until the
+  * next DALEC_Aggregate_flush or DALEC_Aggregate_end, such updates are
+  * complete locally on return but are not guaranteed to be visible at the
+  * owner.  Local.
+  *
+  * The thresholds are read from the environment:
+  *   DALEC_AGGREGATE_BYTES  queue capacity per owner (default 64 KiB)
+  *   DALEC_AGGREGATE_MAX_OP largest update per owner that is queued (default 512 bytes)
+  *   DALEC_AGGREGATE_USEC   longest time an update stays queued (default 1000 us)
+  *
+  * @return            Zero on success
+  */
+int DALEC_Aggregate_begin(DALEC_Array_handle * h)
+{
+    int rc; /* MPI return code */
+
+    if (h == NULL) {
+        DALECI_Error("h is a null pointer");
+        return DALEC_INPUT_ERROR;
+    }
+    if (h->aggregate != NULL) {
+        return DALEC_SUCCESS;
+    }
+
+    struct DALECI_Aggregate_s * a = calloc(1, sizeof(struct DALECI_Aggregate_s));
+    if (a == NULL) {
+        DALECI_Error("calloc of aggregation state failed");
+        return DALEC_INPUT_ERROR;
+    }
+
+    rc = MPI_Type_size(h->type, &(a->type_size));
+    DALECI_Check_MPI(FCNAME, "MPI_Type_size", rc);
+
+    a->max_bytes = DALECI_Getenv_int("DALEC_AGGREGATE_BYTES", 65536);
+    a->max_op    = DALECI_Getenv_int("DALEC_AGGREGATE_MAX_OP", 512);
+    a->max_age   = 1.e-6 * DALECI_Getenv_int("DALEC_AGGREGATE_USEC", 1000);
+    a->oldest    = 0.0;
+
+    h->aggregate = a;
+
+    return DALEC_SUCCESS;
+}
+
+/* -- begin weak symbols block -- */
+#if defined(HAVE_PRAGMA_WEAK)
+#  pragma weak DALEC_Aggregate_flush = PDALEC_Aggregate_flush
+#elif defined(HAVE_PRAGMA_HP_SEC_DEF)
+#  pragma _HP_SECONDARY_DEF PDALEC_Aggregate_flush DALEC_Aggregate_flush
+#elif defined(HAVE_PRAGMA_CRI_DUP)
+#  pragma _CRI duplicate DALEC_Aggregate_flush as PDALEC_Aggregate_flush
+#elif defined(HAVE_WEAK_ATTRIBUTE)
+int DALEC_Aggregate_flush(DALEC_Array_handle * h) __attribute__ ((weak, alias("PDALEC_Aggregate_flush")));
+#else
+#define DALEC_Aggregate_flush PDALEC_Aggregate_flush
+#endif
+/* -- end weak symbols block -- */
+
+/** Push all queued updates of an array to their owners.  On return they are
+  * visible at the owners.  Local.
+  *
+  * @return            Zero on success
+  */
+int DALEC_Aggregate_flush(DALEC_Array_handle * h)
+{
+    if (h == NULL) {
+        DALECI_Error("h is a null pointer");
+        return DALEC_INPUT_ERROR;
+    }
+    if (h->aggregate != NULL) {
+        int rc = DALECI_Aggregate_flush_all(h);
+        if (rc != DALEC_SUCCESS) return rc;
+    }
+    return DALECI_Dirty_flush_all(h);
+}
+
+/* -- begin weak symbols block -- */
+#if defined(HAVE_PRAGMA_WEAK)
+#  pragma weak DALEC_Aggregate_end = PDALEC_Aggregate_end
+#elif defined(HAVE_PRAGMA_HP_SEC_DEF)
+#  pragma _HP_SECONDARY_DEF PDALEC_Aggregate_end DALEC_Aggregate_end
+#elif defined(HAVE_PRAGMA_CRI_DUP)
+#  pragma _CRI duplicate DALEC_Aggregate_end as PDALEC_Aggregate_end
+#elif defined(HAVE_WEAK_ATTRIBUTE)
+int DALEC_Aggregate_end(DALEC_Array_handle * h) __attribute__ ((weak, alias("PDALEC_Aggregate_end")));
+#else
+#define DALEC_Aggregate_end PDALEC_Aggregate_end
+#endif
+/* -- end weak symbols block -- */
+
+/** Push all queued updates of an array and stop aggregating.  Local.
+  *
+  * @return            Zero on success
+  */
+int DALEC_Aggregate_end(DALEC_Array_handle * h)
+{
+    if (h == NULL) {
+        DALECI_Error("h is a null pointer");
+        return DALEC_INPUT_ERROR;
+    }
+    if (h->aggregate == NULL) {
+        return DALEC_SUCCESS;
+    }
+
+    int rc = DALECI_Aggregate_flush_all(h);
+    if (rc != DALEC_SUCCESS) return rc;
+    rc = DALECI_Dirty_flush_all(h);
+    if (rc != DALEC_SUCCESS) return rc;
+
+    for (int b=0; b<DALECI_AGGREGATE_BUCKETS; b++) {
+        DALECI_Aggregate_queue * q = h->aggregate->buckets[b];
+        while (q != NULL) {
+            DALECI_Aggregate_queue * next = q->next;
+            free(q->disps);
+            free(q->lens);
+            free(q->data);
+            free(q);
+            q = next;
+        }
+    }
+    free(h->aggregate);
+    h->aggregate = NULL;
+
+    return DALEC_SUCCESS;
+}
@@ -25,20 +25,29 @@ int DALEC_Create_array(const DALEC_Array_descriptor * d, DALEC_Array_handle * h)
 #undef FNAME
 #define FCNAME DALECI_QUOTE_STRING(FUNCNAME)
 
-/** 
+/* Every argument that must agree across ranks is reduced with its negation
+ * under MPI_MAX, so that one reduction finds both the largest and the
+ * smallest value. */
+#define DALECI_ARGS_COUNT (14+10*DALEC_ARRAY_MAX_DIM)
+
+/* An irregular array appends nblock and its block boundaries.  There are
+ * no more blocks than ranks, so there are at most np+ndim-1 boundaries. */
+#define DALECI_IRREG_COUNT(np) (2*DALEC_ARRAY_MAX_DIM + 2*((np)+DALEC_ARRAY_MAX_DIM))
+
+/* the slots of the arrays in a shared window start on cache lines */
+#define DALECI_SLOT_ALIGN 64
+
+/** Check the arguments of an array on this rank and encode those that must
+  * agree across ranks in args, followed by the DALECI_IRREG_COUNT slots of
+  * nblock and map if map is not NULL.  Local.
   *
   * @return            Zero on success
   */
-int DALEC_Create_array(const DALEC_Array_descriptor * d, DALEC_Array_handle * h)
+static int DALECI_Array_check(const DALEC_Array_descriptor * d, const int nblock[], const size_t map[],
+                              int64_t args[])
 {
     int rc; /* MPI return code */
 
-    /* check for really stupid inputs */
-    if (d==NULL || h==NULL) {
-        DALECI_Error("d (%p) or h (%p) is a null pointer", d, h);
-        return DALEC_INPUT_ERROR;
-    }
-
     const int ndim = d->ndim;
     const MPI_Comm comm = d->comm;
 
@@ -56,9 +65,9 @@ int DALEC_Create_array(const DALEC_Array_descriptor * d, DALEC_Array_handle * h)
 
         DALECI_Dbg_print(DEBUG_CAT_ARGS, "ndim = %d\n", ndim);
 
-        const size_t * ptrs[2] = {d->dims, d->blks};
-        const char   * name[2] = {"dims", "blks"};
-        for (int j=0; j<2; j++) {
+        const size_t * ptrs[3] = {d->dims, d->blks, d->ghosts};
+        const char   * name[3] = {"dims", "blks", "ghosts"};
+        for (int j=0; j<3; j++) {
             int total = 0;
             char buf[DALEC_ARRAY_MAX_DIM * 16] = {0};
             total += snprintf(&buf[total], sizeof(buf), "{");
@@ -96,135 +105,650 @@ int DALEC_Create_array(const DALEC_Array_descriptor * d, DALEC_Array_handle * h)
                 DALECI_Error("blks[%d] (%zu) > dims[%d] (%zu)", i, blk, i, dim);
                 return DALEC_INPUT_ERROR;
             }
+            if (d->ghosts[i] > dim) {
+                DALECI_Error("ghosts[%d] (%zu) > dims[%d] (%zu)", i, d->ghosts[i], i, dim);
+                return DALEC_INPUT_ERROR;
+            }
+            if (d->cyclic && d->ghosts[i] > 0) {
+                DALECI_Error("block-cyclic arrays have no ghost cells (ghosts[%d] = %zu)", i, d->ghosts[i]);
+                return DALEC_INPUT_ERROR;
+            }
         }
+        if (d->cyclic && map != NULL) {
+            DALECI_Error("irregular arrays cannot be block-cyclic");
+            return DALEC_INPUT_ERROR;
+        }
+        if (d->dynamic && (d->cyclic || map != NULL)) {
+            DALECI_Error("block-cyclic and irregular arrays cannot be dynamic");
+            return DALEC_INPUT_ERROR;
+        }
+        const double w[4] = { d->cost.imbalance, d->cost.halo, d->cost.panel, d->cost.owners };
+        for (int j=0; j<4; j++) {
+            if (!(w[j] >= 0)) {
+                DALECI_Error("cost weight %d (%g) is not a nonnegative number", j, w[j]);
+                return DALEC_INPUT_ERROR;
+            }
+        }
+    }
 
-        /* check to make sure all calling processes gave the same arguments */
-
-#define DALEC_ARGS_COUNT 2+4*DALEC_ARRAY_MAX_DIM
+    /* determine if the datatype is a predefined one */
+    {
+        int num_integers, num_addresses, num_datatypes, combiner;
+        rc = MPI_Type_get_envelope(d->type, &num_integers, &num_addresses, &num_datatypes, &combiner);
+        DALECI_Check_MPI(FCNAME, "MPI_Type_get_envelope", rc);
+        if (combiner != MPI_COMBINER_NAMED) {
+            DALECI_Error("input datatype is not a predefined MPI datatype!");
+            return DALEC_INPUT_ERROR;
+        }
+    }
 
-        int64_t args[DALEC_ARGS_COUNT] = {0};
+    /* encode the arguments that must be the same on all calling processes */
+    {
         args[0] =  ndim;
         args[1] = -ndim;
+        args[2] =  (d->cyclic != 0);
+        args[3] = -(d->cyclic != 0);
+        /* the weights are compared by their bits, without negative zeros */
+        const double weights[4] = { d->cost.imbalance + 0.0, d->cost.halo + 0.0,
+                                    d->cost.panel + 0.0, d->cost.owners + 0.0 };
+        for (int j=0; j<4; j++) {
+            memcpy(&args[4+2*j], &weights[j], sizeof(int64_t));
+            args[4+2*j+1] = -args[4+2*j];
+        }
+        args[12] =  (d->dynamic != 0);
+        args[13] = -(d->dynamic != 0);
         for (int i=0; i<ndim; i++) {
             const size_t dim = d->dims[i];
             const size_t blk = d->blks[i];
-            args[2+4*i+0] =  dim;
-            args[2+4*i+1] = -dim;
-            args[2+4*i+2] =  blk;
-            args[2+4*i+3] = -blk;
+            const size_t gst = d->ghosts[i];
+            const int    per = (d->periodic[i] != 0);
+            const size_t pat = d->cost.patch[i];
+            args[14+10*i+0] =  dim;
+            args[14+10*i+1] = -dim;
+            args[14+10*i+2] =  blk;
+            args[14+10*i+3] = -blk;
+            args[14+10*i+4] =  gst;
+            args[14+10*i+5] = -gst;
+            args[14+10*i+6] =  per;
+            args[14+10*i+7] = -per;
+            args[14+10*i+8] =  pat;
+            args[14+10*i+9] = -pat;
+        }
+        if (map != NULL) {
+            int64_t * irreg = &args[DALECI_ARGS_COUNT];
+            const size_t * starts = map;
+            int s = 0;
+            for (int i=0; i<ndim; i++) {
+                irreg[2*i]   =  nblock[i];
+                irreg[2*i+1] = -nblock[i];
+                for (int c=0; c<nblock[i]; c++, s++) {
+                    irreg[2*DALEC_ARRAY_MAX_DIM+2*s]   =  starts[c];
+                    irreg[2*DALEC_ARRAY_MAX_DIM+2*s+1] = -starts[c];
+                }
+                starts += nblock[i];
+            }
         }
+    }
 
-        int rc = MPI_Allreduce(MPI_IN_PLACE, args, DALEC_ARGS_COUNT, MPI_INT64_T, MPI_MAX, comm);
-        DALECI_Check_MPI(FCNAME, "MPI_Reduce", rc);
+    return DALEC_SUCCESS;
+}
 
-#undef DALEC_ARGS_COUNT
+/** Check that the arguments encoded by DALECI_Array_check agree across
+  * ranks, after the reduction of args.
+  *
+  * @return            Zero on success
+  */
+static int DALECI_Array_agree(const DALEC_Array_descriptor * d, const int nblock[], const size_t map[],
+                              const int64_t args[])
+{
+    const int ndim = d->ndim;
+    const double weights[4] = { d->cost.imbalance, d->cost.halo, d->cost.panel, d->cost.owners };
 
-        if (args[0] != -args[1]) {
-            DALECI_Error("ndim (%d) is not constant across ranks", ndim);
+    if (args[0] != -args[1]) {
+        DALECI_Error("ndim (%d) is not constant across ranks", ndim);
+        return DALEC_INPUT_ERROR;
+    }
+    if (args[2] != -args[3]) {
+        DALECI_Error("cyclic (%d) is not constant across ranks", d->cyclic);
+        return DALEC_INPUT_ERROR;
+    }
+    for (int j=0; j<4; j++) {
+        if (args[4+2*j] != -args[4+2*j+1]) {
+            DALECI_Error("cost weight %d (%g) is not constant across ranks", j, weights[j]);
+            return DALEC_INPUT_ERROR;
+        }
+    }
+    if (args[12] != -args[13]) {
+        DALECI_Error("dynamic (%d) is not constant across ranks", d->dynamic);
+        return DALEC_INPUT_ERROR;
+    }
+    for (int i=0; i<ndim; i++) {
+        if (args[14+10*i+0] != -args[14+10*i+1]) {
+            DALECI_Error("dims[%d] (%zu) is not constant across ranks", i, d->dims[i]);
             return DALEC_INPUT_ERROR;
         }
+        if (args[14+10*i+2] != -args[14+10*i+3]) {
+            DALECI_Error("blks[%d] (%zu) is not constant across ranks", i, d->blks[i]);
+            return DALEC_INPUT_ERROR;
+        }
+        if (args[14+10*i+4] != -args[14+10*i+5] || args[14+10*i+6] != -args[14+10*i+7]) {
+            DALECI_Error("ghosts[%d] (%zu) or periodic[%d] (%d) is not constant across ranks",
+                         i, d->ghosts[i], i, d->periodic[i]);
+            return DALEC_INPUT_ERROR;
+        }
+        if (args[14+10*i+8] != -args[14+10*i+9]) {
+            DALECI_Error("cost.patch[%d] (%zu) is not constant across ranks", i, d->cost.patch[i]);
+            return DALEC_INPUT_ERROR;
+        }
+    }
+    if (map != NULL) {
+        /* the boundaries are compared once nblock, and so their number, agrees */
+        const int64_t * irreg = &args[DALECI_ARGS_COUNT];
+        int s = 0;
         for (int i=0; i<ndim; i++) {
-            if (args[2+4*i+0] != -args[2+4*i+1]) {
-                DALECI_Error("dims[%d] (%zu) is not constant across ranks", i, d->dims[i]);
+            if (irreg[2*i] != -irreg[2*i+1]) {
+                DALECI_Error("nblock[%d] (%d) is not constant across ranks", i, nblock[i]);
                 return DALEC_INPUT_ERROR;
             }
-            if (args[2+4*i+2] != -args[2+4*i+3]) {
-                DALECI_Error("blks[%d] (%zu) is not constant across ranks", i, d->blks[i]);
+            s += nblock[i];
+        }
+        for (int j=0; j<s; j++) {
+            if (irreg[2*DALEC_ARRAY_MAX_DIM+2*j] != -irreg[2*DALEC_ARRAY_MAX_DIM+2*j+1]) {
+                DALECI_Error("map[%d] (%zu) is not constant across ranks", j, map[j]);
                 return DALEC_INPUT_ERROR;
             }
         }
     }
 
-    /* determine if the datatype is a predefined one */
+    return DALEC_SUCCESS;
+}
+
+/** Fill in the handle of an array from its descriptor, with the grid and
+  * blocks from ddb, or, if map is not NULL, with nblock[i] blocks along
+  * dimension i that start at the indices in map.  Local, but deterministic.
+  *
+  * @return            Zero on success
+  */
+static int DALECI_Array_grid(const DALEC_Array_descriptor * d, const int nblock[], const size_t map[],
+                             DALEC_Array_handle * h)
+{
+    const int ndim = d->ndim;
+
+    int np = 1;
+    MPI_Comm_size(d->comm, &np);
+
+    /* capture array properties in the handle */
     {
-        int num_integers, num_addresses, num_datatypes, combiner;
-        rc = MPI_Type_get_envelope(d->type, &num_integers, &num_addresses, &num_datatypes, &combiner);
-        DALECI_Check_MPI(FCNAME, "MPI_Type_get_envelope", rc);
-        if (combiner != MPI_COMBINER_NAMED) {
-            DALECI_Error("input datatype is not a predefined MPI datatype!");
+        h->type   = d->type;
+        h->ndim   = ndim;
+        h->cyclic = (d->cyclic != 0);
+        for (int i=0; i<DALEC_ARRAY_MAX_DIM; i++) {
+            h->dims[i]       = (i<ndim) ? d->dims[i] : 1;
+            h->blocksizes[i] = (i<ndim) ? d->blks[i] : 1;
+            h->pedims[i]     = 1;
+            h->coords[i]     = 0;
+            h->local_lo[i]   = 0;
+            h->local_dims[i] = 1;
+            h->remainders[i] = 0;
+            h->ghosts[i]     = (i<ndim) ? d->ghosts[i] : 0;
+            h->periodic[i]   = (i<ndim) ? (d->periodic[i] != 0) : 0;
+            h->irreg[i]      = NULL;
+        }
+        h->disp      = 0;
+        h->dynamic   = NULL;
+        h->aggregate = NULL;
+        h->shm       = NULL;
+        h->window    = NULL;
+        h->dirty     = NULL;
+        h->staging   = NULL;
+        h->halo      = NULL;
+    }
+
+    /* determine the process grid and the blocks */
+    {
+        if (map != NULL) {
+            /* the block boundaries are given, with dims[i] appended */
+            const size_t * starts = map;
+            for (int i=0; i<ndim; i++) {
+                h->pedims[i]     = nblock[i];
+                h->blocksizes[i] = 0;
+                h->irreg[i]      = malloc((nblock[i]+1) * sizeof(size_t));
+                if (h->irreg[i] == NULL) {
+                    DALECI_Error("malloc of %d block boundaries failed", nblock[i]+1);
+                    return DALEC_INPUT_ERROR;
+                }
+                memcpy(h->irreg[i], starts, nblock[i] * sizeof(size_t));
+                h->irreg[i][nblock[i]] = d->dims[i];
+                starts += nblock[i];
+            }
+        } else {
+            /* blk = 0 means we get to decide, which ddb expresses as a non-positive block */
+            ssize_t ardims[DALEC_ARRAY_MAX_DIM] = {0};
+            ssize_t blk[DALEC_ARRAY_MAX_DIM]    = {0};
+            ssize_t pedims[DALEC_ARRAY_MAX_DIM] = {0};
+            for (int i=0; i<ndim; i++) {
+                ardims[i] = d->dims[i];
+                blk[i]    = d->blks[i];
+            }
+
+            ddb(ndim, ardims, np, blk, pedims);
+
+            /* the cost model, if any, may deal the blocks differently */
+            if (DALECI_Grid_weighted(d)) {
+                DALECI_Grid_search(d, np, pedims);
+            }
+
+            for (int i=0; i<ndim; i++) {
+                if (pedims[i] < 1 || pedims[i] > np) {
+                    DALECI_Error("ddb returned an invalid process grid (pedims[%d] = %zd)", i, pedims[i]);
+                    return DALEC_ERROR_MPI_LIBRARY;
+                }
+                h->pedims[i] = (int)pedims[i];
+            }
+
+            DALECI_Block_sizes(h, d->blks);
+        }
+    }
+
+    return DALEC_SUCCESS;
+}
+
+/** Find the block owned by this process from its rank in h->comm.
+  */
+static void DALECI_Array_place(DALEC_Array_handle * h)
+{
+    const int ndim = h->ndim;
+
+    int me = 0, grid_size = 1;
+    MPI_Comm_rank(h->comm, &me);
+    for (int i=0; i<ndim; i++) {
+        grid_size *= h->pedims[i];
+    }
+
+    /* row-major mapping of the ranks of the array onto the grid */
+    int owner = (me < grid_size);
+    for (int i=ndim-1, rem=me; i>=0; i--) {
+        h->coords[i] = owner ? (rem % h->pedims[i]) : -1;
+        rem /= h->pedims[i];
+    }
+    for (int i=0; i<ndim; i++) {
+        if (owner) {
+            const int c = h->coords[i];
+            h->local_lo[i]   = DALECI_Block_lo(h, i, c);
+            h->local_dims[i] = DALECI_Block_extent(h, i, c);
+        } else {
+            h->local_lo[i]   = 0;
+            h->local_dims[i] = 0;
+        }
+        DALECI_Dbg_print(DEBUG_CAT_ARRAY_DIST, "dim %d: pedims = %d, coord = %d, blocksize = %zu, remainder = %zu, local_lo = %zu, local_dims = %zu, ghosts = %zu\n",
+                         i, h->pedims[i], h->coords[i], h->blocksizes[i], h->remainders[i], h->local_lo[i], h->local_dims[i], h->ghosts[i]);
+    }
+}
+
+/** Elements of the window of an array on this rank: the ghost cells pad the
+  * local block, if there is one.
+  */
+static MPI_Aint DALECI_Array_elements(const DALEC_Array_handle * h)
+{
+    MPI_Aint elements = 1;
+    for (int i=0; i<h->ndim; i++) {
+        elements *= (h->local_dims[i] > 0) ? h->local_dims[i] + 2*h->ghosts[i] : 0;
+    }
+    return elements;
+}
+
+/** Elements of the slot of an array in a shared window, which is the same
+  * on every rank: room for the largest padded block along every dimension,
+  * rounded up to DALECI_SLOT_ALIGN bytes if the element size divides it.
+  */
+static MPI_Aint DALECI_Array_slot(const DALEC_Array_handle * h, int type_size)
+{
+    MPI_Aint elements = 1;
+    for (int i=0; i<h->ndim; i++) {
+        size_t largest = 0;
+        for (int c=0; c<h->pedims[i]; c++) {
+            const size_t extent = DALECI_Block_extent(h, i, c);
+            largest = (extent > largest) ? extent : largest;
+        }
+        elements *= largest + 2*h->ghosts[i];
+    }
+    if (DALECI_SLOT_ALIGN % type_size == 0) {
+        const MPI_Aint line = DALECI_SLOT_ALIGN / type_size;
+        elements = (elements + line - 1) / line * line;
+    }
+    return elements;
+}
+
+/** Create the state of an array that lives beside its window.
+  *
+  * @return            Zero on success
+  */
+static int DALECI_Array_state(const DALEC_Array_descriptor * d, DALEC_Array_handle * h)
+{
+    int rc; /* MPI return code */
+
+    rc = DALECI_Dirty_create(h);
+    if (rc != DALEC_SUCCESS) return rc;
+
+    rc = DALECI_Staging_create(h);
+    if (rc != DALEC_SUCCESS) return rc;
+
+    rc = DALECI_Halo_create(h);
+    if (rc != DALEC_SUCCESS) return rc;
+
+    /* if array is named, assign to window, which a batch names after its first array */
+    if (d->name != NULL && h->disp == 0) {
+        rc = MPI_Win_set_name(h->win, d->name);
+        DALECI_Check_MPI(__func__, "MPI_Win_set_name", rc);
+    }
+
+    return DALEC_SUCCESS;
+}
+
+/** Create an array with the grid and blocks from ddb, or, if map is not
+  * NULL, with nblock[i] blocks along dimension i that start at the indices
+  * in map.
+  *
+  * @return            Zero on success
+  */
+static int DALECI_Create_array(const DALEC_Array_descriptor * d, const int nblock[], const size_t map[],
+                               DALEC_Array_handle * h)
+{
+    int rc; /* MPI return code */
+
+    /* check for really stupid inputs */
+    if (d==NULL || h==NULL) {
+        DALECI_Error("d (%p) or h (%p) is a null pointer", d, h);
+        return DALEC_INPUT_ERROR;
+    }
+
+    /* check to make sure all calling processes gave the same arguments */
+    {
+        int np;
+        MPI_Comm_size(d->comm, &np);
+        const int count = DALECI_ARGS_COUNT + ((map != NULL) ? DALECI_IRREG_COUNT(np) : 0);
+        int64_t * args = calloc(count, sizeof(int64_t));
+        if (args == NULL) {
+            DALECI_Error("calloc of %d arguments failed", count);
             return DALEC_INPUT_ERROR;
         }
+        rc = DALECI_Array_check(d, nblock, map, args);
+        if (rc != DALEC_SUCCESS) {
+            free(args);
+            return rc;
+        }
+
+        rc = MPI_Allreduce(MPI_IN_PLACE, args, count, MPI_INT64_T, MPI_MAX, d->comm);
+        DALECI_Check_MPI(FCNAME, "MPI_Allreduce", rc);
+
+        rc = DALECI_Array_agree(d, nblock, map, args);
+        free(args);
+        if (rc != DALEC_SUCCESS) return rc;
     }
 
+    rc = DALECI_Array_grid(d, nblock, map, h);
+    if (rc != DALEC_SUCCESS) return rc;
+
+    /* the communicator of the array orders its ranks as they are placed on the grid */
+    rc = DALECI_Node_comm(h, d->comm);
+    if (rc != DALEC_SUCCESS) return rc;
+    DALECI_Array_place(h);
+
     /* allocate the window for this array */
     {
-        MPI_Aint win_size = 0;
-
         int type_size = 0;
         rc = MPI_Type_size(d->type, &type_size);
         DALECI_Check_MPI(FCNAME, "MPI_Type_size", rc);
 
-        int np = 1, me = 0;
-        MPI_Comm_size(comm, &np);
-        MPI_Comm_rank(comm, &me);
-
-        /* start with specialization and generalize later... */
-        DALECI_Dbg_print(DEBUG_CAT_ARRAY_DIST, "ndim = %d\n", ndim);
-        if (ndim==1) {
-
-            const size_t dim = d->dims[0];
-            const size_t blk = d->blks[0];
-
-            DALECI_Dbg_print(DEBUG_CAT_ARRAY_DIST, "dims[1] = {%d}\n", dim);
-            DALECI_Dbg_print(DEBUG_CAT_ARRAY_DIST, "blks[1] = {%d}\n", blk);
-
-            /* blk = 0 means we get to decide */
-            if (blk == 0) {
-                win_size = (dim/np);
-                if (dim%np > me) win_size++;
-                DALECI_Dbg_print(DEBUG_CAT_ARRAY_DIST, "win_size = %zu\n", win_size);
-            } else {
-                const size_t num_full_blocks    = (dim/blk);
-                const size_t partial_block_size = (dim%blk);
-
-                DALECI_Dbg_print(DEBUG_CAT_ARRAY_DIST, "num_full_blocks    = %zu\n", num_full_blocks);
-                DALECI_Dbg_print(DEBUG_CAT_ARRAY_DIST, "partial_block_size = %zu\n", partial_block_size);
-
-                const size_t num_all_blocks  = num_full_blocks + (partial_block_size>1);
-                const size_t full_blk_per_pe = (num_full_blocks/np) + (num_full_blocks%np > 0);
-                const size_t all_blk_per_pe = (num_all_blocks/np) + (num_all_blocks%np > 0);
-
-                DALECI_Dbg_print(DEBUG_CAT_ARRAY_DIST, "num_all_blocks  = %zu\n", num_all_blocks);
-                DALECI_Dbg_print(DEBUG_CAT_ARRAY_DIST, "full_blk_per_pe = %zu\n", full_blk_per_pe);
-                DALECI_Dbg_print(DEBUG_CAT_ARRAY_DIST, "all_blk_per_pe  = %zu\n", all_blk_per_pe);
-
-#if 0
-                win_size = blk_per_pe * blk;
-                DALECI_Dbg_print(DEBUG_CAT_ARRAY_DIST, "win_size   = %zu\n", win_size);
-                if (me < num_blocks%np - 1) win_size += blk;
-                DALECI_Dbg_print(DEBUG_CAT_ARRAY_DIST, "win_size   = %zu\n", win_size);
-                if (me == num_blocks%np) win_size += (dim - blk*(num_blocks/np + num_blocks%np - 1));
-                DALECI_Dbg_print(DEBUG_CAT_ARRAY_DIST, "win_size   = %zu\n", win_size);
-#endif
-            }
-        }
+        const MPI_Aint win_size = DALECI_Array_elements(h);
+        DALECI_Dbg_print(DEBUG_CAT_ARRAY_DIST, "win_size = %zu\n", (size_t)win_size);
 
+        /* ranks on the same node share the memory of the array unless disabled;
+         * the window of a destroyed array over the same ranks may be reused */
         void * baseptr = NULL;
-        rc = MPI_Win_allocate(win_size, type_size, MPI_INFO_NULL, comm, &baseptr, &(h->win));
-        DALECI_Check_MPI(FCNAME, "MPI_Win_allocate", rc);
+        if (d->dynamic) {
+            rc = DALECI_Dynamic_create(d, h, win_size * type_size, type_size, &baseptr);
+        } else {
+            rc = DALECI_Window_get(h, win_size * type_size, type_size, DALECI_Getenv_bool("DALEC_SHM", 1), &baseptr);
+        }
+        if (rc != DALEC_SUCCESS) return rc;
+        h->base = baseptr;
     }
 
-    /* if array is named, assign to window */
-    {
-        if (d->name != NULL) {
-            rc = MPI_Win_set_name(h->win, d->name);
-            DALECI_Check_MPI(FCNAME, "MPI_Win_set_name", rc);
+    return DALECI_Array_state(d, h);
+}
+
+/** Create an array whose grid and blocks are chosen by ddb, unless
+  * d->blks fixes the block sizes, and by the cost model in d->cost if it
+  * has a nonzero weight.  Collective.
+  *
+  * @param[in]  d      Array descriptor
+  * @param[out] h      Array handle
+  * @return            Zero on success
+  */
+int DALEC_Create_array(const DALEC_Array_descriptor * d, DALEC_Array_handle * h)
+{
+    return DALECI_Create_array(d, NULL, NULL, h);
+}
+
+/* -- begin weak symbols block -- */
+#if defined(HAVE_PRAGMA_WEAK)
+#  pragma weak DALEC_Create_arrays = PDALEC_Create_arrays
+#elif defined(HAVE_PRAGMA_HP_SEC_DEF)
+#  pragma _HP_SECONDARY_DEF PDALEC_Create_arrays DALEC_Create_arrays
+#elif defined(HAVE_PRAGMA_CRI_DUP)
+#  pragma _CRI duplicate DALEC_Create_arrays as PDALEC_Create_arrays
+#elif defined(HAVE_WEAK_ATTRIBUTE)
+int DALEC_Create_arrays(int n, const DALEC_Array_descriptor d[], DALEC_Array_handle h[])
+    __attribute__ ((weak, alias("PDALEC_Create_arrays")));
+#else
+#define DALEC_Create_arrays PDALEC_Create_arrays
+#endif
+/* -- end weak symbols block -- */
+
+/** Create n arrays at once, as DALEC_Create_array would create each of
+  * them, with one reduction to check the arguments of all of them and one
+  * window for all arrays whose elements have the same size.  Every array
+  * has a slot in the window at the same offset on every rank, as large as
+  * its largest local block, and its ranks ordered as those of the first
+  * array in the window.  The arrays are destroyed one at a time with
+  * DALEC_Destroy_array, and the window goes with the last of them.
+  * Dynamic arrays get windows of their own.  The communicators of the
+  * descriptors must be congruent.  Collective.
+  *
+  * @param[in]  n      Number of arrays
+  * @param[in]  d      Array descriptors
+  * @param[out] h      Array handles
+  * @return            Zero on success
+  */
+int DALEC_Create_arrays(int n, const DALEC_Array_descriptor d[], DALEC_Array_handle h[])
+{
+    int rc; /* MPI return code */
+
+    if (n < 0 || (n > 0 && (d == NULL || h == NULL))) {
+        DALECI_Error("n (%d) is negative, or d (%p) or h (%p) is a null pointer", n, d, h);
+        return DALEC_INPUT_ERROR;
+    }
+    if (n == 0) {
+        return DALEC_SUCCESS;
+    }
+    for (int k=1; k<n; k++) {
+        int result;
+        MPI_Comm_compare(d[k].comm, d[0].comm, &result);
+        if (result != MPI_IDENT && result != MPI_CONGRUENT) {
+            DALECI_Error("the communicator of array %d is not congruent to that of array 0", k);
+            return DALEC_INPUT_ERROR;
         }
     }
 
-#if 0
-    /* capture array properties in window attributes */
+    /* check to make sure all calling processes gave the same arguments, for all arrays at once */
     {
-        rc = MPI_Win_create_keyval(MPI_WIN_NULL_COPY_FN, MPI_WIN_NULL_DELETE_FN, &(h->win_keyval), NULL);
-        DALECI_Check_MPI(FCNAME, "MPI_Win_create_keyval", rc);
+        int64_t * args = calloc((size_t)n * DALECI_ARGS_COUNT, sizeof(int64_t));
+        if (args == NULL) {
+            DALECI_Error("calloc of the arguments of %d arrays failed", n);
+            return DALEC_INPUT_ERROR;
+        }
+        for (int k=0; k<n; k++) {
+            rc = DALECI_Array_check(&d[k], NULL, NULL, &args[(size_t)k * DALECI_ARGS_COUNT]);
+            if (rc != DALEC_SUCCESS) return rc;
+        }
 
+        rc = MPI_Allreduce(MPI_IN_PLACE, args, n * DALECI_ARGS_COUNT, MPI_INT64_T, MPI_MAX, d[0].comm);
+        DALECI_Check_MPI(__func__, "MPI_Allreduce", rc);
 
+        for (int k=0; k<n; k++) {
+            rc = DALECI_Array_agree(&d[k], NULL, NULL, &args[(size_t)k * DALECI_ARGS_COUNT]);
+            if (rc != DALEC_SUCCESS) return rc;
+        }
+        free(args);
     }
-#endif
+
+    int * type_size = malloc(n * sizeof(int));
+    if (type_size == NULL) {
+        DALECI_Error("malloc of %d element sizes failed", n);
+        return DALEC_INPUT_ERROR;
+    }
+    for (int k=0; k<n; k++) {
+        rc = DALECI_Array_grid(&d[k], NULL, NULL, &h[k]);
+        if (rc != DALEC_SUCCESS) return rc;
+
+        rc = MPI_Type_size(d[k].type, &type_size[k]);
+        DALECI_Check_MPI(__func__, "MPI_Type_size", rc);
+    }
+
+    /* dynamic arrays attach their memory to windows of their own */
+    for (int k=0; k<n; k++) {
+        if (!d[k].dynamic) continue;
+
+        rc = DALECI_Node_comm(&h[k], d[k].comm);
+        if (rc != DALEC_SUCCESS) return rc;
+        DALECI_Array_place(&h[k]);
+
+        void * baseptr = NULL;
+        rc = DALECI_Dynamic_create(&d[k], &h[k], DALECI_Array_elements(&h[k]) * type_size[k], type_size[k], &baseptr);
+        if (rc != DALEC_SUCCESS) return rc;
+        h[k].base = baseptr;
+
+        rc = DALECI_Array_state(&d[k], &h[k]);
+        if (rc != DALEC_SUCCESS) return rc;
+    }
+
+    /* displacements count elements, so arrays share a window with those of the same element size */
+    const int use_shm = DALECI_Getenv_bool("DALEC_SHM", 1);
+    for (int k=0; k<n; k++) {
+        if (d[k].dynamic) continue;
+        int first = k;
+        for (int j=0; j<k; j++) {
+            if (!d[j].dynamic && type_size[j] == type_size[k]) {
+                first = j;
+                break;
+            }
+        }
+        if (first != k) continue;
+
+        /* the ranks of the window are ordered as the first array places them on its grid */
+        rc = DALECI_Node_comm(&h[k], d[k].comm);
+        if (rc != DALEC_SUCCESS) return rc;
+
+        MPI_Aint elements = 0;
+        for (int j=k; j<n; j++) {
+            if (d[j].dynamic || type_size[j] != type_size[k]) continue;
+            h[j].comm = h[k].comm;
+            DALECI_Array_place(&h[j]);
+            h[j].disp  = elements;
+            elements  += DALECI_Array_slot(&h[j], type_size[j]);
+        }
+        DALECI_Dbg_print(DEBUG_CAT_ARRAY_DIST, "win_size = %zu for the arrays of %d bytes\n",
+                         (size_t)elements, type_size[k]);
+
+        void * baseptr = NULL;
+        rc = DALECI_Window_get(&h[k], elements * type_size[k], type_size[k], use_shm, &baseptr);
+        if (rc != DALEC_SUCCESS) return rc;
+
+        for (int j=k; j<n; j++) {
+            if (d[j].dynamic || type_size[j] != type_size[k]) continue;
+            if (j != k) {
+                DALECI_Window_share(&h[j], &h[k]);
+            }
+            h[j].base = (char*)baseptr + h[j].disp * type_size[j];
+
+            rc = DALECI_Array_state(&d[j], &h[j]);
+            if (rc != DALEC_SUCCESS) return rc;
+        }
+    }
+    free(type_size);
 
     return DALEC_SUCCESS;
 }
 
+/* -- begin weak symbols block -- */
+#if defined(HAVE_PRAGMA_WEAK)
+#  pragma weak DALEC_Create_array_irreg = PDALEC_Create_array_irreg
+#elif defined(HAVE_PRAGMA_HP_SEC_DEF)
+#  pragma _HP_SECONDARY_DEF PDALEC_Create_array_irreg DALEC_Create_array_irreg
+#elif defined(HAVE_PRAGMA_CRI_DUP)
+#  pragma _CRI duplicate DALEC_Create_array_irreg as PDALEC_Create_array_irreg
+#elif defined(HAVE_WEAK_ATTRIBUTE)
+int DALEC_Create_array_irreg(const DALEC_Array_descriptor * d, const int nblock[], const size_t map[],
+                             DALEC_Array_handle * h) __attribute__ ((weak, alias("PDALEC_Create_array_irreg")));
+#else
+#define DALEC_Create_array_irreg PDALEC_Create_array_irreg
+#endif
+/* -- end weak symbols block -- */
+
+/** Create an array with an irregular distribution, like NGA_Create_irreg.
+  * Dimension i is cut into nblock[i] blocks, and map holds the first index
+  * of every block, for dimension 0 first.  Blocks may be empty.  The grid
+  * of blocks is row-major over the ranks of d->comm, and d->blks is not
+  * used.  Collective.
+  *
+  * @param[in]  d      Array descriptor
+  * @param[in]  nblock Number of blocks in each dimension
+  * @param[in]  map    First index of each block, nondecreasing from zero in each dimension
+  * @param[out] h      Array handle
+  * @return            Zero on success
+  */
+int DALEC_Create_array_irreg(const DALEC_Array_descriptor * d, const int nblock[], const size_t map[],
+                             DALEC_Array_handle * h)
+{
+    if (d == NULL || nblock == NULL || map == NULL) {
+        DALECI_Error("d (%p), nblock (%p) or map (%p) is a null pointer", d, nblock, map);
+        return DALEC_INPUT_ERROR;
+    }
+    if (d->ndim < 1 || d->ndim > DALEC_ARRAY_MAX_DIM) {
+        DALECI_Error("ndim (%d) is not within [1,%d]", d->ndim, DALEC_ARRAY_MAX_DIM);
+        return DALEC_INPUT_ERROR;
+    }
+
+    int np;
+    MPI_Comm_size(d->comm, &np);
+
+    /* the boundaries are compared across ranks with the other arguments */
+    long long grid_size = 1;
+    const size_t * starts = map;
+    for (int i=0; i<d->ndim; i++) {
+        if (nblock[i] < 1) {
+            DALECI_Error("nblock[%d] = %d < 1", i, nblock[i]);
+            return DALEC_INPUT_ERROR;
+        }
+        grid_size *= nblock[i];
+        for (int c=0; c<nblock[i]; c++) {
+            const size_t next = (c+1 < nblock[i]) ? starts[c+1] : d->dims[i];
+            if ((c == 0 && starts[c] != 0) || starts[c] > next) {
+                DALECI_Error("map of dimension %d is not nondecreasing from 0 to dims[%d] = %zu at block %d",
+                             i, i, d->dims[i], c);
+                return DALEC_INPUT_ERROR;
+            }
+        }
+        starts += nblock[i];
+    }
+    if (grid_size > np) {
+        DALECI_Error("%lld blocks exceed the %d ranks of the communicator", grid_size, np);
+        return DALEC_INPUT_ERROR;
+    }
+    return DALECI_Create_array(d, nblock, map, h);
+}
+
 /* -- begin weak symbols block -- */
 #if defined(HAVE_PRAGMA_WEAK)
 #  pragma weak DALEC_Destroy_array = DALEC_Destroy_array
@@ -244,7 +768,8 @@ int DALEC_Destroy_array(DALEC_Array_handle * h) __attribute__ ((weak, alias("PDA
 #undef FNAME
 #define FCNAME DALECI_QUOTE_STRING(FUNCNAME)
 
-/** 
+/** Destroy an array.  Its window is kept for a later array over the same
+  * ranks (see DALEC_Pool_trim).  Collective.
   *
   * @return            Zero on success
   */
@@ -252,8 +777,27 @@ int DALEC_Destroy_array(DALEC_Array_handle * h)
 {
     int rc; /* MPI return code */
 
-    rc = MPI_Win_free(&(h->win));
-    DALECI_Check_MPI(FCNAME, "MPI_Win_free", rc);
+    if (h->aggregate != NULL) {
+        DALEC_Aggregate_end(h);
+    }
+
+    DALECI_Dirty_free(h);
+    DALECI_Staging_free(h);
+    DALECI_Halo_free(h);
+
+    /* completes everything in flight; the window goes to the pool, or is
+     * freed with its communicator, unless other arrays of a batch use it */
+    if (h->dynamic != NULL) {
+        rc = DALECI_Dynamic_free(h);
+    } else {
+        rc = DALECI_Window_release(h);
+    }
+    if (rc != DALEC_SUCCESS) return rc;
+
+    for (int i=0; i<h->ndim; i++) {
+        free(h->irreg[i]);
+        h->irreg[i] = NULL;
+    }
 
     return DALEC_SUCCESS;
 }
@@ -0,0 +1,542 @@
+/*
+ * Copyright (C) 2014. See COPYRIGHT in top-level directory.
+ */
+
+#include <math.h>
+
+#include <dalec.h>
+#include <dalec_guts.h>
+#include <debug.h>
+
+/* Whole-array operations work on the local block of each rank, through
+ * DALECI_Access_block, so nothing moves when the arrays share a distribution.  An
+ * input with another distribution is fetched into a staging buffer shaped
+ * like the local block of the output.  Every operation is collective: it
+ * starts with DALEC_Sync on its arrays so that all earlier updates are
+ * seen, and operations that write end with DALEC_Sync on the output.
+ * Ghost cells are neither read nor written. */
+
+/* The local block of an array, or a copy of the matching elements of
+ * another array, as seen by a whole-array operation. */
+typedef struct {
+    char * ptr;                         /* first element of the local block             */
+    size_t ld[DALEC_ARRAY_MAX_DIM];     /* extents of dimensions 1..ndim-1 in memory    */
+    void * staging;                     /* staging buffer to return, or NULL            */
+} DALECI_View;
+
+/** Number of elements in the local block. */
+static size_t DALECI_Local_count(const DALEC_Array_handle * h)
+{
+    size_t n = 1;
+    for (int i=0; i<h->ndim; i++) {
+        n *= h->local_dims[i];
+    }
+    return n;
+}
+
+/** Copy the elements of src that correspond to the local block of like,
+  * which must not be empty, into buf, which is laid out like that block.
+  * The local block is one patch, or one per block for a block-cyclic like.
+  *
+  * @return             Zero on success
+  */
+static int DALECI_Local_fetch(const DALEC_Array_handle * src, const DALEC_Array_handle * like,
+                              void * buf, const size_t ld[])
+{
+    int rc;
+
+    const int ndim = like->ndim;
+    int first[DALEC_ARRAY_MAX_DIM], last[DALEC_ARRAY_MAX_DIM], j[DALEC_ARRAY_MAX_DIM];
+    for (int i=0; i<ndim; i++) {
+        first[i] = 0;
+        last[i]  = (int)DALECI_Seg_count(like, i, like->coords[i]) - 1;
+        j[i]     = 0;
+    }
+
+    int type_size = 0;
+    MPI_Type_size(like->type, &type_size);
+
+    /* the j[i]-th block of the caller along dimension i */
+    do {
+        size_t lo[DALEC_ARRAY_MAX_DIM], hi[DALEC_ARRAY_MAX_DIM], offset = 0;
+        for (int i=0; i<ndim; i++) {
+            const size_t s = like->coords[i] + (size_t)j[i] * like->pedims[i];
+            lo[i]  = DALECI_Seg_lo(like, i, s);
+            hi[i]  = DALECI_Seg_lo(like, i, s+1) - 1;
+            offset = offset * ((i>0) ? ld[i-1] : 1) + DALECI_Local_index(like, i, lo[i]);
+        }
+        rc = DALEC_Get(src, lo, hi, (char*)buf + offset * type_size, ld);
+        if (rc != DALEC_SUCCESS) return rc;
+    } while (DALECI_Next_coord(ndim, first, last, j));
+
+    return DALEC_SUCCESS;
+}
+
+/** Find the elements of src that correspond to the local block of like,
+  * which must not be empty.  They are either the local block of src itself
+  * or a copy of them in a staging buffer from the pool of like.
+  *
+  * @return             Zero on success
+  */
+static int DALECI_Local_view(const DALEC_Array_handle * src, const DALEC_Array_handle * like, DALECI_View * v)
+{
+    int rc;
+
+    v->staging = NULL;
+
+    if (DALECI_Same_distribution(src, like)) {
+        rc = DALECI_Access_block(src, (void**)&v->ptr, v->ld);
+        if (rc != DALEC_SUCCESS) return rc;
+        return DALECI_Release_block(src, 0);
+    }
+
+    int type_size = 0;
+    MPI_Type_size(src->type, &type_size);
+    v->staging = DALECI_Staging_get(like->staging, DALECI_Local_count(like) * type_size);
+    if (v->staging == NULL) return DALEC_INPUT_ERROR;
+
+    v->ptr = v->staging;
+    for (int i=1; i<like->ndim; i++) {
+        v->ld[i-1] = like->local_dims[i];
+    }
+    return DALECI_Local_fetch(src, like, v->ptr, v->ld);
+}
+
+/** Length of the runs of contiguous elements that the local block of like
+  * is processed in.  Without ghost cells the whole block is one run,
+  * otherwise every row is.  */
+static size_t DALECI_Run_length(const DALEC_Array_handle * like, int nviews, const DALECI_View * v[])
+{
+    for (int j=0; j<nviews; j++) {
+        for (int i=1; i<like->ndim; i++) {
+            if (v[j]->ld[i-1] != like->local_dims[i]) {
+                return like->local_dims[like->ndim-1];
+            }
+        }
+    }
+    return DALECI_Local_count(like);
+}
+
+/** Address of run r of a view. */
+static void * DALECI_Run(const DALEC_Array_handle * like, const DALECI_View * v, size_t r, size_t run, int type_size)
+{
+    if (run == DALECI_Local_count(like)) {
+        return v->ptr;
+    }
+    size_t offset = 0, stride = 1;
+    for (int i=like->ndim-2; i>=0; i--) {
+        stride *= v->ld[i];
+        offset += (r % like->local_dims[i]) * stride;
+        r      /= like->local_dims[i];
+    }
+    return v->ptr + offset * type_size;
+}
+
+/** Check that two arrays have the same shape and type.
+  *
+  * @return            Zero on success
+  */
+static int DALECI_Check_conformable(const DALEC_Array_handle * a, const DALEC_Array_handle * b)
+{
+    if (a == NULL || b == NULL) {
+        DALECI_Error("a (%p) or b (%p) is a null pointer", a, b);
+        return DALEC_INPUT_ERROR;
+    }
+    if (a->type != b->type || a->ndim != b->ndim) {
+        DALECI_Error("arrays have different types or numbers of dimensions");
+        return DALEC_INPUT_ERROR;
+    }
+    for (int i=0; i<a->ndim; i++) {
+        if (a->dims[i] != b->dims[i]) {
+            DALECI_Error("arrays differ in dimension %d (%zu vs %zu)", i, a->dims[i], b->dims[i]);
+            return DALEC_INPUT_ERROR;
+        }
+    }
+    return DALEC_SUCCESS;
+}
+
+/** Apply c = alpha*a + beta*b to the local block of c, where b may be NULL
+  * and a may be c.  Collective.
+  *
+  * @return            Zero on success
+  */
+static int DALECI_Local_axpby(const void * alpha, const DALEC_Array_handle * a,
+                              const void * beta, const DALEC_Array_handle * b,
+                              const DALEC_Array_handle * c)
+{
+    int rc;
+
+    rc = DALEC_Sync(c);
+    if (rc != DALEC_SUCCESS) return rc;
+    if (a != c) {
+        rc = DALEC_Sync(a);
+        if (rc != DALEC_SUCCESS) return rc;
+    }
+    if (b != NULL && b != a && b != c) {
+        rc = DALEC_Sync(b);
+        if (rc != DALEC_SUCCESS) return rc;
+    }
+
+    const size_t n = DALECI_Local_count(c);
+    if (n > 0) {
+        DALECI_View va, vb, vc;
+        rc = DALECI_Local_view(a, c, &va);
+        if (rc != DALEC_SUCCESS) return rc;
+        if (b != NULL) {
+            rc = DALECI_Local_view(b, c, &vb);
+            if (rc != DALEC_SUCCESS) return rc;
+        } else {
+            vb = va;
+            vb.staging = NULL;
+        }
+
+        vc.staging = NULL;
+        rc = DALECI_Access_block(c, (void**)&vc.ptr, vc.ld);
+        if (rc != DALEC_SUCCESS) return rc;
+
+        int type_size = 0;
+        MPI_Type_size(c->type, &type_size);
+        const DALECI_View * views[3] = {&va, &vb, &vc};
+        const size_t run = DALECI_Run_length(c, 3, views);
+        for (size_t r=0; r<n/run; r++) {
+            rc = DALECI_Axpby(c->type, run, alpha, DALECI_Run(c, &va, r, run, type_size), beta,
+                              (b != NULL) ? DALECI_Run(c, &vb, r, run, type_size) : NULL,
+                              DALECI_Run(c, &vc, r, run, type_size));
+            if (rc != DALEC_SUCCESS) return rc;
+        }
+
+        rc = DALECI_Release_block(c, 1);
+        if (rc != DALEC_SUCCESS) return rc;
+
+        DALECI_Staging_put(c->staging, va.staging);
+        DALECI_Staging_put(c->staging, vb.staging);
+    }
+
+    return DALEC_Sync(c);
+}
+
+/* -- begin weak symbols block -- */
+#if defined(HAVE_PRAGMA_WEAK)
+#  pragma weak DALEC_Fill = PDALEC_Fill
+#elif defined(HAVE_PRAGMA_HP_SEC_DEF)
+#  pragma _HP_SECONDARY_DEF PDALEC_Fill DALEC_Fill
+#elif defined(HAVE_PRAGMA_CRI_DUP)
+#  pragma _CRI duplicate DALEC_Fill as PDALEC_Fill
+#elif defined(HAVE_WEAK_ATTRIBUTE)
+int DALEC_Fill(const DALEC_Array_handle * h, const void * value) __attribute__ ((weak, alias("PDALEC_Fill")));
+#else
+#define DALEC_Fill PDALEC_Fill
+#endif
+/* -- end weak symbols block -- */
+
+/** Set every element of an array to value.  Collective.
+  *
+  * @param[in] h       Array handle
+  * @param[in] value   Value of the type of the array
+  * @return            Zero on success
+  */
+int DALEC_Fill(const DALEC_Array_handle * h, const void * value)
+{
+    int rc;
+
+    if (h == NULL || value == NULL) {
+        DALECI_Error("h (%p) or value (%p) is a null pointer", h, value);
+        return DALEC_INPUT_ERROR;
+    }
+
+    rc = DALEC_Sync(h);
+    if (rc != DALEC_SUCCESS) return rc;
+
+    const size_t n = DALECI_Local_count(h);
+    if (n > 0) {
+        DALECI_View v;
+        rc = DALECI_Access_block(h, (void**)&v.ptr, v.ld);
+        if (rc != DALEC_SUCCESS) return rc;
+
+        int type_size = 0;
+        MPI_Type_size(h->type, &type_size);
+        const DALECI_View * views[1] = {&v};
+        const size_t run = DALECI_Run_length(h, 1, views);
+        for (size_t r=0; r<n/run; r++) {
+            rc = DALECI_Fill(h->type, run, value, DALECI_Run(h, &v, r, run, type_size));
+            if (rc != DALEC_SUCCESS) return rc;
+        }
+
+        rc = DALECI_Release_block(h, 1);
+        if (rc != DALEC_SUCCESS) return rc;
+    }
+
+    return DALEC_Sync(h);
+}
+
+/* -- begin weak symbols block -- */
+#if defined(HAVE_PRAGMA_WEAK)
+#  pragma weak DALEC_Scale = PDALEC_Scale
+#elif defined(HAVE_PRAGMA_HP_SEC_DEF)
+#  pragma _HP_SECONDARY_DEF PDALEC_Scale DALEC_Scale
+#elif defined(HAVE_PRAGMA_CRI_DUP)
+#  pragma _CRI duplicate DALEC_Scale as PDALEC_Scale
+#elif defined(HAVE_WEAK_ATTRIBUTE)
+int DALEC_Scale(const DALEC_Array_handle * h, const void * alpha) __attribute__ ((weak, alias("PDALEC_Scale")));
+#else
+#define DALEC_Scale PDALEC_Scale
+#endif
+/* -- end weak symbols block -- */
+
+/** Multiply every element of an array by alpha.  Collective.
+  *
+  * @param[in] h       Array handle
+  * @param[in] alpha   Scale factor of the type of the array
+  * @return            Zero on success
+  */
+int DALEC_Scale(const DALEC_Array_handle * h, const void * alpha)
+{
+    if (h == NULL || alpha == NULL) {
+        DALECI_Error("h (%p) or alpha (%p) is a null pointer", h, alpha);
+        return DALEC_INPUT_ERROR;
+    }
+    return DALECI_Local_axpby(alpha, h, NULL, NULL, h);
+}
+
+/* -- begin weak symbols block -- */
+#if defined(HAVE_PRAGMA_WEAK)
+#  pragma weak DALEC_Copy = PDALEC_Copy
+#elif defined(HAVE_PRAGMA_HP_SEC_DEF)
+#  pragma _HP_SECONDARY_DEF PDALEC_Copy DALEC_Copy
+#elif defined(HAVE_PRAGMA_CRI_DUP)
+#  pragma _CRI duplicate DALEC_Copy as PDALEC_Copy
+#elif defined(HAVE_WEAK_ATTRIBUTE)
+int DALEC_Copy(const DALEC_Array_handle * src, const DALEC_Array_handle * dst) __attribute__ ((weak, alias("PDALEC_Copy")));
+#else
+#define DALEC_Copy PDALEC_Copy
+#endif
+/* -- end weak symbols block -- */
+
+/** Copy one array into another of the same shape and type.  Collective.
+  *
+  * @param[in] src     Source array handle
+  * @param[in] dst     Destination array handle
+  * @return            Zero on success
+  */
+int DALEC_Copy(const DALEC_Array_handle * src, const DALEC_Array_handle * dst)
+{
+    int rc;
+
+    rc = DALECI_Check_conformable(src, dst);
+    if (rc != DALEC_SUCCESS) return rc;
+    if (src == dst) {
+        return DALEC_SUCCESS;
+    }
+
+    rc = DALEC_Sync(src);
+    if (rc != DALEC_SUCCESS) return rc;
+    rc = DALEC_Sync(dst);
+    if (rc != DALEC_SUCCESS) return rc;
+
+    const size_t n = DALECI_Local_count(dst);
+    if (n > 0) {
+        DALECI_View vs, vd;
+        rc = DALECI_Access_block(dst, (void**)&vd.ptr, vd.ld);
+        if (rc != DALEC_SUCCESS) return rc;
+
+        /* straight into the local block, with no staging */
+        if (DALECI_Same_distribution(src, dst)) {
+            rc = DALECI_Access_block(src, (void**)&vs.ptr, vs.ld);
+            if (rc != DALEC_SUCCESS) return rc;
+
+            int type_size = 0;
+            MPI_Type_size(dst->type, &type_size);
+            const DALECI_View * views[2] = {&vs, &vd};
+            const size_t run = DALECI_Run_length(dst, 2, views);
+            for (size_t r=0; r<n/run; r++) {
+                memcpy(DALECI_Run(dst, &vd, r, run, type_size), DALECI_Run(dst, &vs, r, run, type_size), run * type_size);
+            }
+
+            rc = DALECI_Release_block(src, 0);
+            if (rc != DALEC_SUCCESS) return rc;
+        } else {
+            rc = DALECI_Local_fetch(src, dst, vd.ptr, vd.ld);
+            if (rc != DALEC_SUCCESS) return rc;
+        }
+
+        rc = DALECI_Release_block(dst, 1);
+        if (rc != DALEC_SUCCESS) return rc;
+    }
+
+    return DALEC_Sync(dst);
+}
+
+/* -- begin weak symbols block -- */
+#if defined(HAVE_PRAGMA_WEAK)
+#  pragma weak DALEC_Add = PDALEC_Add
+#elif defined(HAVE_PRAGMA_HP_SEC_DEF)
+#  pragma _HP_SECONDARY_DEF PDALEC_Add DALEC_Add
+#elif defined(HAVE_PRAGMA_CRI_DUP)
+#  pragma _CRI duplicate DALEC_Add as PDALEC_Add
+#elif defined(HAVE_WEAK_ATTRIBUTE)
+int DALEC_Add(const void * alpha, const DALEC_Array_handle * a, const void * beta, const DALEC_Array_handle * b,
+              const DALEC_Array_handle * c) __attribute__ ((weak, alias("PDALEC_Add")));
+#else
+#define DALEC_Add PDALEC_Add
+#endif
+/* -- end weak symbols block -- */
+
+/** Compute c = alpha*a + beta*b element-wise.  c may be a or b.  Collective.
+  *
+  * @param[in] alpha   Scale factor of a, of the type of the arrays
+  * @param[in] a       Array handle
+  * @param[in] beta    Scale factor of b, of the type of the arrays
+  * @param[in] b       Array handle
+  * @param[in] c       Array handle of the result
+  * @return            Zero on success
+  */
+int DALEC_Add(const void * alpha, const DALEC_Array_handle * a, const void * beta, const DALEC_Array_handle * b,
+              const DALEC_Array_handle * c)
+{
+    int rc;
+
+    if (alpha == NULL || beta == NULL) {
+        DALECI_Error("alpha (%p) or beta (%p) is a null pointer", alpha, beta);
+        return DALEC_INPUT_ERROR;
+    }
+    rc = DALECI_Check_conformable(a, c);
+    if (rc != DALEC_SUCCESS) return rc;
+    rc = DALECI_Check_conformable(b, c);
+    if (rc != DALEC_SUCCESS) return rc;
+
+    return DALECI_Local_axpby(alpha, a, beta, b, c);
+}
+
+/* -- begin weak symbols block -- */
+#if defined(HAVE_PRAGMA_WEAK)
+#  pragma weak DALEC_Dot = PDALEC_Dot
+#elif defined(HAVE_PRAGMA_HP_SEC_DEF)
+#  pragma _HP_SECONDARY_DEF PDALEC_Dot DALEC_Dot
+#elif defined(HAVE_PRAGMA_CRI_DUP)
+#  pragma _CRI duplicate DALEC_Dot as PDALEC_Dot
+#elif defined(HAVE_WEAK_ATTRIBUTE)
+int DALEC_Dot(const DALEC_Array_handle * a, const DALEC_Array_handle * b, void * result)
+    __attribute__ ((weak, alias("PDALEC_Dot")));
+#else
+#define DALEC_Dot PDALEC_Dot
+#endif
+/* -- end weak symbols block -- */
+
+/** Compute the sum of a[i]*b[i] over all elements.  Complex elements are
+  * not conjugated.  Collective, and the result is the same everywhere.
+  *
+  * @param[in]  a      Array handle
+  * @param[in]  b      Array handle
+  * @param[out] result Sum, of the type of the arrays
+  * @return            Zero on success
+  */
+int DALEC_Dot(const DALEC_Array_handle * a, const DALEC_Array_handle * b, void * result)
+{
+    int rc;
+
+    rc = DALECI_Check_conformable(a, b);
+    if (rc != DALEC_SUCCESS) return rc;
+    if (result == NULL) {
+        DALECI_Error("result is a null pointer");
+        return DALEC_INPUT_ERROR;
+    }
+
+    rc = DALEC_Sync(a);
+    if (rc != DALEC_SUCCESS) return rc;
+    if (b != a) {
+        rc = DALEC_Sync(b);
+        if (rc != DALEC_SUCCESS) return rc;
+    }
+
+    /* an empty block contributes a zero of the right type */
+    rc = DALECI_Dot(a->type, 0, NULL, NULL, result);
+    if (rc != DALEC_SUCCESS) return rc;
+
+    const size_t n = DALECI_Local_count(a);
+    if (n > 0) {
+        DALECI_View va, vb;
+        rc = DALECI_Local_view(a, a, &va);
+        if (rc != DALEC_SUCCESS) return rc;
+        rc = DALECI_Local_view(b, a, &vb);
+        if (rc != DALEC_SUCCESS) return rc;
+
+        int type_size = 0;
+        MPI_Type_size(a->type, &type_size);
+        const DALECI_View * views[2] = {&va, &vb};
+        const size_t run = DALECI_Run_length(a, 2, views);
+        char partial[2*sizeof(double)];
+        for (size_t r=0; r<n/run; r++) {
+            rc = DALECI_Dot(a->type, run, DALECI_Run(a, &va, r, run, type_size), DALECI_Run(a, &vb, r, run, type_size), partial);
+            if (rc != DALEC_SUCCESS) return rc;
+            rc = MPI_Reduce_local(partial, result, 1, a->type, MPI_SUM);
+            DALECI_Check_MPI(__func__, "MPI_Reduce_local", rc);
+        }
+
+        DALECI_Staging_put(a->staging, vb.staging);
+    }
+
+    rc = MPI_Allreduce(MPI_IN_PLACE, result, 1, a->type, MPI_SUM, a->comm);
+    DALECI_Check_MPI(__func__, "MPI_Allreduce", rc);
+
+    return DALEC_SUCCESS;
+}
+
+/* -- begin weak symbols block -- */
+#if defined(HAVE_PRAGMA_WEAK)
+#  pragma weak DALEC_Norm2 = PDALEC_Norm2
+#elif defined(HAVE_PRAGMA_HP_SEC_DEF)
+#  pragma _HP_SECONDARY_DEF PDALEC_Norm2 DALEC_Norm2
+#elif defined(HAVE_PRAGMA_CRI_DUP)
+#  pragma _CRI duplicate DALEC_Norm2 as PDALEC_Norm2
+#elif defined(HAVE_WEAK_ATTRIBUTE)
+int DALEC_Norm2(const DALEC_Array_handle * h, double * result) __attribute__ ((weak, alias("PDALEC_Norm2")));
+#else
+#define DALEC_Norm2 PDALEC_Norm2
+#endif
+/* -- end weak symbols block -- */
+
+/** Compute the Euclidean norm of an array, in double precision.
+  * Collective, and the result is the same everywhere.
+  *
+  * @param[in]  h      Array handle
+  * @param[out] result Norm
+  * @return            Zero on success
+  */
+int DALEC_Norm2(const DALEC_Array_handle * h, double * result)
+{
+    int rc;
+
+    if (h == NULL || result == NULL) {
+        DALECI_Error("h (%p) or result (%p) is a null pointer", h, result);
+        return DALEC_INPUT_ERROR;
+    }
+
+    rc = DALEC_Sync(h);
+    if (rc != DALEC_SUCCESS) return rc;
+
+    double sum = 0;
+    const size_t n = DALECI_Local_count(h);
+    if (n > 0) {
+        DALECI_View v;
+        rc = DALECI_Local_view(h, h, &v);
+        if (rc != DALEC_SUCCESS) return rc;
+
+        int type_size = 0;
+        MPI_Type_size(h->type, &type_size);
+        const DALECI_View * views[1] = {&v};
+        const size_t run = DALECI_Run_length(h, 1, views);
+        for (size_t r=0; r<n/run; r++) {
+            double partial;
+            rc = DALECI_Sumsq(h->type, run, DALECI_Run(h, &v, r, run, type_size), &partial);
+            if (rc != DALEC_SUCCESS) return rc;
+            sum += partial;
+        }
+    }
+
+    rc = MPI_Allreduce(MPI_IN_PLACE, &sum, 1, MPI_DOUBLE, MPI_SUM, h->comm);
+    DALECI_Check_MPI(__func__, "MPI_Allreduce", rc);
+
+    *result = sqrt(sum);
+
+    return DALEC_SUCCESS;
+}
@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2014. See COPYRIGHT in top-level directory.
+ */
+
+#include <dalec.h>
+#include <dalec_guts.h>
+#include <debug.h>
+
+/* Atomics on single elements use the accumulate-class RMA operations of the
+ * window of the array, so they are atomic with respect to each other and to
+ * DALEC_Acc, and they never take a lock. */
+
+/** Issue one atomic operation on an element and wait for its result.
+  *
+  * @param[in]  h       Array handle
+  * @param[in]  idx     Global index of the element
+  * @param[in]  origin  Operand, or the new value for compare-and-swap
+  * @param[in]  compare Value to compare against, or NULL for fetch-and-op
+  * @param[out] result  Value of the element before the operation
+  * @param[in]  op      Operation for fetch-and-op
+  * @return             Zero on success
+  */
+static int DALECI_Atomic(const DALEC_Array_handle * h, const size_t idx[],
+                         const void * origin, const void * compare, void * result, MPI_Op op)
+{
+    int rc; /* MPI return code */
+
+    int target;
+    size_t offset;
+    rc = DALEC_Locate(h, idx, &target, &offset);
+    if (rc != DALEC_SUCCESS) return rc;
+
+    /* queued updates to the owner come first, as do puts in flight there */
+    if (h->aggregate != NULL) {
+        rc = DALECI_Aggregate_flush_target(h, target);
+        if (rc != DALEC_SUCCESS) return rc;
+    }
+    rc = DALECI_Dirty_order(h, target, DALECI_OP_ACC);
+    if (rc != DALEC_SUCCESS) return rc;
+
+    DALECI_Dbg_print(DEBUG_CAT_RMA, "target = %d offset = %zu\n", target, offset);
+
+    if (compare == NULL) {
+        rc = MPI_Fetch_and_op(origin, result, h->type, target, DALECI_Target_disp(h, target, offset), op, h->win);
+        DALECI_Check_MPI(__func__, "MPI_Fetch_and_op", rc);
+    } else {
+        rc = MPI_Compare_and_swap(origin, compare, result, h->type, target, DALECI_Target_disp(h, target, offset), h->win);
+        DALECI_Check_MPI(__func__, "MPI_Compare_and_swap", rc);
+    }
+
+    /* the result is needed now, and flushing the target completes the
+     * update there as well */
+    DALECI_Dirty_mark(h, target, DALECI_OP_ACC);
+    return DALECI_Dirty_flush_target(h, target);
+}
+
+/* -- begin weak symbols block -- */
+#if defined(HAVE_PRAGMA_WEAK)
+#  pragma weak DALEC_Fetch_and_op = PDALEC_Fetch_and_op
+#elif defined(HAVE_PRAGMA_HP_SEC_DEF)
+#  pragma _HP_SECONDARY_DEF PDALEC_Fetch_and_op DALEC_Fetch_and_op
+#elif defined(HAVE_PRAGMA_CRI_DUP)
+#  pragma _CRI duplicate DALEC_Fetch_and_op as PDALEC_Fetch_and_op
+#elif defined(HAVE_WEAK_ATTRIBUTE)
+int DALEC_Fetch_and_op(const DALEC_Array_handle * h, const size_t idx[], const void * value, void * result, MPI_Op op)
+    __attribute__ ((weak, alias("PDALEC_Fetch_and_op")));
+#else
+#define DALEC_Fetch_and_op PDALEC_Fetch_and_op
+#endif
+/* -- end weak symbols block -- */
+
+/** Atomically combine a value into an element and return its previous
+  * value.  The update is complete at the owner on return.
+  *
+  * @param[in]  h      Array handle
+  * @param[in]  idx    Global index of the element
+  * @param[in]  value  Operand, of the type of the array (ignored for MPI_NO_OP)
+  * @param[out] result Value of the element before the operation
+  * @param[in]  op     Predefined MPI reduction, MPI_REPLACE or MPI_NO_OP
+  * @return            Zero on success
+  */
+int DALEC_Fetch_and_op(const DALEC_Array_handle * h, const size_t idx[], const void * value, void * result, MPI_Op op)
+{
+    if (h==NULL || idx==NULL || result==NULL || (value==NULL && op!=MPI_NO_OP)) {
+        DALECI_Error("h (%p), idx (%p), value (%p) or result (%p) is a null pointer", h, idx, value, result);
+        return DALEC_INPUT_ERROR;
+    }
+    return DALECI_Atomic(h, idx, value, NULL, result, op);
+}
+
+/* -- begin weak symbols block -- */
+#if defined(HAVE_PRAGMA_WEAK)
+#  pragma weak DALEC_Compare_and_swap = PDALEC_Compare_and_swap
+#elif defined(HAVE_PRAGMA_HP_SEC_DEF)
+#  pragma _HP_SECONDARY_DEF PDALEC_Compare_and_swap DALEC_Compare_and_swap
+#elif defined(HAVE_PRAGMA_CRI_DUP)
+#  pragma _CRI duplicate DALEC_Compare_and_swap as PDALEC_Compare_and_swap
+#elif defined(HAVE_WEAK_ATTRIBUTE)
+int DALEC_Compare_and_swap(const DALEC_Array_handle * h, const size_t idx[], const void * value, const void * compare, void * result)
+    __attribute__ ((weak, alias("PDALEC_Compare_and_swap")));
+#else
+#define DALEC_Compare_and_swap PDALEC_Compare_and_swap
+#endif
+/* -- end weak symbols block -- */
+
+/** Atomically replace an element with value if it equals compare, and
+  * return its previous value.  Only integer, logical and byte arrays are
+  * supported, as for MPI_Compare_and_swap.
+  *
+  * @param[in]  h       Array handle
+  * @param[in]  idx     Global index of the element
+  * @param[in]  value   New value
+  * @param[in]  compare Value the element must have to be replaced
+  * @param[out] result  Value of the element before the operation
+  * @return             Zero on success
+  */
+int DALEC_Compare_and_swap(const DALEC_Array_handle * h, const size_t idx[], const void * value, const void * compare, void * result)
+{
+    if (h==NULL || idx==NULL || value==NULL || compare==NULL || result==NULL) {
+        DALECI_Error("h (%p), idx (%p), value (%p), compare (%p) or result (%p) is a null pointer",
+                     h, idx, value, compare, result);
+        return DALEC_INPUT_ERROR;
+    }
+    return DALECI_Atomic(h, idx, value, compare, result, MPI_NO_OP);
+}
+
+/* -- begin weak symbols block -- */
+#if defined(HAVE_PRAGMA_WEAK)
+#  pragma weak DALEC_Read_inc = PDALEC_Read_inc
+#elif defined(HAVE_PRAGMA_HP_SEC_DEF)
+#  pragma _HP_SECONDARY_DEF PDALEC_Read_inc DALEC_Read_inc
+#elif defined(HAVE_PRAGMA_CRI_DUP)
+#  pragma _CRI duplicate DALEC_Read_inc as PDALEC_Read_inc
+#elif defined(HAVE_WEAK_ATTRIBUTE)
+int DALEC_Read_inc(const DALEC_Array_handle * h, const size_t idx[], long inc, long * value)
+    __attribute__ ((weak, alias("PDALEC_Read_inc")));
+#else
+#define DALEC_Read_inc PDALEC_Read_inc
+#endif
+/* -- end weak symbols block -- */
+
+/** Atomically add inc to an element of an integer array and return its
+  * previous value, like NGA_Read_inc.
+  *
+  * @param[in]  h      Array handle of an MPI_INT, MPI_LONG or MPI_LONG_LONG array
+  * @param[in]  idx    Global index of the element
+  * @param[in]  inc    Increment
+  * @param[out] value  Value of the element before the increment
+  * @return            Zero on success
+  */
+int DALEC_Read_inc(const DALEC_Array_handle * h, const size_t idx[], long inc, long * value)
+{
+    int rc;
+
+    if (h==NULL || idx==NULL || value==NULL) {
+        DALECI_Error("h (%p), idx (%p) or value (%p) is a null pointer", h, idx, value);
+        return DALEC_INPUT_ERROR;
+    }
+
+    if (h->type == MPI_INT) {
+        int i = (int)inc, r;
+        rc = DALECI_Atomic(h, idx, &i, NULL, &r, MPI_SUM);
+        *value = r;
+    } else if (h->type == MPI_LONG) {
+        rc = DALECI_Atomic(h, idx, &inc, NULL, value, MPI_SUM);
+    } else if (h->type == MPI_LONG_LONG) {
+        long long i = inc, r;
+        rc = DALECI_Atomic(h, idx, &i, NULL, &r, MPI_SUM);
+        *value = (long)r;
+    } else {
+        DALECI_Error("array type is not MPI_INT, MPI_LONG or MPI_LONG_LONG");
+        return DALEC_INPUT_ERROR;
+    }
+
+    return rc;
+}
@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2014. See COPYRIGHT in top-level directory.
+ */
+
+#include <dalec.h>
+#include <dalec_guts.h>
+#include <debug.h>
+
+/* The cost model of DALEC_Grid_cost.  Every term is a function of the
+ * extents of the largest local block, which follow from pedims as in
+ * DALEC_Create_array, so the search over grids needs no handle.  The grids
+ * searched keep the number of blocks that ddb chose, and the number along
+ * every dimension with a fixed block size, and deal the rest out in every
+ * possible way.  With at most DALEC_ARRAY_MAX_DIM dimensions there are few
+ * enough of those to try them all. */
+
+/** Whether the descriptor asks for the cost model.
+  *
+  * @return            One if any weight is nonzero, zero otherwise
+  */
+int DALECI_Grid_weighted(const DALEC_Array_descriptor * d)
+{
+    return d->cost.imbalance != 0 || d->cost.halo != 0 || d->cost.panel != 0 || d->cost.owners != 0;
+}
+
+/* Largest extent of a local block along dimension i, and the length of the
+ * blocks along it, on a grid of p coordinates. */
+static void DALECI_Grid_extent(const DALEC_Array_descriptor * d, int i, size_t p, size_t * extent, size_t * block)
+{
+    const size_t n = d->dims[i], nb = d->blks[i];
+    if (d->cyclic) {
+        const size_t b = (nb > 0) ? nb : (n + p - 1) / p;
+        const size_t nblocks = (n + b - 1) / b;
+        *extent = (nblocks + p - 1) / p * b;
+        *block  = b;
+    } else {
+        const size_t q = (n + p - 1) / p;
+        *extent = (nb > q) ? nb : q;
+        *block  = *extent;
+    }
+    if (*extent > n) *extent = n;
+}
+
+/** Evaluate the cost model on a grid.
+  *
+  * @param[in]  d      Array descriptor
+  * @param[in]  np     Number of ranks
+  * @param[in]  pedims Number of grid coordinates along each dimension
+  * @return            Cost of the grid
+  */
+static double DALECI_Grid_cost(const DALEC_Array_descriptor * d, int np, const ssize_t pedims[])
+{
+    const int ndim = d->ndim;
+
+    size_t extent[DALEC_ARRAY_MAX_DIM], block[DALEC_ARRAY_MAX_DIM];
+    double local = 1, total = 1;
+    for (int i=0; i<ndim; i++) {
+        DALECI_Grid_extent(d, i, pedims[i], &extent[i], &block[i]);
+        local *= extent[i];
+        total *= d->dims[i];
+    }
+
+    double imbalance = local * np / total - 1;
+    double halo = 0, panel = 0, owners = 1;
+    for (int i=0; i<ndim; i++) {
+        double face = 1;
+        for (int j=0; j<ndim; j++) {
+            if (j != i) face *= extent[j];
+        }
+        if (pedims[i] > 1 || d->periodic[i]) {
+            halo += 2 * face * ((d->ghosts[i] > 0) ? d->ghosts[i] : 1);
+        }
+        panel += face * d->dims[i];
+
+        /* a patch of s elements spans 1 + (s-1)/b blocks on average */
+        const size_t s = (d->cost.patch[i] > 0 && d->cost.patch[i] < d->dims[i]) ? d->cost.patch[i] : d->dims[i];
+        const double spans = 1 + (double)(s - 1) / block[i];
+        owners *= (spans < pedims[i]) ? spans : pedims[i];
+    }
+
+    return d->cost.imbalance * imbalance + d->cost.halo * halo + d->cost.panel * panel + d->cost.owners * owners;
+}
+
+/* Deal the p blocks that are left to the free dimensions from i on, and
+ * keep the cheapest grid in best. */
+static void DALECI_Grid_deal(const DALEC_Array_descriptor * d, int np, int i, ssize_t p, ssize_t grid[],
+                             ssize_t best[], double * best_cost)
+{
+    while (i < d->ndim && d->blks[i] > 0) i++;
+
+    if (i == d->ndim) {
+        if (p != 1) return;
+        const double cost = DALECI_Grid_cost(d, np, grid);
+        if (cost < *best_cost) {
+            *best_cost = cost;
+            for (int j=0; j<d->ndim; j++) best[j] = grid[j];
+        }
+        return;
+    }
+
+    for (ssize_t f=1; f<=p/f; f++) {
+        if (p % f != 0) continue;
+        grid[i] = f;
+        DALECI_Grid_deal(d, np, i+1, p / f, grid, best, best_cost);
+        if (f != p / f) {
+            grid[i] = p / f;
+            DALECI_Grid_deal(d, np, i+1, f, grid, best, best_cost);
+        }
+    }
+}
+
+/** Replace the grid from ddb with the one of least cost with as many
+  * blocks and the same number along dimensions of a fixed block size.
+  * The grid from ddb wins ties.  Local, but deterministic.
+  *
+  * @param[in]     d      Array descriptor
+  * @param[in]     np     Number of ranks
+  * @param[in,out] pedims Number of grid coordinates along each dimension
+  */
+void DALECI_Grid_search(const DALEC_Array_descriptor * d, int np, ssize_t pedims[])
+{
+    ssize_t grid[DALEC_ARRAY_MAX_DIM], best[DALEC_ARRAY_MAX_DIM];
+    ssize_t free_blocks = 1;
+    for (int i=0; i<d->ndim; i++) {
+        grid[i] = best[i] = pedims[i];
+        if (d->blks[i] == 0) free_blocks *= pedims[i];
+    }
+
+    const double ddb_cost = DALECI_Grid_cost(d, np, pedims);
+    double best_cost = ddb_cost;
+    DALECI_Grid_deal(d, np, 0, free_blocks, grid, best, &best_cost);
+
+    DALECI_Dbg_print(DEBUG_CAT_ARRAY_DIST, "grid cost = %g, ddb grid cost = %g\n", best_cost, ddb_cost);
+    for (int i=0; i<d->ndim; i++) {
+        DALECI_Dbg_print(DEBUG_CAT_ARRAY_DIST, "dim %d: ddb pedims = %zd, cost model pedims = %zd\n",
+                         i, pedims[i], best[i]);
+        pedims[i] = best[i];
+    }
+}
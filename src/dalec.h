@@ -31,26 +31,159 @@ enum {
 
 #define DALEC_ARRAY_MAX_DIM 4
 
+/* ghosts[i] cells on each side of dimension i surround the local block and
+ * are refreshed from the neighbors by DALEC_Update_ghosts.  Along a
+ * periodic dimension the ghosts of the first and last blocks wrap around.
+ * With cyclic set, the array is block-cyclic with blocks of blks[i]
+ * (ceil(dims[i]/pedims[i]) if zero) dealt round-robin over the grid, as in
+ * ScaLAPACK; such arrays have no ghost cells.
+ * With dynamic set, the memory of the array is attached to a dynamic window,
+ * so that DALEC_Resize_array can change dims later; such arrays are neither
+ * block-cyclic nor irregular.
+ * cost weighs what the process grid should minimize; see DALEC_Grid_cost. */
+
+/* Weights of a cost model for the process grid.  If any weight is nonzero,
+ * the grid is the one of least
+ *   imbalance * (largest local block / average local block - 1)
+ * + halo      * (elements on the faces of the largest local block that
+ *                border another block, max(ghosts[i],1) deep)
+ * + panel     * (elements of the slabs through the largest local block
+ *                along each dimension, which SUMMA broadcasts)
+ * + owners    * (owners of a patch of patch[i] elements along dimension i,
+ *                or all of it if patch[i] is zero)
+ * among the grids of as many blocks as ddb chooses, with the same number
+ * of blocks along dimensions with a fixed blks[i].  Otherwise ddb alone
+ * chooses the grid. */
+
+typedef struct DALEC_Grid_cost {
+    double imbalance;
+    double halo;
+    double panel;
+    double owners;
+    size_t patch[DALEC_ARRAY_MAX_DIM];
+} DALEC_Grid_cost;
+
 typedef struct DALEC_Array_descriptor {
     MPI_Comm comm;
     MPI_Datatype type;
     int ndim;
     size_t dims[DALEC_ARRAY_MAX_DIM];
     size_t blks[DALEC_ARRAY_MAX_DIM];
+    size_t ghosts[DALEC_ARRAY_MAX_DIM];
+    int periodic[DALEC_ARRAY_MAX_DIM];
+    int cyclic;
+    int dynamic;
+    DALEC_Grid_cost cost;
     char * name;
 } DALEC_Array_descriptor;
 
+/* Internal state that is not part of the ABI */
+
+struct DALECI_Aggregate_s;
+struct DALECI_Shm_s;
+struct DALECI_Dirty_s;
+struct DALECI_Staging_s;
+struct DALECI_Halo_s;
+struct DALECI_Window_s;
+struct DALECI_Dynamic_s;
+
+/* The process grid is row-major in the ranks of comm, i.e. the last grid
+ * dimension varies fastest.  Ranks beyond the product of pedims own nothing.
+ * comm is the communicator of the descriptor, with its ranks reordered so
+ * that the ranks of a node own a box of blocks if DALEC_NODE_GRID is set.
+ * Local blocks are stored row-major as well.
+ * The distribution is closed-form, with O(ndim) metadata: along dimension i,
+ * grid coordinate c owns blocksizes[i] + (c < remainders[i]) indices starting
+ * at c*blocksizes[i] + min(c, remainders[i]), clipped to dims[i].
+ * An irregular dimension (DALEC_Create_array_irreg) has instead the
+ * pedims[i]+1 block boundaries in irreg[i], ending with dims[i]; irreg[i]
+ * is NULL for regular dimensions.
+ * A block-cyclic array (cyclic) is cut into blocks of blocksizes[i] instead,
+ * and block s is owned by grid coordinate s % pedims[i], which stores its
+ * blocks in order, so the local block is ScaLAPACK's local matrix.
+ * In memory every block is padded with ghosts[i] cells on both sides of
+ * dimension i, on every rank, so the window of an owner holds
+ * prod(extent[i] + 2*ghosts[i]) elements.
+ * base is the padded local block in the window, for DALEC_Access.  The
+ * arrays of DALEC_Create_arrays share a window, in which the padded block of
+ * every rank starts disp elements into its memory; disp is zero otherwise.
+ * A dynamic array keeps the addresses of the blocks of all ranks in dynamic. */
+
 typedef struct DALEC_Array_handle {
     MPI_Win win;
+    MPI_Comm comm;
     MPI_Datatype type;
     int ndim;
     size_t dims[DALEC_ARRAY_MAX_DIM];
     size_t blocksizes[DALEC_ARRAY_MAX_DIM];
+    int pedims[DALEC_ARRAY_MAX_DIM];
+    int coords[DALEC_ARRAY_MAX_DIM];
+    size_t local_lo[DALEC_ARRAY_MAX_DIM];
+    size_t local_dims[DALEC_ARRAY_MAX_DIM];
+    size_t remainders[DALEC_ARRAY_MAX_DIM];
+    size_t ghosts[DALEC_ARRAY_MAX_DIM];
+    int periodic[DALEC_ARRAY_MAX_DIM];
+    size_t * irreg[DALEC_ARRAY_MAX_DIM];
+    int cyclic;
+    void * base;
+    MPI_Aint disp;
+    struct DALECI_Dynamic_s * dynamic;
+    struct DALECI_Aggregate_s * aggregate;
+    struct DALECI_Shm_s * shm;
+    struct DALECI_Dirty_s * dirty;
+    struct DALECI_Staging_s * staging;
+    struct DALECI_Halo_s * halo;
+    struct DALECI_Window_s * window;
 #if 0
     int win_keyval;
 #endif
 } DALEC_Array_handle;
 
+/* Handle for a nonblocking operation.  An operation may touch several
+ * owners, so it holds one MPI request per owner, and possibly a staging
+ * buffer taken from the pool of the array.  A completed request has
+ * count == 0. */
+
+typedef struct DALEC_Request {
+    int count;
+    MPI_Request * reqs;
+    struct DALECI_Staging_s * pool;
+    void * staging;
+} DALEC_Request;
+
+/* Dynamic scheduler that hands out the task ids [0,ntasks) in chunks.  The
+ * ids are split into shards, each with its own counter on a different rank,
+ * and every rank draws from the shard of its group of shard_ranks ranks
+ * before it helps with the others. */
+
+typedef struct DALEC_Taskpool {
+    DALEC_Array_handle counters;
+    long ntasks;
+    long min_chunk;
+    int nshards;
+    int shard_ranks;
+    int home;
+    int current;
+    int visited;
+    long seen;
+    long executed;
+} DALEC_Taskpool;
+
+/* Schedule that moves the contents of one array into another with a
+ * different distribution, with one MPI_Alltoallw over comm.  Rank p of
+ * comm gets sendcounts[p] (zero or one) instances of sendtypes[p] from
+ * the local block of the source, and likewise for the destination.  A
+ * schedule stays valid as long as both arrays exist. */
+
+typedef struct DALEC_Redistribution {
+    MPI_Comm comm;
+    int * sendcounts;
+    int * recvcounts;
+    int * displs;
+    MPI_Datatype * sendtypes;
+    MPI_Datatype * recvtypes;
+} DALEC_Redistribution;
+
 #ifndef _GENERATE_DALEC_PUBLIC_API_
 #define _GENERATE_DALEC_PUBLIC_API_
 
@@ -18,6 +18,71 @@ int   NAMESPACE(Finalize)(void);
 DALEC_NORETURN_PREFIX void  NAMESPACE(Error)(const char *msg, int code) DALEC_NORETURN_SUFFIX;
 
 int   NAMESPACE(Create_array)(const DALEC_Array_descriptor *, DALEC_Array_handle *);
+int   NAMESPACE(Create_array_irreg)(const DALEC_Array_descriptor *, const int nblock[], const size_t map[],
+                                    DALEC_Array_handle *);
+int   NAMESPACE(Create_arrays)(int n, const DALEC_Array_descriptor d[], DALEC_Array_handle h[]);
 int   NAMESPACE(Destroy_array)(DALEC_Array_handle *);
+int   NAMESPACE(Resize_array)(DALEC_Array_handle *, const size_t dims[]);
+int   NAMESPACE(Pool_trim)(MPI_Comm comm);
+
+int   NAMESPACE(Locate)(const DALEC_Array_handle *, const size_t idx[], int * rank, size_t * offset);
+int   NAMESPACE(Distribution)(const DALEC_Array_handle *, int rank, size_t lo[], size_t extents[]);
+int   NAMESPACE(Descinit)(const DALEC_Array_handle *, int ictxt, int desc[9]);
+
+int   NAMESPACE(Put)(const DALEC_Array_handle *, const size_t lo[], const size_t hi[], const void * buf, const size_t ld[]);
+int   NAMESPACE(Get)(const DALEC_Array_handle *, const size_t lo[], const size_t hi[], void * buf, const size_t ld[]);
+int   NAMESPACE(Acc)(const DALEC_Array_handle *, const size_t lo[], const size_t hi[], const void * buf, const size_t ld[], const void * alpha);
+
+int   NAMESPACE(NbPut)(const DALEC_Array_handle *, const size_t lo[], const size_t hi[], const void * buf, const size_t ld[], DALEC_Request *);
+int   NAMESPACE(NbGet)(const DALEC_Array_handle *, const size_t lo[], const size_t hi[], void * buf, const size_t ld[], DALEC_Request *);
+int   NAMESPACE(NbAcc)(const DALEC_Array_handle *, const size_t lo[], const size_t hi[], const void * buf, const size_t ld[], const void * alpha, DALEC_Request *);
+
+int   NAMESPACE(Scatter)(const DALEC_Array_handle *, size_t n, const size_t subs[], const void * buf);
+int   NAMESPACE(Gather)(const DALEC_Array_handle *, size_t n, const size_t subs[], void * buf);
+int   NAMESPACE(Scatter_acc)(const DALEC_Array_handle *, size_t n, const size_t subs[], const void * buf, const void * alpha);
+
+int   NAMESPACE(Fetch_and_op)(const DALEC_Array_handle *, const size_t idx[], const void * value, void * result, MPI_Op op);
+int   NAMESPACE(Compare_and_swap)(const DALEC_Array_handle *, const size_t idx[], const void * value, const void * compare, void * result);
+int   NAMESPACE(Read_inc)(const DALEC_Array_handle *, const size_t idx[], long inc, long * value);
+
+int   NAMESPACE(Update_ghosts)(const DALEC_Array_handle *, int corners);
+
+int   NAMESPACE(Fill)(const DALEC_Array_handle *, const void * value);
+int   NAMESPACE(Scale)(const DALEC_Array_handle *, const void * alpha);
+int   NAMESPACE(Copy)(const DALEC_Array_handle * src, const DALEC_Array_handle * dst);
+int   NAMESPACE(Add)(const void * alpha, const DALEC_Array_handle * a, const void * beta, const DALEC_Array_handle * b,
+                     const DALEC_Array_handle * c);
+int   NAMESPACE(Dot)(const DALEC_Array_handle * a, const DALEC_Array_handle * b, void * result);
+int   NAMESPACE(Norm2)(const DALEC_Array_handle *, double * result);
+int   NAMESPACE(Redistribute)(const DALEC_Array_handle * src, const DALEC_Array_handle * dst);
+int   NAMESPACE(Redistribute_plan)(const DALEC_Array_handle * src, const DALEC_Array_handle * dst,
+                                   DALEC_Redistribution * r);
+int   NAMESPACE(Redistribute_exec)(const DALEC_Array_handle * src, const DALEC_Array_handle * dst,
+                                   const DALEC_Redistribution * r);
+int   NAMESPACE(Redistribute_free)(DALEC_Redistribution * r);
+
+int   NAMESPACE(Gemm)(const void * alpha, const DALEC_Array_handle * a, const DALEC_Array_handle * b,
+                      const void * beta, const DALEC_Array_handle * c);
+
+int   NAMESPACE(Taskpool_create)(MPI_Comm comm, long ntasks, long min_chunk, DALEC_Taskpool *);
+int   NAMESPACE(Taskpool_next)(DALEC_Taskpool *, long * first, long * count);
+int   NAMESPACE(Taskpool_reset)(DALEC_Taskpool *);
+int   NAMESPACE(Taskpool_report)(const DALEC_Taskpool *, long executed[]);
+int   NAMESPACE(Taskpool_destroy)(DALEC_Taskpool *);
+
+int   NAMESPACE(Aggregate_begin)(DALEC_Array_handle *);
+int   NAMESPACE(Aggregate_flush)(DALEC_Array_handle *);
+int   NAMESPACE(Aggregate_end)(DALEC_Array_handle *);
+
+int   NAMESPACE(Access)(const DALEC_Array_handle *, const size_t lo[], const size_t hi[], void ** ptr, size_t ld[]);
+int   NAMESPACE(Release)(const DALEC_Array_handle *, const size_t lo[], const size_t hi[]);
+int   NAMESPACE(Release_update)(const DALEC_Array_handle *, const size_t lo[], const size_t hi[]);
+
+int   NAMESPACE(Fence)(const DALEC_Array_handle *);
+int   NAMESPACE(Sync)(const DALEC_Array_handle *);
+
+int   NAMESPACE(Wait)(DALEC_Request *);
+int   NAMESPACE(Test)(DALEC_Request *, int * flag);
+int   NAMESPACE(Waitall)(int count, DALEC_Request reqs[]);
 
 #undef NAMESPACE
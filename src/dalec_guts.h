@@ -21,6 +21,10 @@
 #include <string.h>
 #endif
 
+#if   HAVE_SYS_TYPES_H
+#include <sys/types.h>
+#endif
+
 #if   HAVE_STDINT_H
 #  include <stdint.h>
 #elif HAVE_INTTYPES_H
@@ -70,6 +74,26 @@
 
 enum DALECI_Op_e { DALECI_OP_PUT, DALECI_OP_GET, DALECI_OP_ACC };
 
+/* Ranks of an array that share memory with this process */
+
+struct DALECI_Shm_s {
+    MPI_Comm   comm;                    /* ranks of the array on this node              */
+    MPI_Win    win;                     /* shared-memory window holding the array       */
+    int        size;                    /* size of comm                                 */
+    int      * ranks;                   /* rank in the array comm of each node rank     */
+    void    ** bases;                   /* local block of each node rank                */
+};
+
+/* Memory of a dynamic array, attached to a window from MPI_Win_create_dynamic */
+
+struct DALECI_Dynamic_s {
+    MPI_Aint * addrs;                   /* address of the padded block of each rank     */
+    size_t     capacity;                /* bytes of memory attached at base             */
+    int        type_size;               /* size of an element                           */
+    size_t     blks[DALEC_ARRAY_MAX_DIM]; /* block sizes from the descriptor            */
+    int        fixed;                   /* MPI_Win_create at every resize instead       */
+};
+
 typedef struct {
     atomic_int    alive;                /* DALEC has been initialized but not finalized */
     int           verbose;              /* DALEC should produce extra status output     */
@@ -88,4 +112,242 @@ char * DALECI_Getenv(const char *varname);
 int    DALECI_Getenv_bool(const char *varname, int default_value);
 int    DALECI_Getenv_int(const char *varname, int default_value);
 
+/* Distribution of an array over its process grid (dist.c) */
+
+/** First index along dimension i owned by grid coordinate c. */
+static inline size_t DALECI_Block_lo(const DALEC_Array_handle * h, int i, size_t c)
+{
+    if (h->cyclic) {
+        const size_t lo = c * h->blocksizes[i];
+        return (lo < h->dims[i]) ? lo : h->dims[i];
+    }
+    if (h->irreg[i] != NULL) {
+        return h->irreg[i][(c < (size_t)h->pedims[i]) ? c : (size_t)h->pedims[i]];
+    }
+    const size_t q = h->blocksizes[i], r = h->remainders[i];
+    const size_t lo = c*q + (c < r ? c : r);
+    return (lo < h->dims[i]) ? lo : h->dims[i];
+}
+
+/** Number of indices along dimension i owned by grid coordinate c. */
+static inline size_t DALECI_Block_extent(const DALEC_Array_handle * h, int i, size_t c)
+{
+    if (h->cyclic) {
+        /* ScaLAPACK's NUMROC */
+        const size_t nb = h->blocksizes[i], p = h->pedims[i];
+        const size_t full = h->dims[i] / nb, extra = full % p;
+        return (full / p) * nb + ((c < extra) ? nb : (c == extra) ? h->dims[i] % nb : 0);
+    }
+    return DALECI_Block_lo(h, i, c+1) - DALECI_Block_lo(h, i, c);
+}
+
+/** Grid coordinate that owns index x < dims[i] along dimension i. */
+static inline int DALECI_Block_coord(const DALEC_Array_handle * h, int i, size_t x)
+{
+    if (h->cyclic) {
+        return (int)((x / h->blocksizes[i]) % h->pedims[i]);
+    }
+    if (h->irreg[i] != NULL) {
+        /* the last block that starts at or before x, which skips empty blocks */
+        const size_t * b = h->irreg[i];
+        int lo = 0, hi = h->pedims[i] - 1;
+        while (lo < hi) {
+            const int mid = lo + (hi - lo + 1) / 2;
+            if (b[mid] <= x) lo = mid;
+            else             hi = mid - 1;
+        }
+        return lo;
+    }
+    const size_t q = h->blocksizes[i], r = h->remainders[i];
+    /* the first r blocks have q+1 indices, the rest have q */
+    const size_t big = r*(q+1);
+    return (int)((x < big) ? x/(q+1) : r + (x-big)/q);
+}
+
+/** Extent along dimension i of the memory of the block of grid coordinate c,
+  * which includes the ghost cells. */
+static inline size_t DALECI_Block_padded(const DALEC_Array_handle * h, int i, size_t c)
+{
+    return DALECI_Block_extent(h, i, c) + 2*h->ghosts[i];
+}
+
+/* A segment is a maximal range of indices along a dimension that one grid
+ * coordinate owns and stores contiguously: the block of the coordinate, or
+ * one of its blocks if the array is block-cyclic.  Segment s along
+ * dimension i covers [Seg_lo(s), Seg_lo(s+1)). */
+
+/** First index of segment s along dimension i. */
+static inline size_t DALECI_Seg_lo(const DALEC_Array_handle * h, int i, size_t s)
+{
+    if (h->cyclic) {
+        const size_t lo = s * h->blocksizes[i];
+        return (lo < h->dims[i]) ? lo : h->dims[i];
+    }
+    return DALECI_Block_lo(h, i, s);
+}
+
+/** Segment that holds index x < dims[i] along dimension i. */
+static inline size_t DALECI_Seg_of(const DALEC_Array_handle * h, int i, size_t x)
+{
+    return h->cyclic ? x / h->blocksizes[i] : (size_t)DALECI_Block_coord(h, i, x);
+}
+
+/** Grid coordinate that owns segment s along dimension i. */
+static inline int DALECI_Seg_coord(const DALEC_Array_handle * h, int i, size_t s)
+{
+    return h->cyclic ? (int)(s % h->pedims[i]) : (int)s;
+}
+
+/** Position of index x along dimension i in the block of its owner,
+  * not counting the ghost cells. */
+static inline size_t DALECI_Local_index(const DALEC_Array_handle * h, int i, size_t x)
+{
+    if (h->cyclic) {
+        const size_t nb = h->blocksizes[i];
+        return (x / nb / h->pedims[i]) * nb + x % nb;
+    }
+    return x - DALECI_Block_lo(h, i, DALECI_Block_coord(h, i, x));
+}
+
+/** Number of segments along dimension i that grid coordinate c owns. */
+static inline size_t DALECI_Seg_count(const DALEC_Array_handle * h, int i, int c)
+{
+    if (h->cyclic) {
+        const size_t nb = h->blocksizes[i], p = h->pedims[i];
+        const size_t nseg = (h->dims[i] + nb - 1) / nb;
+        return ((size_t)c < nseg) ? (nseg - c + p - 1) / p : 0;
+    }
+    return 1;
+}
+
+/** Advance c to the next grid coordinate in [cfirst,clast], last dimension
+  * fastest.
+  *
+  * @return            Zero when all coordinates have been visited
+  */
+static inline int DALECI_Next_coord(int ndim, const int cfirst[], const int clast[], int c[])
+{
+    for (int i=ndim-1; i>=0; i--) {
+        if (c[i] < clast[i]) {
+            c[i]++;
+            return 1;
+        }
+        c[i] = cfirst[i];
+    }
+    return 0;
+}
+
+void   DALECI_Block_sizes(DALEC_Array_handle * h, const size_t blks[]);
+int    DALECI_Split_patch(const DALEC_Array_handle * h, const size_t lo[], const size_t hi[],
+                          int cfirst[], int clast[]);
+int    DALECI_Same_distribution(const DALEC_Array_handle * a, const DALEC_Array_handle * b);
+int    DALECI_Runs_type(int ndim, const int sizes[], const int nruns[], int * const starts[],
+                        int * const lens[], MPI_Datatype type, MPI_Datatype * newtype);
+
+/* Patch operations (patch.c) */
+
+int    DALECI_Check_patch(const DALEC_Array_handle * h, const size_t lo[], const size_t hi[],
+                          const void * buf, const size_t ld[]);
+int    DALECI_Patch_op(enum DALECI_Op_e op, const DALEC_Array_handle * h,
+                       const size_t lo[], const size_t hi[], void * buf, const size_t ld[],
+                       const void * alpha, DALEC_Request * req);
+
+/* Aggregation of small updates (aggregate.c) */
+
+int    DALECI_Aggregate_eligible(const DALEC_Array_handle * h, size_t elements);
+int    DALECI_Aggregate_enqueue(const DALEC_Array_handle * h, enum DALECI_Op_e op, int target, const void * buf,
+                                const int osizes[], const int ostarts[],
+                                const int tsizes[], const int tstarts[], const int subsizes[]);
+int    DALECI_Aggregate_flush_target(const DALEC_Array_handle * h, int target);
+int    DALECI_Aggregate_flush_all(const DALEC_Array_handle * h);
+
+/* Completion of updates in flight (sync.c) */
+
+int    DALECI_Dirty_create(DALEC_Array_handle * h);
+void   DALECI_Dirty_free(DALEC_Array_handle * h);
+int    DALECI_Dirty_order(const DALEC_Array_handle * h, int target, enum DALECI_Op_e op);
+void   DALECI_Dirty_mark(const DALEC_Array_handle * h, int target, enum DALECI_Op_e op);
+int    DALECI_Dirty_flush_target(const DALEC_Array_handle * h, int target);
+int    DALECI_Dirty_flush_all(const DALEC_Array_handle * h);
+
+/* Staging buffers (staging.c) */
+
+int    DALECI_Staging_create(DALEC_Array_handle * h);
+void   DALECI_Staging_free(DALEC_Array_handle * h);
+void * DALECI_Staging_get(struct DALECI_Staging_s * s, size_t bytes);
+void   DALECI_Staging_put(struct DALECI_Staging_s * s, void * ptr);
+
+/* Local kernels (kernels.c) */
+
+int    DALECI_Scale_is_one(MPI_Datatype type, const void * alpha);
+int    DALECI_Scale(MPI_Datatype type, size_t n, const void * alpha, const void * src, void * dst);
+int    DALECI_Fill(MPI_Datatype type, size_t n, const void * value, void * dst);
+int    DALECI_Axpby(MPI_Datatype type, size_t n, const void * alpha, const void * a,
+                    const void * beta, const void * b, void * c);
+int    DALECI_Dot(MPI_Datatype type, size_t n, const void * a, const void * b, void * result);
+int    DALECI_Sumsq(MPI_Datatype type, size_t n, const void * a, double * result);
+int    DALECI_Gemm(MPI_Datatype type, size_t m, size_t n, size_t k, const void * alpha,
+                   const void * a, size_t lda, const void * b, size_t ldb, void * c, size_t ldc);
+
+/* Ghost cells (ghosts.c) */
+
+int    DALECI_Halo_create(DALEC_Array_handle * h);
+void   DALECI_Halo_free(DALEC_Array_handle * h);
+
+/* Direct access to the local block (access.c) */
+
+int    DALECI_Access_block(const DALEC_Array_handle * h, void ** ptr, size_t ld[]);
+int    DALECI_Release_block(const DALEC_Array_handle * h, int update);
+
+/* Node-aware placement of ranks on the grid (topo.c) */
+
+int    DALECI_Node_comm(DALEC_Array_handle * h, MPI_Comm comm);
+
+/* Pool of the windows of destroyed arrays (pool.c) */
+
+int    DALECI_Window_get(DALEC_Array_handle * h, MPI_Aint bytes, int type_size, int use_shm, void * baseptr);
+void   DALECI_Window_share(DALEC_Array_handle * h, const DALEC_Array_handle * first);
+int    DALECI_Window_release(DALEC_Array_handle * h);
+int    DALECI_Pool_free_all(void);
+
+/* Arrays in dynamic windows (dynamic.c) */
+
+/** Displacement in the window of an array of element offset of the padded
+  * block of target, in bytes from its address in a dynamic window and in
+  * elements from disp otherwise. */
+static inline MPI_Aint DALECI_Target_disp(const DALEC_Array_handle * h, int target, size_t offset)
+{
+    if (h->dynamic != NULL) {
+        return MPI_Aint_add(h->dynamic->addrs[target], (MPI_Aint)offset * h->dynamic->type_size);
+    }
+    return h->disp + (MPI_Aint)offset;
+}
+
+int    DALECI_Dynamic_create(const DALEC_Array_descriptor * d, DALEC_Array_handle * h, MPI_Aint bytes,
+                             int type_size, void * baseptr);
+int    DALECI_Dynamic_free(DALEC_Array_handle * h);
+
+/* Shared-memory fast path (shm.c) */
+
+int    DALECI_Shm_allocate(DALEC_Array_handle * h, MPI_Aint bytes, int type_size, void * baseptr);
+int    DALECI_Shm_free(MPI_Win * win, struct DALECI_Shm_s * shm);
+void * DALECI_Shm_base(const DALEC_Array_handle * h, int target);
+int    DALECI_Shm_copy(const DALEC_Array_handle * h, enum DALECI_Op_e op, void * base, void * buf, int type_size,
+                       const int osizes[], const int ostarts[],
+                       const int tsizes[], const int tstarts[], const int subsizes[]);
+
+/* Process grid cost model (cost.c) */
+
+int    DALECI_Grid_weighted(const DALEC_Array_descriptor * d);
+void   DALECI_Grid_search(const DALEC_Array_descriptor * d, int np, ssize_t pedims[]);
+
+/* Process grid heuristics (ddb.c) */
+
+void ddb(ssize_t ndims, ssize_t ardims[], ssize_t npes, ssize_t blk[], ssize_t pedims[]);
+void ddb_ex(ssize_t ndims, ssize_t ardims[], ssize_t npes, double threshold, ssize_t blk[], ssize_t pedims[]);
+void ddb_h1(ssize_t ndims, ssize_t ardims[], ssize_t npes, double threshold, ssize_t blk[], ssize_t pedims[]);
+void ddb_h2(ssize_t ndims, ssize_t ardims[], ssize_t npes, double threshold, ssize_t bias, ssize_t blk[], ssize_t pedims[]);
+/* ddb, ddb_ex and ddb_h2 results are cached; this reports lookups answered from and missing the cache */
+void dd_cache_stats(size_t * hits, size_t * misses);
+
 #endif /* HAVE_DALEC_GUTS_H */
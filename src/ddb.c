@@ -30,6 +30,9 @@
 #if HAVE_MATH_H
 #   include <math.h>
 #endif
+#if HAVE_STRING_H
+#   include <string.h>
+#endif
 
 /*--
  *****************************************************************************
@@ -95,27 +98,188 @@ void ddb_h2( ssize_t ndims, ssize_t ardims[], ssize_t npes, double threshold,
  *-- specified by its argument list.
  *--
  *-- ddb_ap and dd_lk are specific to ddb_h1.
+ *--
+ *-- dd_factor, dd_divisors and dd_next_divisor work from the prime
+ *-- factorization of npes, found by trial division up to sqrt(npes),
+ *-- so that none of the heuristics loops over 1..npes.
  */
 
 void ddb_ap(ssize_t ndims, double qedims[], ssize_t ardims[], ssize_t pedims[], ssize_t npes, ssize_t npdivs, ssize_t pdivs[]);
 double dd_ev(ssize_t ndims,ssize_t ardims[], ssize_t pedims[]);
 ssize_t dd_lk(ssize_t * prt, ssize_t n, double key);
 void dd_su(ssize_t ndims, ssize_t ardims[], ssize_t pedims[], ssize_t blk[]);
+void dd_cache_stats(size_t * hits, size_t * misses);
+
+#define DD_MAXFACTORS 64  /* more than a ssize_t has prime factors */
+
+static ssize_t dd_factor(ssize_t n, ssize_t primes[]);
+static ssize_t * dd_divisors(ssize_t n, ssize_t * count);
+static ssize_t dd_next_divisor(ssize_t n, ssize_t lo);
+
+static void ddb_search(ssize_t ndims, ssize_t ardims[], ssize_t npes, ssize_t blk[], ssize_t pedims[]);
+static void ddb_ex_search(ssize_t ndims, ssize_t ardims[], ssize_t npes, double threshold,
+                          ssize_t blk[], ssize_t pedims[]);
+static void ddb_h2_search(ssize_t ndims, ssize_t ardims[], ssize_t npes, double threshold,
+                          ssize_t bias, ssize_t blk[], ssize_t pedims[]);
 
 /*---------------------------------------------------------------------------
+ *--
+ *-- ddb, ddb_ex and ddb_h2 are memoized: the result for a given argument
+ *-- list is computed once per process and afterwards copied out of a
+ *-- small table, see dd_cache_lookup below.
  *--
  *-- Dependencies:
  *--
- *-- ddb: ddb_h2, ddb_ex
- *-- ddb_ex: dd_ev, dd_su
- *-- ddb_h1: ddb_ap, dd_ev, ddb_ex, dd_lk, dd_su  & -lm
- *-- ddb_h2: dd_ev, ddb_ex, dd_su
+ *-- ddb: ddb_h2, ddb_ex, dd_next_divisor
+ *-- ddb_ex: dd_ev, dd_su, dd_divisors
+ *-- ddb_h1: ddb_ap, dd_ev, ddb_ex, dd_lk, dd_su, dd_divisors  & -lm
+ *-- ddb_h2: dd_ev, ddb_ex, dd_su, dd_factor
  *--
  ***************************************************************************/
 
 /* The threshold for switching to an exhaustive search*/
 /* UNUSED #define THRESHOLD -0.1 */
 
+
+/************************************************************************
+ *--
+ *--  The result cache. Every array creation calls ddb with the same few
+ *--  argument lists, and the searches above enumerate the divisors of npes
+ *--  and allocate scratch each time, so the results of ddb, ddb_ex and
+ *--  ddb_h2 are kept in a table of DD_CACHE_SIZE entries keyed on the
+ *--  heuristic and all of its inputs. When the table is full, the least
+ *--  recently used entry is replaced. Argument lists with more than
+ *--  DD_CACHE_MAXDIM dimensions are not cached.
+ *--
+ ************************************************************************/
+#define DD_CACHE_SIZE   64
+#define DD_CACHE_MAXDIM 8
+
+enum { DD_WRAPPER = 1, DD_EX, DD_H2 };
+
+typedef struct {
+    int     kind;                       /* DD_WRAPPER, DD_EX or DD_H2, 0 if unused */
+    ssize_t ndims;
+    ssize_t npes;
+    double  threshold;
+    ssize_t bias;
+    ssize_t ardims[DD_CACHE_MAXDIM];
+    ssize_t blkin[DD_CACHE_MAXDIM];     /* blk on input                             */
+    ssize_t blkout[DD_CACHE_MAXDIM];    /* blk on output                            */
+    ssize_t pedims[DD_CACHE_MAXDIM];
+    size_t  stamp;                      /* time of last use                         */
+} dd_cache_entry;
+
+static dd_cache_entry dd_cache[DD_CACHE_SIZE];
+static size_t dd_cache_clock  = 0;
+static size_t dd_cache_hits   = 0;
+static size_t dd_cache_misses = 0;
+
+static int dd_cache_match(const dd_cache_entry * e, int kind, ssize_t ndims, const ssize_t ardims[], ssize_t npes,
+                          double threshold, ssize_t bias, const ssize_t blk[])
+{
+    return e->kind == kind && e->ndims == ndims && e->npes == npes &&
+           e->threshold == threshold && e->bias == bias &&
+           memcmp(e->ardims, ardims, ndims * sizeof(ssize_t)) == 0 &&
+           memcmp(e->blkin, blk, ndims * sizeof(ssize_t)) == 0;
+}
+
+/*- Returns 1 and sets blk and pedims if the result is cached, 0 otherwise -*/
+static int dd_cache_lookup(int kind, ssize_t ndims, const ssize_t ardims[], ssize_t npes,
+                           double threshold, ssize_t bias, ssize_t blk[], ssize_t pedims[])
+{
+    int found = 0;
+    if (ndims<1 || ndims>DD_CACHE_MAXDIM) return 0;
+    #pragma omp critical (dd_cache)
+    {
+        for (int i=0; i<DD_CACHE_SIZE; i++) {
+            dd_cache_entry * e = &dd_cache[i];
+            if (dd_cache_match(e, kind, ndims, ardims, npes, threshold, bias, blk)) {
+                memcpy(blk,    e->blkout, ndims * sizeof(ssize_t));
+                memcpy(pedims, e->pedims, ndims * sizeof(ssize_t));
+                e->stamp = ++dd_cache_clock;
+                found = 1;
+                break;
+            }
+        }
+        if (found) dd_cache_hits++;
+        else       dd_cache_misses++;
+    }
+    return found;
+}
+
+/*- Records a result; blkin is blk as it was before the search -*/
+static void dd_cache_insert(int kind, ssize_t ndims, const ssize_t ardims[], ssize_t npes,
+                            double threshold, ssize_t bias, const ssize_t blkin[],
+                            const ssize_t blk[], const ssize_t pedims[])
+{
+    if (ndims<1 || ndims>DD_CACHE_MAXDIM) return;
+    /*- Failed searches zero pedims or blk, and are not worth remembering -*/
+    for (ssize_t i=0; i<ndims; i++) {
+        if (pedims[i]<1 || blk[i]<1) return;
+    }
+    #pragma omp critical (dd_cache)
+    {
+        dd_cache_entry * victim = &dd_cache[0];
+        for (int i=0; i<DD_CACHE_SIZE; i++) {
+            dd_cache_entry * e = &dd_cache[i];
+            if (dd_cache_match(e, kind, ndims, ardims, npes, threshold, bias, blkin)) {
+                victim = e;
+                break;
+            }
+            if (e->stamp < victim->stamp) victim = e;
+        }
+        victim->kind      = kind;
+        victim->ndims     = ndims;
+        victim->npes      = npes;
+        victim->threshold = threshold;
+        victim->bias      = bias;
+        memcpy(victim->ardims, ardims, ndims * sizeof(ssize_t));
+        memcpy(victim->blkin,  blkin,  ndims * sizeof(ssize_t));
+        memcpy(victim->blkout, blk,    ndims * sizeof(ssize_t));
+        memcpy(victim->pedims, pedims, ndims * sizeof(ssize_t));
+        victim->stamp = ++dd_cache_clock;
+    }
+}
+
+/*- Number of lookups that were and were not answered from the cache -*/
+void dd_cache_stats(size_t * hits, size_t * misses)
+{
+    #pragma omp critical (dd_cache)
+    {
+        *hits   = dd_cache_hits;
+        *misses = dd_cache_misses;
+    }
+}
+
+/*- Runs one of the searches through the cache. The inputs are copied
+ *- first since the searches may overwrite ardims and do overwrite blk. -*/
+#define DD_CACHED(kind, threshold, bias, search)                                    \
+    do {                                                                            \
+        ssize_t dd_ar[DD_CACHE_MAXDIM], dd_blk[DD_CACHE_MAXDIM];                    \
+        if (ndims<1 || ndims>DD_CACHE_MAXDIM) { search; return; }                   \
+        if (dd_cache_lookup(kind, ndims, ardims, npes, threshold, bias, blk, pedims)) return; \
+        memcpy(dd_ar,  ardims, ndims * sizeof(ssize_t));                            \
+        memcpy(dd_blk, blk,    ndims * sizeof(ssize_t));                            \
+        search;                                                                     \
+        dd_cache_insert(kind, ndims, dd_ar, npes, threshold, bias, dd_blk, blk, pedims); \
+    } while (0)
+
+void ddb(ssize_t ndims, ssize_t ardims[], ssize_t npes, ssize_t blk[], ssize_t pedims[])
+{
+    DD_CACHED(DD_WRAPPER, 0.0, 0, ddb_search(ndims, ardims, npes, blk, pedims));
+}
+
+void ddb_ex(ssize_t ndims, ssize_t ardims[], ssize_t npes, double threshold, ssize_t blk[], ssize_t pedims[])
+{
+    DD_CACHED(DD_EX, threshold, 0, ddb_ex_search(ndims, ardims, npes, threshold, blk, pedims));
+}
+
+void ddb_h2(ssize_t ndims, ssize_t ardims[], ssize_t npes, double threshold, ssize_t bias, ssize_t blk[], ssize_t pedims[])
+{
+    DD_CACHED(DD_H2, threshold, bias, ddb_h2_search(ndims, ardims, npes, threshold, bias, blk, pedims));
+}
+
 /************************************************************************
  *--
  *--  void ddb is a wrapper ontop of some load balancing heuristics. ddb
@@ -124,7 +288,7 @@ void dd_su(ssize_t ndims, ssize_t ardims[], ssize_t pedims[], ssize_t blk[]);
  *--  array dimensions. The resulting process grid also has ndims
  *--  dimensions but some of these can be degenerate.
  ************************************************************************/
-void ddb(ssize_t ndims, ssize_t ardims[], ssize_t npes, ssize_t blk[], ssize_t pedims[])
+static void ddb_search(ssize_t ndims, ssize_t ardims[], ssize_t npes, ssize_t blk[], ssize_t pedims[])
 {
     const double ddb_threshold = 0.1;
     const ssize_t ddb_bias = 0;
@@ -143,8 +307,7 @@ void ddb(ssize_t ndims, ssize_t ardims[], ssize_t npes, ssize_t blk[], ssize_t p
              sp = tp; tp = 1;
              pedims[i] = (ssize_t)sp;
           } else {
-             ssize_t j;
-             for (j=sp; j<tp&&(tp%j!=0); j++);
+             ssize_t j = dd_next_divisor(tp,sp);
              pedims[i] = (ssize_t)j;
              tp = tp / j;
           }
@@ -178,7 +341,7 @@ void ddb(ssize_t ndims, ssize_t ardims[], ssize_t npes, ssize_t blk[], ssize_t p
           if (pedims[j]<0) tardim[i++] = ardims[j];
        }
 
-       ddb_h2(count, tardim, tp, ddb_threshold, ddb_bias, tblk, tpedim);
+       ddb_h2_search(count, tardim, tp, ddb_threshold, ddb_bias, tblk, tpedim);
        /* ddb_h1(count, tardim, tp, ddb_threshold, tblk, tpedim); */
 
        for (ssize_t i=0, j=0; j<ndims; j++)
@@ -220,18 +383,25 @@ void ddb(ssize_t ndims, ssize_t ardims[], ssize_t npes, ssize_t blk[], ssize_t p
  *--  ddb_ex returns as soon as it has found a process distribution whose
  *--  load balance ratio is at least as large as the value of threshold.
  *--
- *--  This procedure allocates storage for 3*ndims+npes integers.
+ *--  The search only visits divisors of npes, and prunes a partial
+ *--  assignment as soon as it cannot match the best load balance ratio
+ *--  found so far: every factor of dd_ev is at most one, so the product
+ *--  over the axes assigned so far bounds that of any completion.
+ *--
+ *--  This procedure allocates storage for 4*ndims integers, ndims doubles
+ *--  and the divisors of npes.
  *--
  ************************************************************************/
-void ddb_ex( ssize_t ndims, ssize_t ardims[], ssize_t npes, double threshold,
-             ssize_t blk[], ssize_t pedims[])
+static void ddb_ex_search(ssize_t ndims, ssize_t ardims[], ssize_t npes, double threshold,
+                          ssize_t blk[], ssize_t pedims[])
 {
       ssize_t *tdims;
       ssize_t npdivs;
       ssize_t i, j, k;
       ssize_t bev;
       ssize_t pc, done;
-      ssize_t *stack;
+      ssize_t *stack, *didx;
+      double *bound;
       ssize_t *tard;
       ssize_t r, cev;
       double clb, blb;
@@ -263,46 +433,48 @@ void ddb_ex( ssize_t ndims, ssize_t ardims[], ssize_t npes, double threshold,
           }
       }
 
-      /*- Allocate memory for current solution -*/
-      tdims = calloc((ssize_t)ndims,sizeof(ssize_t));
+      /*- Allocate memory for the current solution, the recursion stack
+       *- and the position of each axis in the list of divisors -*/
+      tdims = calloc((size_t)ndims,3*sizeof(ssize_t));
       if (tdims==NULL) {
          fprintf(stderr,"ddb_ex: Memory allocation failed\n");
          for (ssize_t i=0; i<ndims; i++) blk[i] = 0;
+         free(tard);
          return;
       }
+      stack = tdims + ndims;
+      didx = tdims + 2*ndims;
 
-      /*- Allocate memory to hold divisors of npes -*/
-      npdivs = 1;
-      for (i=2;i<=npes;i++) if (npes%i==0) npdivs += 1;
-      ssize_t * pdivs = calloc((ssize_t)npdivs,sizeof(ssize_t));
-      if (pdivs==NULL) {
+      /*- Upper bounds on the load balance ratio of each partial solution -*/
+      bound = calloc((ssize_t)ndims,sizeof(double));
+      if (bound==NULL) {
          fprintf(stderr,"ddb_ex: Memory allocation failed\n");
          for (ssize_t i=0; i<ndims; i++) blk[i] = 0;
          free(tard);
+         free(tdims);
          return;
       }
 
-      /*- Allocate storage for the recursion stack -*/
-      stack = calloc((ssize_t)ndims,sizeof(ssize_t));
-      if (stack==NULL){
-         fprintf(stderr,"%s: %s\n","ddb_ex",
-             "memory allocation failed");
+      /*- Find all divisors of npes -*/
+      ssize_t * pdivs = dd_divisors(npes,&npdivs);
+      if (pdivs==NULL) {
+         fprintf(stderr,"ddb_ex: Memory allocation failed\n");
          for (ssize_t i=0; i<ndims; i++) blk[i] = 0;
          free(tard);
-         free(pdivs);
+         free(tdims);
+         free(bound);
          return;
       }
 
-      /*- Find all divisors of npes -*/
-      for (j=0,i=1;i<=npes;i++) if (npes%i==0) pdivs[j++] = i;
-
       /*- Pump priming the exhaustive search -*/
       blb = -1.0;
       bev = 1.0;
       for (ssize_t i=0; i<ndims; i++) bev *= tard[i];
       pedims[0]=npes; for (i=1;i<ndims;i++) pedims[i] = 1;
       tdims[0] = 0;
+      didx[0] = -1;
       stack[0] = npes;
+      bound[0] = 1.0;
       pc = 0;
       done = 0;
 
@@ -339,14 +511,22 @@ void ddb_ex( ssize_t ndims, ssize_t ardims[], ssize_t npes, double threshold,
               tdims[pc] = 0;
               pc -= 1;
            } else {
-	     /*- Increment the number of processes assigned to the current
-              *- array axis.
+	     /*- Move the current array axis to the next divisor of the
+              *- processes that remain. stack[pc] divides npes, so it is
+              *- in pdivs and ends the scan.
               */
-              for (tdims[pc]+=1; stack[pc]%tdims[pc]!=0; tdims[pc]+=1);
+              do didx[pc] += 1; while (stack[pc]%pdivs[didx[pc]]!=0);
+              tdims[pc] = pdivs[didx[pc]];
+
+	     /*- Skip this subtree when it cannot reach the best ratio -*/
+              double b = bound[pc]*dd_ev(1,&tard[pc],&tdims[pc]);
+              if (b<blb) continue;
+
               pc += 1;
-              stack[pc] = npes;
-              for (i=0;i<pc;i++) stack[pc] /= tdims[i];
+              stack[pc] = stack[pc-1]/tdims[pc-1];
+              bound[pc] = b;
               tdims[pc] = 0;
+              didx[pc] = -1;
            }
          }
       } while(!done);
@@ -354,8 +534,8 @@ void ddb_ex( ssize_t ndims, ssize_t ardims[], ssize_t npes, double threshold,
       dd_su(ndims,ardims,pedims,blk);
 
       free(tard);
-      free(stack);
       free(tdims);
+      free(bound);
       free(pdivs);
 }
 /************************************************************************
@@ -369,8 +549,8 @@ void ddb_ex( ssize_t ndims, ssize_t ardims[], ssize_t npes, double threshold,
  *-- If the value of objective function attained with this heuristic
  *-- is less than threshold then an exhaustive search is performed.
  *--
- *-- This procedure allocates storage for ndims ssize_ts and npes doubles and
- *-- may call ddb_ex.
+ *-- This procedure allocates storage for 2*ndims ssize_ts, ndims doubles and
+ *-- the divisors of npes, and may call ddb_ex.
  *--
  ************************************************************************/
 void ddb_h1(ssize_t ndims, ssize_t ardims[], ssize_t npes, double threshold, ssize_t blk[], ssize_t pedims[])
@@ -432,9 +612,7 @@ void ddb_h1(ssize_t ndims, ssize_t ardims[], ssize_t npes, double threshold, ssi
       }
 
       /*- Set up the search for a integer approximation the floating point solution -*/
-      npdivs = 1;
-      for (i=2;i<=npes;i++) if (npes%i==0) npdivs += 1;
-      ssize_t * pdivs = calloc((ssize_t)npdivs,sizeof(ssize_t));
+      ssize_t * pdivs = dd_divisors(npes,&npdivs);
       if (pdivs==NULL){
          fprintf(stderr,"%s: %s\n","split",
              "memory allocation failed");
@@ -445,10 +623,6 @@ void ddb_h1(ssize_t ndims, ssize_t ardims[], ssize_t npes, double threshold, ssi
       }
 
       /*- Compute the discreet approximation -*/
-      for (j=0,i=1;i<=npes;i++) {
-          if (npes%i==0) pdivs[j++] = i;
-      }
-
       ddb_ap(ndims,qedims,tard,pedims,npes,npdivs,pdivs);
 
       free(qedims);
@@ -508,7 +682,7 @@ void ddb_h1(ssize_t ndims, ssize_t ardims[], ssize_t npes, double threshold, ssi
 
       /*- Do an exhaustive search is the heuristic returns a solution 
        *- whose load balance ratio is less than the given threshold. -*/
-      if (blb<threshold) ddb_ex(ndims,tard,npes,threshold,blk,pedims);
+      if (blb<threshold) ddb_ex_search(ndims,tard,npes,threshold,blk,pedims);
 
       free(tard);
 
@@ -629,10 +803,10 @@ ssize_t dd_lk(ssize_t *prt, ssize_t n, double key)
  *-- the heuristic attempts to deal processes equally among the axes
  *-- of the data array.
  *--
- *-- ddb_h2 allocates storage for ndims+npes integers and may call ddb_ex.
+ *-- ddb_h2 allocates storage for ndims integers and may call ddb_ex.
  *--
  ************************************************************************/
-void ddb_h2(ssize_t ndims, ssize_t ardims[], ssize_t npes, double threshold, ssize_t bias, ssize_t blk[], ssize_t pedims[])
+static void ddb_h2_search(ssize_t ndims, ssize_t ardims[], ssize_t npes, double threshold, ssize_t bias, ssize_t blk[], ssize_t pedims[])
 {
       /*- Allocate memory to store the granularity -*/
       ssize_t * tard = calloc((ssize_t)ndims,sizeof(ssize_t));
@@ -660,40 +834,11 @@ void ddb_h2(ssize_t ndims, ssize_t ardims[], ssize_t npes, double threshold, ssi
           }
       }
 
-      /*- Allocate storage to old all divisors of npes -*/
-      ssize_t npdivs = 1;
-      for (ssize_t i=2; i<=npes; i++) {
-          if (npes%i==0) npdivs += 1;
-      }
-      ssize_t * pdivs = calloc((ssize_t)npdivs,sizeof(ssize_t));
-      if (pdivs==NULL){
-         fprintf(stderr,"%s: %s\n","split", "memory allocation failed");
-         for (ssize_t i=0; i<ndims; i++) {
-             blk[i] = 0;
-         }
-         free(tard);
-         return;
-      }
-
-      /*- Find all divisors of npes -*/
-      for (ssize_t j=0, i=1; i<=npes; i++) {
-          if (npes%i==0) pdivs[j++] = i;
-      }
-
-      /*- Find all prime divisors of npes (with repetitions) -*/
-      if (npdivs>1) {
-         ssize_t k = 1;
-         do {
-            ssize_t h = k+1;
-            for (ssize_t j=h; j<npdivs; j++) {
-               if (pdivs[j]%pdivs[k]==0) {
-                  pdivs[h++] = pdivs[j]/pdivs[k];
-               }
-            }
-            npdivs = h;
-            k = k+1;
-         } while(k<npdivs);
-      }
+      /*- Find all prime divisors of npes (with repetitions), in
+       *- ascending order after a leading 1 -*/
+      ssize_t pdivs[DD_MAXFACTORS+1];
+      pdivs[0] = 1;
+      ssize_t npdivs = 1 + dd_factor(npes,&pdivs[1]);
 
       /*- Set istart and istep -*/
       ssize_t istep = 1;
@@ -721,14 +866,13 @@ void ddb_h2(ssize_t ndims, ssize_t ardims[], ssize_t npes, double threshold, ssi
          pedims[h] *= p0;
          if (bias==0) istart = (istart+1)%ndims;
       }
-      free(pdivs);
 
       double ub = dd_ev(ndims,tard,pedims);
 
       /*- Do an exhaustive search is the heuristic returns a solution
        *- whose load balance ratio is less than the given threshold. -*/
       if (ub<threshold) {
-         ddb_ex(ndims, tard, npes, threshold, blk, pedims);
+         ddb_ex_search(ndims, tard, npes, threshold, blk, pedims);
       }
 
       dd_su(ndims,ardims,pedims,blk);
@@ -786,3 +930,85 @@ void dd_su(ssize_t ndims, ssize_t ardims[], ssize_t pedims[], ssize_t blk[])
          if (blk[i]<1) blk[i] = 1;
     }
 }
+
+/****************************************************************************
+ *--
+ *--  ssize_t dd_factor stores the prime factors of n, with repetitions and
+ *--  in ascending order, in primes (of size DD_MAXFACTORS) and returns
+ *--  how many there are. There are none for n<2.
+ *--
+ ****************************************************************************/
+static ssize_t dd_factor(ssize_t n, ssize_t primes[])
+{
+    ssize_t count = 0;
+    for (ssize_t p=2; p<=n/p; p++) {
+        while (n%p==0) {
+            primes[count++] = p;
+            n /= p;
+        }
+    }
+    if (n>1) primes[count++] = n;
+    return count;
+}
+
+static int dd_compare(const void * a, const void * b)
+{
+    const ssize_t x = *(const ssize_t*)a, y = *(const ssize_t*)b;
+    return (x>y) - (x<y);
+}
+
+/****************************************************************************
+ *--
+ *--  ssize_t * dd_divisors returns the divisors of n in ascending order,
+ *--  generated from the prime factorization of n, and sets count to how
+ *--  many there are. The caller frees the result, which is NULL if
+ *--  the allocation fails.
+ *--
+ ****************************************************************************/
+static ssize_t * dd_divisors(ssize_t n, ssize_t * count)
+{
+    ssize_t primes[DD_MAXFACTORS];
+    ssize_t nprimes = dd_factor(n,primes);
+
+    /*- The number of divisors is the product of (multiplicity+1) -*/
+    ssize_t ndivs = 1;
+    for (ssize_t i=0; i<nprimes; ) {
+        ssize_t e = 0, p = primes[i];
+        for (; i<nprimes && primes[i]==p; i++) e++;
+        ndivs *= e+1;
+    }
+
+    ssize_t * divs = calloc((ssize_t)ndivs,sizeof(ssize_t));
+    if (divs==NULL) return NULL;
+
+    /*- Multiply the divisors found so far by each power of each prime -*/
+    ssize_t m = 1;
+    divs[0] = 1;
+    for (ssize_t i=0; i<nprimes; ) {
+        ssize_t p = primes[i], m0 = m;
+        for (ssize_t q=p; i<nprimes && primes[i]==p; i++, q*=p) {
+            for (ssize_t j=0; j<m0; j++) divs[m++] = divs[j]*q;
+        }
+    }
+    qsort(divs,(size_t)ndivs,sizeof(ssize_t),dd_compare);
+
+    *count = ndivs;
+    return divs;
+}
+
+/****************************************************************************
+ *--
+ *--  ssize_t dd_next_divisor returns the least divisor of n that is at
+ *--  least lo, or n if there is none.
+ *--
+ ****************************************************************************/
+static ssize_t dd_next_divisor(ssize_t n, ssize_t lo)
+{
+    ssize_t best = n;
+    for (ssize_t d=1; d<=n/d; d++) {
+        if (n%d!=0) continue;
+        if (d>=lo && d<best) best = d;
+        if (n/d>=lo && n/d<best) best = n/d;
+    }
+    return best;
+}
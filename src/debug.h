@@ -14,6 +14,7 @@ enum debug_cats_e {
   DEBUG_CAT_NONE       =   0,
   DEBUG_CAT_ARGS       = 0x1,
   DEBUG_CAT_ARRAY_DIST = 0x2,
+  DEBUG_CAT_RMA        = 0x4,
 };
 
 /* A logical OR of the debug message categories that are enabled.  */
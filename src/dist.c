@@ -0,0 +1,316 @@
+/*
+ * Copyright (C) 2014. See COPYRIGHT in top-level directory.
+ */
+
+#include <dalec.h>
+#include <dalec_guts.h>
+#include <debug.h>
+
+/** Set the block sizes of an array on its grid from dims and the block
+  * sizes of the descriptor.  Without a user block size, the remainder is
+  * dealt to the leading grid coordinates so that block extents differ by
+  * at most one.  Otherwise every block has the user block size (or larger,
+  * if the grid is too small to cover the array with it) and the trailing
+  * blocks may be short or empty.  A block-cyclic array deals out blocks of
+  * the user block size, or one block per coordinate without it,
+  * round-robin.
+  *
+  * @param[in,out] h      Array handle, dims, pedims and cyclic are used and blocksizes and remainders are set
+  * @param[in]     blks   Block sizes from the descriptor, zero where the grid decides
+  */
+void DALECI_Block_sizes(DALEC_Array_handle * h, const size_t blks[])
+{
+    for (int i=0; i<h->ndim; i++) {
+        const size_t dim = h->dims[i];
+        const size_t p   = h->pedims[i];
+        if (h->cyclic) {
+            h->blocksizes[i] = (blks[i] > 0) ? blks[i] : (dim + p - 1) / p;
+            h->remainders[i] = 0;
+        } else if (blks[i] == 0) {
+            h->blocksizes[i] = dim / p;
+            h->remainders[i] = dim % p;
+        } else {
+            size_t q = (dim + p - 1) / p;
+            h->blocksizes[i] = (q < blks[i]) ? blks[i] : q;
+            h->remainders[i] = 0;
+        }
+    }
+}
+
+/** Find the owners of a patch.  Each segment in the box [cfirst,clast]
+  * stands for a different owner, which is the one of its grid coordinates.
+  * Without a block-cyclic distribution the segments are the blocks, so the
+  * box holds the grid coordinates touched.  Otherwise it holds the first
+  * segments touched along each dimension, up to one per grid coordinate,
+  * and the owner of segment s also owns the segments s + k*pedims[i].
+  *
+  * @param[in]  h      Array handle
+  * @param[in]  lo     Lowest global index of the patch in each dimension
+  * @param[in]  hi     Highest global index of the patch in each dimension (inclusive)
+  * @param[out] cfirst First segment touched in each dimension
+  * @param[out] clast  Last segment that stands for an owner in each dimension
+  * @return            Number of owners
+  */
+int DALECI_Split_patch(const DALEC_Array_handle * h, const size_t lo[], const size_t hi[],
+                       int cfirst[], int clast[])
+{
+    int count = 1;
+    for (int i=0; i<h->ndim; i++) {
+        const size_t first = DALECI_Seg_of(h, i, lo[i]);
+        const size_t last  = DALECI_Seg_of(h, i, hi[i]);
+        const size_t n     = (last-first+1 < (size_t)h->pedims[i]) ? last-first+1 : (size_t)h->pedims[i];
+        cfirst[i] = (int)first;
+        clast[i]  = (int)(first + n - 1);
+        count    *= (int)n;
+    }
+    return count;
+}
+
+/** Check whether two arrays have the same shape and the same blocks on the
+  * same ranks, so that element-wise operations need no communication.
+  *
+  * @return            Nonzero if the distributions are the same
+  */
+int DALECI_Same_distribution(const DALEC_Array_handle * a, const DALEC_Array_handle * b)
+{
+    if (a->ndim != b->ndim || a->cyclic != b->cyclic) return 0;
+    for (int i=0; i<a->ndim; i++) {
+        if (a->dims[i]       != b->dims[i]       ||
+            a->pedims[i]     != b->pedims[i]     ||
+            a->blocksizes[i] != b->blocksizes[i] ||
+            a->remainders[i] != b->remainders[i]) {
+            return 0;
+        }
+        if ((a->irreg[i] == NULL) != (b->irreg[i] == NULL)) return 0;
+        if (a->irreg[i] != NULL &&
+            memcmp(a->irreg[i], b->irreg[i], (a->pedims[i]+1) * sizeof(size_t)) != 0) {
+            return 0;
+        }
+    }
+
+    /* the grid is laid out over the ranks of comm */
+    int result;
+    MPI_Comm_compare(a->comm, b->comm, &result);
+    return (result == MPI_IDENT || result == MPI_CONGRUENT);
+}
+
+/** Build a datatype that selects, from a row-major array of extents sizes,
+  * the elements whose index along every dimension i falls in one of the
+  * nruns[i] ranges [starts[i][k], starts[i][k]+lens[i][k]).  The ranges
+  * must be increasing.  With one range per dimension this is a subarray.
+  * The datatype is not committed.
+  *
+  * @return            Zero on success
+  */
+int DALECI_Runs_type(int ndim, const int sizes[], const int nruns[], int * const starts[],
+                     int * const lens[], MPI_Datatype type, MPI_Datatype * newtype)
+{
+    int rc;
+
+    int simple = 1;
+    for (int i=0; i<ndim; i++) {
+        simple &= (nruns[i] == 1);
+    }
+    if (simple) {
+        int subsizes[DALEC_ARRAY_MAX_DIM], substarts[DALEC_ARRAY_MAX_DIM];
+        for (int i=0; i<ndim; i++) {
+            subsizes[i]  = lens[i][0];
+            substarts[i] = starts[i][0];
+        }
+        rc = MPI_Type_create_subarray(ndim, sizes, subsizes, substarts, MPI_ORDER_C, type, newtype);
+        DALECI_Check_MPI(__func__, "MPI_Type_create_subarray", rc);
+        return DALEC_SUCCESS;
+    }
+
+    /* from the last dimension out, the ranges of each dimension repeat the
+     * type of the dimensions inside it, whose extent is one row */
+    MPI_Aint lb, stride;
+    rc = MPI_Type_get_extent(type, &lb, &stride);
+    DALECI_Check_MPI(__func__, "MPI_Type_get_extent", rc);
+
+    MPI_Datatype inner = type;
+    for (int i=ndim-1; i>=0; i--) {
+        MPI_Aint * displs = malloc(nruns[i] * sizeof(MPI_Aint));
+        if (displs == NULL) {
+            DALECI_Error("malloc of %d displacements failed", nruns[i]);
+            return DALEC_INPUT_ERROR;
+        }
+        for (int k=0; k<nruns[i]; k++) {
+            displs[k] = starts[i][k] * stride;
+        }
+
+        MPI_Datatype row, outer;
+        rc = MPI_Type_create_resized(inner, 0, stride, &row);
+        DALECI_Check_MPI(__func__, "MPI_Type_create_resized", rc);
+        rc = MPI_Type_create_hindexed(nruns[i], lens[i], displs, row, &outer);
+        DALECI_Check_MPI(__func__, "MPI_Type_create_hindexed", rc);
+        free(displs);
+
+        MPI_Type_free(&row);
+        if (inner != type) MPI_Type_free(&inner);
+        inner   = outer;
+        stride *= sizes[i];
+    }
+    *newtype = inner;
+
+    return DALEC_SUCCESS;
+}
+
+/* -- begin weak symbols block -- */
+#if defined(HAVE_PRAGMA_WEAK)
+#  pragma weak DALEC_Locate = PDALEC_Locate
+#elif defined(HAVE_PRAGMA_HP_SEC_DEF)
+#  pragma _HP_SECONDARY_DEF PDALEC_Locate DALEC_Locate
+#elif defined(HAVE_PRAGMA_CRI_DUP)
+#  pragma _CRI duplicate DALEC_Locate as PDALEC_Locate
+#elif defined(HAVE_WEAK_ATTRIBUTE)
+int DALEC_Locate(const DALEC_Array_handle * h, const size_t idx[], int * rank, size_t * offset)
+    __attribute__ ((weak, alias("PDALEC_Locate")));
+#else
+#define DALEC_Locate PDALEC_Locate
+#endif
+/* -- end weak symbols block -- */
+
+/** Find the owner of an element and its position in the owner's block.  Local.
+  *
+  * @param[in]  h      Array handle
+  * @param[in]  idx    Global index of the element
+  * @param[out] rank   Owner of the element in the communicator of the array
+  * @param[out] offset Row-major offset of the element in the block of the owner, ghosts included,
+  *                    in elements (may be NULL)
+  * @return            Zero on success
+  */
+int DALEC_Locate(const DALEC_Array_handle * h, const size_t idx[], int * rank, size_t * offset)
+{
+    if (h==NULL || idx==NULL || rank==NULL) {
+        DALECI_Error("h (%p), idx (%p) or rank (%p) is a null pointer", h, idx, rank);
+        return DALEC_INPUT_ERROR;
+    }
+
+    int target = 0;
+    size_t disp = 0;
+    for (int i=0; i<h->ndim; i++) {
+        if (idx[i] >= h->dims[i]) {
+            DALECI_Error("idx[%d] (%zu) is not within dims[%d] = %zu", i, idx[i], i, h->dims[i]);
+            return DALEC_INPUT_ERROR;
+        }
+        const int c = DALECI_Block_coord(h, i, idx[i]);
+        target = target * h->pedims[i] + c;
+        disp   = disp * DALECI_Block_padded(h, i, c) + (DALECI_Local_index(h, i, idx[i]) + h->ghosts[i]);
+    }
+
+    *rank = target;
+    if (offset != NULL) *offset = disp;
+
+    return DALEC_SUCCESS;
+}
+
+/* -- begin weak symbols block -- */
+#if defined(HAVE_PRAGMA_WEAK)
+#  pragma weak DALEC_Distribution = PDALEC_Distribution
+#elif defined(HAVE_PRAGMA_HP_SEC_DEF)
+#  pragma _HP_SECONDARY_DEF PDALEC_Distribution DALEC_Distribution
+#elif defined(HAVE_PRAGMA_CRI_DUP)
+#  pragma _CRI duplicate DALEC_Distribution as PDALEC_Distribution
+#elif defined(HAVE_WEAK_ATTRIBUTE)
+int DALEC_Distribution(const DALEC_Array_handle * h, int rank, size_t lo[], size_t extents[])
+    __attribute__ ((weak, alias("PDALEC_Distribution")));
+#else
+#define DALEC_Distribution PDALEC_Distribution
+#endif
+/* -- end weak symbols block -- */
+
+/** Find the block owned by any rank of an array.  Ranks outside the process
+  * grid own an empty block.  The block of a block-cyclic array is not a
+  * patch: lo is then the first index that the rank owns, and extents are
+  * those of its local block.  Local.
+  *
+  * @param[in]  h       Array handle
+  * @param[in]  rank    Rank in the communicator of the array
+  * @param[out] lo      Lowest global index of the block in each dimension
+  * @param[out] extents Extent of the block in each dimension
+  * @return             Zero on success
+  */
+int DALEC_Distribution(const DALEC_Array_handle * h, int rank, size_t lo[], size_t extents[])
+{
+    if (h==NULL || lo==NULL || extents==NULL) {
+        DALECI_Error("h (%p), lo (%p) or extents (%p) is a null pointer", h, lo, extents);
+        return DALEC_INPUT_ERROR;
+    }
+
+    int grid_size = 1;
+    for (int i=0; i<h->ndim; i++) {
+        grid_size *= h->pedims[i];
+    }
+    if (rank < 0 || rank >= grid_size) {
+        for (int i=0; i<h->ndim; i++) {
+            lo[i]      = 0;
+            extents[i] = 0;
+        }
+        return DALEC_SUCCESS;
+    }
+
+    for (int i=h->ndim-1, rem=rank; i>=0; i--) {
+        const int c = rem % h->pedims[i];
+        rem /= h->pedims[i];
+        lo[i]      = DALECI_Block_lo(h, i, c);
+        extents[i] = DALECI_Block_extent(h, i, c);
+    }
+
+    return DALEC_SUCCESS;
+}
+
+/* -- begin weak symbols block -- */
+#if defined(HAVE_PRAGMA_WEAK)
+#  pragma weak DALEC_Descinit = PDALEC_Descinit
+#elif defined(HAVE_PRAGMA_HP_SEC_DEF)
+#  pragma _HP_SECONDARY_DEF PDALEC_Descinit DALEC_Descinit
+#elif defined(HAVE_PRAGMA_CRI_DUP)
+#  pragma _CRI duplicate DALEC_Descinit as PDALEC_Descinit
+#elif defined(HAVE_WEAK_ATTRIBUTE)
+int DALEC_Descinit(const DALEC_Array_handle * h, int ictxt, int desc[9]) __attribute__ ((weak, alias("PDALEC_Descinit")));
+#else
+#define DALEC_Descinit PDALEC_Descinit
+#endif
+/* -- end weak symbols block -- */
+
+/** Fill in the ScaLAPACK descriptor of the local block of a 2D block-cyclic
+  * array, as DESCINIT would.  ScaLAPACK is column-major, so the local block
+  * of an m by n array, row-major with leading dimension local_dims[1], is
+  * the local matrix of its n by m transpose.  The BLACS context must be a
+  * pedims[1] by pedims[0] grid in column-major order, e.g. from
+  * Cblacs_gridinit(&ictxt, "C", h->pedims[1], h->pedims[0]) over the ranks
+  * of the communicator of the array.  The local matrix itself is at the
+  * address that DALEC_Access returns for the first block of the caller.
+  * Local.
+  *
+  * @param[in]  h      Array handle
+  * @param[in]  ictxt  BLACS context
+  * @param[out] desc   ScaLAPACK array descriptor
+  * @return            Zero on success
+  */
+int DALEC_Descinit(const DALEC_Array_handle * h, int ictxt, int desc[9])
+{
+    if (h==NULL || desc==NULL) {
+        DALECI_Error("h (%p) or desc (%p) is a null pointer", h, desc);
+        return DALEC_INPUT_ERROR;
+    }
+    if (h->ndim != 2 || !h->cyclic) {
+        DALECI_Error("only 2D block-cyclic arrays have a ScaLAPACK descriptor (ndim = %d, cyclic = %d)",
+                     h->ndim, h->cyclic);
+        return DALEC_INPUT_ERROR;
+    }
+
+    desc[0] = 1;                                /* DTYPE, dense */
+    desc[1] = ictxt;                            /* CTXT         */
+    desc[2] = (int)h->dims[1];                  /* M            */
+    desc[3] = (int)h->dims[0];                  /* N            */
+    desc[4] = (int)h->blocksizes[1];            /* MB           */
+    desc[5] = (int)h->blocksizes[0];            /* NB           */
+    desc[6] = 0;                                /* RSRC         */
+    desc[7] = 0;                                /* CSRC         */
+    desc[8] = (int)h->local_dims[1];            /* LLD          */
+    if (desc[8] < 1) desc[8] = 1;
+
+    return DALEC_SUCCESS;
+}
@@ -0,0 +1,414 @@
+/*
+ * Copyright (C) 2014. See COPYRIGHT in top-level directory.
+ */
+
+#include <dalec.h>
+#include <dalec_guts.h>
+#include <debug.h>
+
+/* An array created with dynamic set lives in a window from
+ * MPI_Win_create_dynamic, to which every rank attaches the memory of its
+ * padded block.  Targets are then addressed in bytes from the addresses of
+ * their blocks, which every rank keeps (DALECI_Target_disp).
+ *
+ * DALEC_Resize_array changes dims on the same process grid.  A rank whose
+ * memory is large enough for its new block keeps it; the others attach
+ * twice what they had, or what they need if that is more, so that an array
+ * that keeps growing is reattached a logarithmic number of times, and once
+ * a quarter of its memory is enough a rank keeps twice what it needs.  The
+ * new addresses are exchanged with one allgather, and the window itself
+ * stays.  Elements that are in the array before and after keep their
+ * values: those that stay on their rank are moved locally and the others
+ * are put to their new owners.  Dynamic arrays do not share memory between
+ * the ranks of a node and their windows are not pooled.
+ *
+ * Some MPI libraries cannot create dynamic windows in every case (Open MPI
+ * 4.1 on a single process).  The array then has a window from
+ * MPI_Win_allocate with a displacement unit of one byte, allocated again at
+ * every resize, and all addresses are zero. */
+
+/* Attach capacity bytes of new memory in place of the block at *base.  A
+ * fixed window gets its memory in DALECI_Dynamic_lock instead. */
+static int DALECI_Dynamic_attach(DALEC_Array_handle * h, size_t capacity, void ** base)
+{
+    int rc; /* MPI return code */
+
+    struct DALECI_Dynamic_s * dyn = h->dynamic;
+
+    dyn->capacity = capacity;
+    if (dyn->fixed) return DALEC_SUCCESS;
+
+    void * mem = NULL;
+    if (capacity > 0) {
+        rc = MPI_Alloc_mem((MPI_Aint)capacity, MPI_INFO_NULL, &mem);
+        DALECI_Check_MPI(__func__, "MPI_Alloc_mem", rc);
+        rc = MPI_Win_attach(h->win, mem, (MPI_Aint)capacity);
+        DALECI_Check_MPI(__func__, "MPI_Win_attach", rc);
+    }
+
+    if (*base != NULL) {
+        rc = MPI_Win_detach(h->win, *base);
+        DALECI_Check_MPI(__func__, "MPI_Win_detach", rc);
+        MPI_Free_mem(*base);
+    }
+
+    *base = mem;
+    return DALEC_SUCCESS;
+}
+
+/* Open the passive-target epoch that spans the lifetime of the array, as
+ * for other windows, allocating a fixed window with its memory first. */
+static int DALECI_Dynamic_lock(DALEC_Array_handle * h)
+{
+    int rc; /* MPI return code */
+
+    struct DALECI_Dynamic_s * dyn = h->dynamic;
+
+    if (dyn->fixed) {
+        rc = MPI_Win_allocate((MPI_Aint)dyn->capacity, 1, MPI_INFO_NULL, h->comm, &(h->base), &(h->win));
+        DALECI_Check_MPI(__func__, "MPI_Win_allocate", rc);
+    }
+
+    rc = MPI_Win_lock_all(MPI_MODE_NOCHECK, h->win);
+    DALECI_Check_MPI(__func__, "MPI_Win_lock_all", rc);
+
+    return DALEC_SUCCESS;
+}
+
+/* Close the epoch of DALECI_Dynamic_lock, freeing a fixed window and its memory. */
+static int DALECI_Dynamic_unlock(DALEC_Array_handle * h)
+{
+    int rc; /* MPI return code */
+
+    rc = MPI_Win_unlock_all(h->win);
+    DALECI_Check_MPI(__func__, "MPI_Win_unlock_all", rc);
+
+    if (h->dynamic->fixed) {
+        rc = MPI_Win_free(&(h->win));
+        DALECI_Check_MPI(__func__, "MPI_Win_free", rc);
+        h->base = NULL;
+    }
+
+    return DALEC_SUCCESS;
+}
+
+/* Exchange the addresses of the blocks, and whether any rank moves elements to another. */
+static int DALECI_Dynamic_exchange(DALEC_Array_handle * h, int moves, int * any_moves)
+{
+    int rc; /* MPI return code */
+
+    struct DALECI_Dynamic_s * dyn = h->dynamic;
+
+    int np;
+    MPI_Comm_size(h->comm, &np);
+
+    MPI_Aint mine[2] = { 0, moves };
+    if (h->base != NULL && !dyn->fixed) {
+        rc = MPI_Get_address(h->base, &mine[0]);
+        DALECI_Check_MPI(__func__, "MPI_Get_address", rc);
+    }
+    MPI_Aint * all = malloc(2 * np * sizeof(MPI_Aint));
+    if (all == NULL) {
+        DALECI_Error("malloc of %d addresses failed", np);
+        return DALEC_INPUT_ERROR;
+    }
+    rc = MPI_Allgather(mine, 2, MPI_AINT, all, 2, MPI_AINT, h->comm);
+    DALECI_Check_MPI(__func__, "MPI_Allgather", rc);
+
+    *any_moves = 0;
+    for (int r=0; r<np; r++) {
+        dyn->addrs[r] = all[2*r];
+        *any_moves |= (all[2*r+1] != 0);
+    }
+    free(all);
+    return DALEC_SUCCESS;
+}
+
+/** Create the dynamic window of an array and attach its memory.  Collective.
+  *
+  * @param[in]     d         Array descriptor
+  * @param[in,out] h         Array handle, comm is used and win and dynamic are set
+  * @param[in]     bytes     Size of the local block in bytes
+  * @param[in]     type_size Size of an element
+  * @param[out]    baseptr   Base of the local block
+  * @return                  Zero on success
+  */
+int DALECI_Dynamic_create(const DALEC_Array_descriptor * d, DALEC_Array_handle * h, MPI_Aint bytes,
+                          int type_size, void * baseptr)
+{
+    int rc; /* MPI return code */
+
+    int np;
+    MPI_Comm_size(h->comm, &np);
+
+    struct DALECI_Dynamic_s * dyn = calloc(1, sizeof(struct DALECI_Dynamic_s));
+    if (dyn == NULL) {
+        DALECI_Error("calloc of dynamic window state failed");
+        return DALEC_INPUT_ERROR;
+    }
+    dyn->addrs = malloc(np * sizeof(MPI_Aint));
+    if (dyn->addrs == NULL) {
+        DALECI_Error("malloc of %d addresses failed", np);
+        return DALEC_INPUT_ERROR;
+    }
+    dyn->type_size = type_size;
+    for (int i=0; i<DALEC_ARRAY_MAX_DIM; i++) {
+        dyn->blks[i] = (i < d->ndim) ? d->blks[i] : 0;
+    }
+    h->dynamic = dyn;
+
+    /* a failure here is not fatal, and every rank has to know of it */
+    MPI_Errhandler errh;
+    MPI_Comm_get_errhandler(h->comm, &errh);
+    MPI_Comm_set_errhandler(h->comm, MPI_ERRORS_RETURN);
+    dyn->fixed = (MPI_Win_create_dynamic(MPI_INFO_NULL, h->comm, &(h->win)) != MPI_SUCCESS);
+    MPI_Comm_set_errhandler(h->comm, errh);
+    MPI_Errhandler_free(&errh);
+
+    int fixed = dyn->fixed;
+    rc = MPI_Allreduce(MPI_IN_PLACE, &fixed, 1, MPI_INT, MPI_LOR, h->comm);
+    DALECI_Check_MPI(__func__, "MPI_Allreduce", rc);
+    if (fixed && !dyn->fixed) {
+        rc = MPI_Win_free(&(h->win));
+        DALECI_Check_MPI(__func__, "MPI_Win_free", rc);
+    }
+    dyn->fixed = fixed;
+    DALECI_Dbg_print(DEBUG_CAT_ARRAY_DIST, "dynamic = %d\n", !fixed);
+
+    h->base = NULL;
+    rc = DALECI_Dynamic_attach(h, (size_t)bytes, &(h->base));
+    if (rc != DALEC_SUCCESS) return rc;
+
+    rc = DALECI_Dynamic_lock(h);
+    if (rc != DALEC_SUCCESS) return rc;
+
+    int any_moves;
+    rc = DALECI_Dynamic_exchange(h, 0, &any_moves);
+    if (rc != DALEC_SUCCESS) return rc;
+
+    *(void**)baseptr = h->base;
+    return DALEC_SUCCESS;
+}
+
+/** Free the dynamic window of an array with its memory and communicator.
+  * Collective.
+  *
+  * @return            Zero on success
+  */
+int DALECI_Dynamic_free(DALEC_Array_handle * h)
+{
+    int rc; /* MPI return code */
+
+    rc = DALECI_Dynamic_unlock(h);
+    if (rc != DALEC_SUCCESS) return rc;
+
+    /* nobody may access the memory once it is detached */
+    rc = MPI_Barrier(h->comm);
+    DALECI_Check_MPI(__func__, "MPI_Barrier", rc);
+
+    rc = DALECI_Dynamic_attach(h, 0, &(h->base));
+    if (rc != DALEC_SUCCESS) return rc;
+
+    if (!h->dynamic->fixed) {
+        rc = MPI_Win_free(&(h->win));
+        DALECI_Check_MPI(__func__, "MPI_Win_free", rc);
+    }
+
+    rc = MPI_Comm_free(&(h->comm));
+    DALECI_Check_MPI(__func__, "MPI_Comm_free", rc);
+
+    free(h->dynamic->addrs);
+    free(h->dynamic);
+    h->dynamic = NULL;
+
+    return DALEC_SUCCESS;
+}
+
+/* Copy a box of extents n between the padded blocks of sizes src_sizes and
+ * dst_sizes, starting at src_starts and dst_starts, row by row.  Either
+ * side may be a contiguous buffer, with sizes n and starts zero. */
+static void DALECI_Dynamic_copy(int ndim, size_t type_size, const size_t n[],
+                                const void * src, const size_t src_sizes[], const size_t src_starts[],
+                                void * dst, const size_t dst_sizes[], const size_t dst_starts[])
+{
+    size_t rows = 1;
+    for (int i=0; i<ndim-1; i++) {
+        rows *= n[i];
+    }
+    if (rows == 0 || n[ndim-1] == 0) return;
+
+    for (size_t r=0; r<rows; r++) {
+        /* the indices of row r in the box, last dimension at zero */
+        size_t idx[DALEC_ARRAY_MAX_DIM] = {0};
+        size_t rest = r;
+        for (int i=ndim-2; i>=0; i--) {
+            idx[i] = rest % n[i];
+            rest  /= n[i];
+        }
+        size_t so = 0, dof = 0;
+        for (int i=0; i<ndim; i++) {
+            so  = so  * src_sizes[i] + src_starts[i] + idx[i];
+            dof = dof * dst_sizes[i] + dst_starts[i] + idx[i];
+        }
+        memcpy((char*)dst + dof * type_size, (const char*)src + so * type_size, n[ndim-1] * type_size);
+    }
+}
+
+/* -- begin weak symbols block -- */
+#if defined(HAVE_PRAGMA_WEAK)
+#  pragma weak DALEC_Resize_array = PDALEC_Resize_array
+#elif defined(HAVE_PRAGMA_HP_SEC_DEF)
+#  pragma _HP_SECONDARY_DEF PDALEC_Resize_array DALEC_Resize_array
+#elif defined(HAVE_PRAGMA_CRI_DUP)
+#  pragma _CRI duplicate DALEC_Resize_array as PDALEC_Resize_array
+#elif defined(HAVE_WEAK_ATTRIBUTE)
+int DALEC_Resize_array(DALEC_Array_handle * h, const size_t dims[]) __attribute__ ((weak, alias("PDALEC_Resize_array")));
+#else
+#define DALEC_Resize_array PDALEC_Resize_array
+#endif
+/* -- end weak symbols block -- */
+
+/** Change the dimensions of an array created with dynamic set, on the same
+  * process grid.  Elements in both the old and the new array keep their
+  * values; the others, and all ghost cells, are undefined.  Completes
+  * everything in flight on the array.  Collective.
+  *
+  * @param[in,out] h      Array handle
+  * @param[in]     dims   New extent of each dimension
+  * @return               Zero on success
+  */
+int DALEC_Resize_array(DALEC_Array_handle * h, const size_t dims[])
+{
+    int rc; /* MPI return code */
+
+    if (h == NULL || dims == NULL) {
+        DALECI_Error("h (%p) or dims (%p) is a null pointer", h, dims);
+        return DALEC_INPUT_ERROR;
+    }
+    struct DALECI_Dynamic_s * dyn = h->dynamic;
+    if (dyn == NULL) {
+        DALECI_Error("only arrays created with dynamic set can be resized");
+        return DALEC_INPUT_ERROR;
+    }
+
+    const int ndim = h->ndim;
+    int64_t args[2*DALEC_ARRAY_MAX_DIM] = {0};
+    for (int i=0; i<ndim; i++) {
+        if (dims[i] < 1 || dyn->blks[i] > dims[i] || h->ghosts[i] > dims[i]) {
+            DALECI_Error("dims[%d] = %zu is less than 1, blks[%d] (%zu) or ghosts[%d] (%zu)",
+                         i, dims[i], i, dyn->blks[i], i, h->ghosts[i]);
+            return DALEC_INPUT_ERROR;
+        }
+        args[2*i]   =  dims[i];
+        args[2*i+1] = -dims[i];
+    }
+    rc = MPI_Allreduce(MPI_IN_PLACE, args, 2*ndim, MPI_INT64_T, MPI_MAX, h->comm);
+    DALECI_Check_MPI(__func__, "MPI_Allreduce", rc);
+    for (int i=0; i<ndim; i++) {
+        if (args[2*i] != -args[2*i+1]) {
+            DALECI_Error("dims[%d] (%zu) is not constant across ranks", i, dims[i]);
+            return DALEC_INPUT_ERROR;
+        }
+    }
+
+    /* nothing may be in flight to the old blocks */
+    if (h->aggregate != NULL) {
+        rc = DALECI_Aggregate_flush_all(h);
+        if (rc != DALEC_SUCCESS) return rc;
+    }
+    rc = DALEC_Sync(h);
+    if (rc != DALEC_SUCCESS) return rc;
+    DALECI_Halo_free(h);
+
+    /* the part of the old block that is in the new array, copied out */
+    const int owner = (h->coords[0] >= 0);
+    size_t olo[DALEC_ARRAY_MAX_DIM], n[DALEC_ARRAY_MAX_DIM], osizes[DALEC_ARRAY_MAX_DIM];
+    size_t zeros[DALEC_ARRAY_MAX_DIM] = {0}, ghosts[DALEC_ARRAY_MAX_DIM];
+    size_t count = owner ? 1 : 0;
+    for (int i=0; i<ndim; i++) {
+        olo[i]    = h->local_lo[i];
+        n[i]      = (!owner || olo[i] >= dims[i]) ? 0 :
+                    (olo[i] + h->local_dims[i] <= dims[i]) ? h->local_dims[i] : dims[i] - olo[i];
+        osizes[i] = h->local_dims[i] + 2*h->ghosts[i];
+        ghosts[i] = h->ghosts[i];
+        count    *= n[i];
+    }
+    void * keep = NULL;
+    if (count > 0) {
+        keep = malloc(count * dyn->type_size);
+        if (keep == NULL) {
+            DALECI_Error("malloc of %zu elements failed", count);
+            return DALEC_INPUT_ERROR;
+        }
+        DALECI_Dynamic_copy(ndim, dyn->type_size, n, h->base, osizes, ghosts, keep, n, zeros);
+    }
+
+    /* the new blocks, on the same grid */
+    for (int i=0; i<ndim; i++) {
+        h->dims[i] = dims[i];
+    }
+    DALECI_Block_sizes(h, dyn->blks);
+    size_t nsizes[DALEC_ARRAY_MAX_DIM], nstarts[DALEC_ARRAY_MAX_DIM];
+    size_t bytes = owner ? dyn->type_size : 0;
+    int stays = 1;
+    for (int i=0; i<ndim; i++) {
+        if (owner) {
+            h->local_lo[i]   = DALECI_Block_lo(h, i, h->coords[i]);
+            h->local_dims[i] = DALECI_Block_extent(h, i, h->coords[i]);
+        }
+        nsizes[i]  = h->local_dims[i] + 2*h->ghosts[i];
+        nstarts[i] = olo[i] - h->local_lo[i] + h->ghosts[i];
+        stays     &= (olo[i] >= h->local_lo[i] && olo[i] + n[i] <= h->local_lo[i] + h->local_dims[i]);
+        bytes     *= (h->local_dims[i] > 0) ? nsizes[i] : 0;
+    }
+    stays |= (count == 0);
+
+    /* grow by doubling and shrink by halving, so that resizing is amortized */
+    size_t capacity = dyn->capacity;
+    if (bytes > capacity) {
+        capacity = (bytes > 2 * capacity) ? bytes : 2 * capacity;
+    } else if (bytes <= capacity / 4) {
+        capacity = 2 * bytes;
+    }
+    if (dyn->fixed) {
+        rc = DALECI_Dynamic_unlock(h);
+        if (rc != DALEC_SUCCESS) return rc;
+    }
+    if (capacity != dyn->capacity) {
+        DALECI_Dbg_print(DEBUG_CAT_ARRAY_DIST, "attaching %zu bytes for %zu bytes, had %zu\n",
+                         capacity, bytes, dyn->capacity);
+        rc = DALECI_Dynamic_attach(h, capacity, &(h->base));
+        if (rc != DALEC_SUCCESS) return rc;
+    }
+
+    if (dyn->fixed) {
+        rc = DALECI_Dynamic_lock(h);
+        if (rc != DALEC_SUCCESS) return rc;
+    }
+
+    if (stays && count > 0) {
+        DALECI_Dynamic_copy(ndim, dyn->type_size, n, keep, n, zeros, h->base, nsizes, nstarts);
+    }
+
+    int any_moves;
+    rc = DALECI_Dynamic_exchange(h, !stays, &any_moves);
+    if (rc != DALEC_SUCCESS) return rc;
+
+    /* elements whose owner changed are put there, through the new addresses */
+    if (any_moves) {
+        if (!stays) {
+            size_t hi[DALEC_ARRAY_MAX_DIM], ld[DALEC_ARRAY_MAX_DIM];
+            for (int i=0; i<ndim; i++) {
+                hi[i] = olo[i] + n[i] - 1;
+                if (i > 0) ld[i-1] = n[i];
+            }
+            rc = DALEC_Put(h, olo, hi, keep, ld);
+            if (rc != DALEC_SUCCESS) return rc;
+        }
+        rc = DALEC_Sync(h);
+        if (rc != DALEC_SUCCESS) return rc;
+    }
+    free(keep);
+
+    return DALECI_Halo_create(h);
+}
@@ -0,0 +1,219 @@
+/*
+ * Copyright (C) 2014. See COPYRIGHT in top-level directory.
+ */
+
+#include <dalec.h>
+#include <dalec_guts.h>
+#include <debug.h>
+
+/* SUMMA on the process grid of C.  The inner dimension is cut into panels
+ * that never straddle a block of the columns of A or of the rows of B.  For
+ * each panel, one rank in every grid row reads the rows of the A panel that
+ * its grid row needs and broadcasts them along the row, and one rank in
+ * every grid column does the same for B down the column.  The reading rank
+ * is the one whose grid coordinate owns the panel in A (resp. B), so when
+ * A and B are laid out on the same grid as C these reads are local and the
+ * panels are the only data that moves.  Other layouts work too; the reads
+ * are then remote.  The broadcasts of the next panel are in flight while
+ * the current one is multiplied.
+ * Panels are at most DALEC_GEMM_PANEL wide, or 256 if it is not set or not
+ * positive.
+ * A and B may be block-cyclic, but C may not, since its local block must
+ * be a patch. */
+
+/** Width of the panel of the inner dimension that starts at kk, which ends
+  * with the block of A or B that holds kk. */
+static size_t DALECI_Gemm_panel(const DALEC_Array_handle * a, const DALEC_Array_handle * b,
+                                size_t kk, size_t nb)
+{
+    size_t end = kk + nb;
+    const size_t aend = DALECI_Seg_lo(a, 1, DALECI_Seg_of(a, 1, kk) + 1);
+    const size_t bend = DALECI_Seg_lo(b, 0, DALECI_Seg_of(b, 0, kk) + 1);
+    if (end > aend) end = aend;
+    if (end > bend) end = bend;
+    if (end > a->dims[1]) end = a->dims[1];
+    return end - kk;
+}
+
+/** Read and start the broadcasts of the panels of A and B at kk.
+  *
+  * @return            Zero on success
+  */
+static int DALECI_Gemm_issue(const DALEC_Array_handle * a, const DALEC_Array_handle * b,
+                             const DALEC_Array_handle * c, MPI_Comm rowcomm, MPI_Comm colcomm,
+                             size_t kk, size_t w, void * abuf, void * bbuf, MPI_Request reqs[2])
+{
+    int rc;
+
+    const size_t m = c->local_dims[0], n = c->local_dims[1];
+    const int rootc = DALECI_Block_coord(a, 1, kk) % c->pedims[1];
+    const int rootr = DALECI_Block_coord(b, 0, kk) % c->pedims[0];
+
+    if (c->coords[1] == rootc && m > 0) {
+        const size_t lo[2] = {c->local_lo[0], kk}, hi[2] = {c->local_lo[0] + m - 1, kk + w - 1}, ld[1] = {w};
+        rc = DALEC_Get(a, lo, hi, abuf, ld);
+        if (rc != DALEC_SUCCESS) return rc;
+    }
+    rc = MPI_Ibcast(abuf, (int)(m*w), c->type, rootc, rowcomm, &reqs[0]);
+    DALECI_Check_MPI(__func__, "MPI_Ibcast", rc);
+
+    if (c->coords[0] == rootr && n > 0) {
+        const size_t lo[2] = {kk, c->local_lo[1]}, hi[2] = {kk + w - 1, c->local_lo[1] + n - 1}, ld[1] = {n};
+        rc = DALEC_Get(b, lo, hi, bbuf, ld);
+        if (rc != DALEC_SUCCESS) return rc;
+    }
+    rc = MPI_Ibcast(bbuf, (int)(w*n), c->type, rootr, colcomm, &reqs[1]);
+    DALECI_Check_MPI(__func__, "MPI_Ibcast", rc);
+
+    return DALEC_SUCCESS;
+}
+
+/* -- begin weak symbols block -- */
+#if defined(HAVE_PRAGMA_WEAK)
+#  pragma weak DALEC_Gemm = PDALEC_Gemm
+#elif defined(HAVE_PRAGMA_HP_SEC_DEF)
+#  pragma _HP_SECONDARY_DEF PDALEC_Gemm DALEC_Gemm
+#elif defined(HAVE_PRAGMA_CRI_DUP)
+#  pragma _CRI duplicate DALEC_Gemm as PDALEC_Gemm
+#elif defined(HAVE_WEAK_ATTRIBUTE)
+int DALEC_Gemm(const void * alpha, const DALEC_Array_handle * a, const DALEC_Array_handle * b,
+               const void * beta, const DALEC_Array_handle * c) __attribute__ ((weak, alias("PDALEC_Gemm")));
+#else
+#define DALEC_Gemm PDALEC_Gemm
+#endif
+/* -- end weak symbols block -- */
+
+/** Compute c = alpha*a*b + beta*c for 2D arrays.  c must be distinct from
+  * a and b.  Collective over the ranks of the arrays.
+  *
+  * @param[in] alpha   Scale factor of a*b, of the type of the arrays
+  * @param[in] a       Array handle, m by k
+  * @param[in] b       Array handle, k by n
+  * @param[in] beta    Scale factor of c, of the type of the arrays
+  * @param[in] c       Array handle, m by n
+  * @return            Zero on success
+  */
+int DALEC_Gemm(const void * alpha, const DALEC_Array_handle * a, const DALEC_Array_handle * b,
+               const void * beta, const DALEC_Array_handle * c)
+{
+    int rc;
+
+    if (a == NULL || b == NULL || c == NULL || alpha == NULL || beta == NULL) {
+        DALECI_Error("an argument is a null pointer");
+        return DALEC_INPUT_ERROR;
+    }
+    if (a->ndim != 2 || b->ndim != 2 || c->ndim != 2) {
+        DALECI_Error("arrays must be 2D (ndim = %d, %d, %d)", a->ndim, b->ndim, c->ndim);
+        return DALEC_INPUT_ERROR;
+    }
+    if (a->type != c->type || b->type != c->type) {
+        DALECI_Error("arrays have different types");
+        return DALEC_INPUT_ERROR;
+    }
+    if (a->dims[0] != c->dims[0] || b->dims[1] != c->dims[1] || a->dims[1] != b->dims[0]) {
+        DALECI_Error("cannot multiply %zu x %zu by %zu x %zu into %zu x %zu",
+                     a->dims[0], a->dims[1], b->dims[0], b->dims[1], c->dims[0], c->dims[1]);
+        return DALEC_INPUT_ERROR;
+    }
+    if (c == a || c == b) {
+        DALECI_Error("c must not be a or b");
+        return DALEC_INPUT_ERROR;
+    }
+    if (c->cyclic) {
+        DALECI_Error("c must not be block-cyclic");
+        return DALEC_INPUT_ERROR;
+    }
+
+    rc = DALEC_Sync(a);
+    if (rc != DALEC_SUCCESS) return rc;
+    if (b != a) {
+        rc = DALEC_Sync(b);
+        if (rc != DALEC_SUCCESS) return rc;
+    }
+    rc = DALEC_Sync(c);
+    if (rc != DALEC_SUCCESS) return rc;
+
+    const size_t m = c->local_dims[0], n = c->local_dims[1];
+    const int in_grid = (c->coords[0] >= 0);
+
+    /* ranks beyond the grid own nothing and sit out */
+    MPI_Comm rowcomm = MPI_COMM_NULL, colcomm = MPI_COMM_NULL;
+    rc = MPI_Comm_split(c->comm, in_grid ? c->coords[0] : MPI_UNDEFINED, c->coords[1], &rowcomm);
+    DALECI_Check_MPI(__func__, "MPI_Comm_split", rc);
+    rc = MPI_Comm_split(c->comm, in_grid ? c->coords[1] : MPI_UNDEFINED, c->coords[0], &colcomm);
+    DALECI_Check_MPI(__func__, "MPI_Comm_split", rc);
+
+    if (in_grid) {
+        const size_t lo[2] = {c->local_lo[0], c->local_lo[1]};
+        const size_t hi[2] = {c->local_lo[0] + m - 1, c->local_lo[1] + n - 1};
+        size_t ld[1];
+        void * pc = NULL;
+
+        int type_size = 0;
+        MPI_Type_size(c->type, &type_size);
+
+        /* rows of the local block are ld[0] apart, which exceeds n with ghosts */
+        if (m*n > 0) {
+            rc = DALEC_Access(c, lo, hi, &pc, ld);
+            if (rc != DALEC_SUCCESS) return rc;
+            for (size_t i=0; i<m; i++) {
+                void * row = (char*)pc + i * ld[0] * type_size;
+                rc = DALECI_Axpby(c->type, n, beta, row, NULL, NULL, row);
+                if (rc != DALEC_SUCCESS) return rc;
+            }
+        }
+
+        /* a panel of no columns would never advance k */
+        const int panel = DALECI_Getenv_int("DALEC_GEMM_PANEL", 256);
+        const size_t nb = (panel > 0) ? (size_t)panel : 256;
+        void * abuf[2], * bbuf[2];
+        MPI_Request reqs[2][2];
+        for (int s=0; s<2; s++) {
+            abuf[s] = DALECI_Staging_get(c->staging, m * nb * type_size);
+            bbuf[s] = DALECI_Staging_get(c->staging, nb * n * type_size);
+            if (abuf[s] == NULL || bbuf[s] == NULL) return DALEC_INPUT_ERROR;
+        }
+
+        const size_t k = a->dims[1];
+        size_t kk = 0, w = DALECI_Gemm_panel(a, b, 0, nb);
+        int s = 0;
+        rc = DALECI_Gemm_issue(a, b, c, rowcomm, colcomm, kk, w, abuf[s], bbuf[s], reqs[s]);
+        if (rc != DALEC_SUCCESS) return rc;
+
+        while (kk < k) {
+            const size_t next = kk + w;
+            const size_t wnext = (next < k) ? DALECI_Gemm_panel(a, b, next, nb) : 0;
+            if (next < k) {
+                rc = DALECI_Gemm_issue(a, b, c, rowcomm, colcomm, next, wnext, abuf[1-s], bbuf[1-s], reqs[1-s]);
+                if (rc != DALEC_SUCCESS) return rc;
+            }
+
+            rc = MPI_Waitall(2, reqs[s], MPI_STATUSES_IGNORE);
+            DALECI_Check_MPI(__func__, "MPI_Waitall", rc);
+
+            if (m*n > 0) {
+                rc = DALECI_Gemm(c->type, m, n, w, alpha, abuf[s], w, bbuf[s], n, pc, ld[0]);
+                if (rc != DALEC_SUCCESS) return rc;
+            }
+
+            kk = next;
+            w  = wnext;
+            s  = 1-s;
+        }
+
+        for (int t=0; t<2; t++) {
+            DALECI_Staging_put(c->staging, abuf[t]);
+            DALECI_Staging_put(c->staging, bbuf[t]);
+        }
+
+        if (m*n > 0) {
+            rc = DALEC_Release_update(c, lo, hi);
+            if (rc != DALEC_SUCCESS) return rc;
+        }
+
+        MPI_Comm_free(&rowcomm);
+        MPI_Comm_free(&colcomm);
+    }
+
+    return DALEC_Sync(c);
+}
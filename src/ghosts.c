@@ -0,0 +1,464 @@
+/*
+ * Copyright (C) 2014. See COPYRIGHT in top-level directory.
+ */
+
+#include <dalec.h>
+#include <dalec_guts.h>
+#include <debug.h>
+
+/* The halo of a block is the part of its padded block outside the block,
+ * cut into one region per neighbor direction: 2*ndim faces, or 3^ndim-1
+ * regions with edges and corners.  Along a periodic dimension a region
+ * past the end of the array wraps around; otherwise it is clipped.  Every
+ * region is intersected with the blocks of its owners, which can be more
+ * than one when blocks are narrower than the ghosts.  Every rank computes
+ * the pieces it receives and, for the ranks near it, the pieces they
+ * receive from it, both in the same order, and turns them into one
+ * datatype per neighbor on its padded block.  The exchange is then a
+ * single MPI_Neighbor_alltoallw on a distributed-graph communicator,
+ * persistent with MPI-4.  Both the graph and the datatypes are built on
+ * the first update and kept with the array. */
+
+struct DALECI_Halo_s {
+    int            ready[2];            /* exchange without and with corners is built   */
+    MPI_Comm       graph[2];            /* neighbors that pieces come from and go to    */
+    int          * counts[2];           /* one instance of each datatype                */
+    MPI_Aint     * displs[2];           /* all relative to the padded block             */
+    MPI_Datatype * sendtypes[2];        /* interior cells that each destination needs   */
+    MPI_Datatype * recvtypes[2];        /* ghost cells that each source fills           */
+    int            nsend[2], nrecv[2];
+#if MPI_VERSION >= 4
+    MPI_Request    request[2];          /* persistent exchange                          */
+#endif
+};
+
+/* cells of a halo region that one rank owns */
+typedef struct {
+    int    peer;                        /* owner, or receiver when sending              */
+    size_t seq;                         /* generation order                             */
+    int    starts[DALEC_ARRAY_MAX_DIM]; /* in the padded block of this rank             */
+    int    subsizes[DALEC_ARRAY_MAX_DIM];
+} DALECI_Halo_piece;
+
+/* part of a halo region along one dimension */
+typedef struct {
+    size_t lo;                          /* first global index                           */
+    size_t len;                         /* number of indices                            */
+    size_t start;                       /* first index in the padded block              */
+} DALECI_Halo_range;
+
+typedef struct {
+    DALECI_Halo_piece * pieces;
+    size_t              count;
+    size_t              capacity;
+} DALECI_Halo_list;
+
+/** The parts of the halo of the block of grid coordinate c along dimension
+  * i in direction dir (-1, 0 for the block itself, or 1).
+  *
+  * @return            Number of parts (0, 1 or 2)
+  */
+static int DALECI_Halo_ranges(const DALEC_Array_handle * h, int i, int c, int dir, DALECI_Halo_range r[2])
+{
+    const size_t lo = DALECI_Block_lo(h, i, c), ext = DALECI_Block_extent(h, i, c);
+    const size_t g = h->ghosts[i], dim = h->dims[i];
+    int n = 0;
+
+    if (dir == 0) {
+        r[n++] = (DALECI_Halo_range){ lo, ext, g };
+    } else if (g == 0) {
+        /* no halo in this direction */
+    } else if (dir < 0) {
+        if (lo >= g) {
+            r[n++] = (DALECI_Halo_range){ lo - g, g, 0 };
+        } else {
+            if (h->periodic[i]) r[n++] = (DALECI_Halo_range){ dim - (g - lo), g - lo, 0 };
+            if (lo > 0)         r[n++] = (DALECI_Halo_range){ 0, lo, g - lo };
+        }
+    } else {
+        const size_t end = lo + ext;
+        const size_t in = (g < dim - end) ? g : dim - end;
+        if (in > 0)                    r[n++] = (DALECI_Halo_range){ end, in, g + ext };
+        if (h->periodic[i] && in < g)  r[n++] = (DALECI_Halo_range){ 0, g - in, g + ext + in };
+    }
+    return n;
+}
+
+/** Append a piece to a list.
+  *
+  * @return            Zero on success
+  */
+static int DALECI_Halo_push(DALECI_Halo_list * l, const DALECI_Halo_piece * p)
+{
+    if (l->count == l->capacity) {
+        l->capacity = (l->capacity > 0) ? 2*l->capacity : 64;
+        DALECI_Halo_piece * pieces = realloc(l->pieces, l->capacity * sizeof(DALECI_Halo_piece));
+        if (pieces == NULL) {
+            DALECI_Error("realloc of %zu halo pieces failed", l->capacity);
+            return DALEC_INPUT_ERROR;
+        }
+        l->pieces = pieces;
+    }
+    l->pieces[l->count] = *p;
+    l->pieces[l->count].seq = l->count;
+    l->count++;
+    return DALEC_SUCCESS;
+}
+
+/** Generate, in a fixed order, the pieces of the halo of the block of grid
+  * coordinates c.  With recv set, append the pieces that the block receives,
+  * by owner.  Otherwise append the pieces that it receives from the caller,
+  * by grid rank of c, relative to the padded block of the caller.
+  *
+  * @return            Zero on success
+  */
+static int DALECI_Halo_pieces(const DALEC_Array_handle * h, const int c[], int corners, int recv, DALECI_Halo_list * l)
+{
+    int rc;
+
+    const int ndim = h->ndim;
+    int me = -1, self = 0;
+    MPI_Comm_rank(h->comm, &me);
+    for (int i=0; i<ndim; i++) {
+        if (DALECI_Block_extent(h, i, c[i]) == 0) return DALEC_SUCCESS;
+        self = self * h->pedims[i] + c[i];
+    }
+
+    int ndirs = 1;
+    for (int i=0; i<ndim; i++) ndirs *= 3;
+
+    for (int code=0; code<ndirs; code++) {
+        int dir[DALEC_ARRAY_MAX_DIM], nonzero = 0;
+        for (int i=ndim-1, x=code; i>=0; i--, x/=3) {
+            dir[i] = x%3 - 1;
+            nonzero += (dir[i] != 0);
+        }
+        if (nonzero == 0 || (!corners && nonzero > 1)) continue;
+
+        DALECI_Halo_range ranges[DALEC_ARRAY_MAX_DIM][2];
+        int nranges[DALEC_ARRAY_MAX_DIM], first[DALEC_ARRAY_MAX_DIM], last[DALEC_ARRAY_MAX_DIM], k[DALEC_ARRAY_MAX_DIM];
+        int empty = 0;
+        for (int i=0; i<ndim; i++) {
+            nranges[i] = DALECI_Halo_ranges(h, i, c[i], dir[i], ranges[i]);
+            empty |= (nranges[i] == 0);
+            first[i] = 0;
+            last[i]  = nranges[i]-1;
+            k[i]     = 0;
+        }
+        if (empty) continue;
+
+        /* every combination of the parts along each dimension is a box */
+        do {
+            size_t lo[DALEC_ARRAY_MAX_DIM], hi[DALEC_ARRAY_MAX_DIM];
+            for (int i=0; i<ndim; i++) {
+                lo[i] = ranges[i][k[i]].lo;
+                hi[i] = lo[i] + ranges[i][k[i]].len - 1;
+            }
+
+            int cfirst[DALEC_ARRAY_MAX_DIM], clast[DALEC_ARRAY_MAX_DIM], oc[DALEC_ARRAY_MAX_DIM];
+            DALECI_Split_patch(h, lo, hi, cfirst, clast);
+            for (int i=0; i<ndim; i++) oc[i] = cfirst[i];
+
+            do {
+                DALECI_Halo_piece p;
+                int owner = 0, none = 0;
+                for (int i=0; i<ndim; i++) {
+                    const size_t blo = DALECI_Block_lo(h, i, oc[i]);
+                    const size_t bhi = DALECI_Block_lo(h, i, oc[i]+1);
+                    const size_t plo = (lo[i] > blo) ? lo[i] : blo;
+                    const size_t phi = (hi[i]+1 < bhi) ? hi[i]+1 : bhi;
+                    if (phi <= plo) none = 1;
+                    p.subsizes[i] = none ? 0 : (int)(phi-plo);
+                    p.starts[i]   = none ? 0 : recv ? (int)(ranges[i][k[i]].start + plo - lo[i])
+                                                    : (int)(plo - blo + h->ghosts[i]);
+                    owner = owner * h->pedims[i] + oc[i];
+                }
+                if (none) continue;
+                if (recv) {
+                    p.peer = owner;
+                } else if (owner == me) {
+                    p.peer = self;
+                } else {
+                    continue;
+                }
+                rc = DALECI_Halo_push(l, &p);
+                if (rc != DALEC_SUCCESS) return rc;
+            } while (DALECI_Next_coord(ndim, cfirst, clast, oc));
+        } while (DALECI_Next_coord(ndim, first, last, k));
+    }
+
+    return DALEC_SUCCESS;
+}
+
+static int DALECI_Halo_compare(const void * a, const void * b)
+{
+    const DALECI_Halo_piece * x = a, * y = b;
+    if (x->peer != y->peer) return (x->peer < y->peer) ? -1 : 1;
+    return (x->seq < y->seq) ? -1 : (x->seq > y->seq);
+}
+
+/** Sort the pieces by peer and make one datatype per peer.
+  *
+  * @param[out] peers  Distinct peers, in ascending order
+  * @param[out] types  Datatype of each peer
+  * @return            Number of peers
+  */
+static int DALECI_Halo_types(const DALEC_Array_handle * h, DALECI_Halo_list * l, int ** peers, MPI_Datatype ** types)
+{
+    int rc;
+
+    qsort(l->pieces, l->count, sizeof(DALECI_Halo_piece), DALECI_Halo_compare);
+
+    int npeers = 0;
+    for (size_t j=0; j<l->count; j++) {
+        npeers += (j == 0 || l->pieces[j].peer != l->pieces[j-1].peer);
+    }
+    *peers = malloc((npeers+1) * sizeof(int));
+    *types = malloc((npeers+1) * sizeof(MPI_Datatype));
+    MPI_Datatype * parts = malloc((l->count+1) * sizeof(MPI_Datatype));
+    int * ones = malloc((l->count+1) * sizeof(int));
+    MPI_Aint * zeros = calloc(l->count+1, sizeof(MPI_Aint));
+    if (*peers == NULL || *types == NULL || parts == NULL || ones == NULL || zeros == NULL) {
+        DALECI_Error("malloc for %d halo neighbors failed", npeers);
+        return -1;
+    }
+
+    int sizes[DALEC_ARRAY_MAX_DIM];
+    for (int i=0; i<h->ndim; i++) {
+        sizes[i] = (int)(h->local_dims[i] + 2*h->ghosts[i]);
+    }
+
+    int n = 0;
+    for (size_t j=0, first=0; j<l->count; j++) {
+        DALECI_Halo_piece * p = &(l->pieces[j]);
+        rc = MPI_Type_create_subarray(h->ndim, sizes, p->subsizes, p->starts, MPI_ORDER_C, h->type, &parts[j]);
+        DALECI_Check_MPI(__func__, "MPI_Type_create_subarray", rc);
+        ones[j] = 1;
+
+        if (j+1 < l->count && l->pieces[j+1].peer == p->peer) continue;
+
+        /* the pieces of one peer in generation order, which both sides agree on */
+        const int nparts = (int)(j+1-first);
+        if (nparts == 1) {
+            (*types)[n] = parts[first];
+        } else {
+            rc = MPI_Type_create_struct(nparts, ones, zeros, &parts[first], &(*types)[n]);
+            DALECI_Check_MPI(__func__, "MPI_Type_create_struct", rc);
+            for (size_t q=first; q<=j; q++) {
+                MPI_Type_free(&parts[q]);
+            }
+        }
+        rc = MPI_Type_commit(&(*types)[n]);
+        DALECI_Check_MPI(__func__, "MPI_Type_commit", rc);
+        (*peers)[n++] = p->peer;
+        first = j+1;
+    }
+
+    free(zeros);
+    free(ones);
+    free(parts);
+
+    return n;
+}
+
+/** Build the exchange with or without corners.
+  *
+  * @return            Zero on success
+  */
+static int DALECI_Halo_build(const DALEC_Array_handle * h, int corners)
+{
+    int rc;
+
+    struct DALECI_Halo_s * halo = h->halo;
+    const int ndim = h->ndim;
+    DALECI_Halo_list recv = { NULL, 0, 0 }, send = { NULL, 0, 0 };
+
+    int owner = (h->coords[0] >= 0);
+    for (int i=0; i<ndim; i++) {
+        owner &= (h->local_dims[i] > 0);
+    }
+
+    if (owner) {
+        rc = DALECI_Halo_pieces(h, h->coords, corners, 1, &recv);
+        if (rc != DALEC_SUCCESS) return rc;
+
+        /* the blocks whose halos can reach this one are within the ghost
+         * widths of it, which is the same as reaching them */
+        char * near[DALEC_ARRAY_MAX_DIM];
+        int cfirst[DALEC_ARRAY_MAX_DIM], clast[DALEC_ARRAY_MAX_DIM], c[DALEC_ARRAY_MAX_DIM];
+        for (int i=0; i<ndim; i++) {
+            near[i] = calloc(h->pedims[i], 1);
+            if (near[i] == NULL) {
+                DALECI_Error("calloc of %d grid coordinates failed", h->pedims[i]);
+                return DALEC_INPUT_ERROR;
+            }
+            for (int dir=-1; dir<=1; dir++) {
+                DALECI_Halo_range r[2];
+                const int n = DALECI_Halo_ranges(h, i, h->coords[i], dir, r);
+                for (int j=0; j<n; j++) {
+                    const int clo = DALECI_Block_coord(h, i, r[j].lo);
+                    const int chi = DALECI_Block_coord(h, i, r[j].lo + r[j].len - 1);
+                    for (int x=clo; x<=chi; x++) near[i][x] = 1;
+                }
+            }
+            cfirst[i] = 0;
+            clast[i]  = h->pedims[i]-1;
+            c[i]      = 0;
+        }
+        do {
+            int skip = 0;
+            for (int i=0; i<ndim; i++) skip |= !near[i][c[i]];
+            if (skip) continue;
+            rc = DALECI_Halo_pieces(h, c, corners, 0, &send);
+            if (rc != DALEC_SUCCESS) return rc;
+        } while (DALECI_Next_coord(ndim, cfirst, clast, c));
+        for (int i=0; i<ndim; i++) {
+            free(near[i]);
+        }
+    }
+
+    int * sources = NULL, * destinations = NULL;
+    halo->nrecv[corners] = DALECI_Halo_types(h, &recv, &sources, &halo->recvtypes[corners]);
+    halo->nsend[corners] = DALECI_Halo_types(h, &send, &destinations, &halo->sendtypes[corners]);
+    if (halo->nrecv[corners] < 0 || halo->nsend[corners] < 0) return DALEC_INPUT_ERROR;
+    free(recv.pieces);
+    free(send.pieces);
+
+    const int nmax = (halo->nrecv[corners] > halo->nsend[corners]) ? halo->nrecv[corners] : halo->nsend[corners];
+    halo->counts[corners] = malloc((nmax+1) * sizeof(int));
+    halo->displs[corners] = calloc(nmax+1, sizeof(MPI_Aint));
+    if (halo->counts[corners] == NULL || halo->displs[corners] == NULL) {
+        DALECI_Error("malloc for %d halo neighbors failed", nmax);
+        return DALEC_INPUT_ERROR;
+    }
+    for (int j=0; j<=nmax; j++) {
+        halo->counts[corners][j] = 1;
+    }
+
+    DALECI_Dbg_print(DEBUG_CAT_ARRAY_DIST, "halo %s corners: %d sources, %d destinations\n",
+                     corners ? "with" : "without", halo->nrecv[corners], halo->nsend[corners]);
+
+    /* unit weights rather than MPI_UNWEIGHTED, which Open MPI defines as a
+     * bogus pointer that compilers warn about; all ranks give weights */
+    rc = MPI_Dist_graph_create_adjacent(h->comm, halo->nrecv[corners], sources, halo->counts[corners],
+                                        halo->nsend[corners], destinations, halo->counts[corners],
+                                        MPI_INFO_NULL, 0, &halo->graph[corners]);
+    DALECI_Check_MPI(__func__, "MPI_Dist_graph_create_adjacent", rc);
+    free(sources);
+    free(destinations);
+
+#if MPI_VERSION >= 4
+    rc = MPI_Neighbor_alltoallw_init(h->base, halo->counts[corners], halo->displs[corners], halo->sendtypes[corners],
+                                     h->base, halo->counts[corners], halo->displs[corners], halo->recvtypes[corners],
+                                     halo->graph[corners], MPI_INFO_NULL, &halo->request[corners]);
+    DALECI_Check_MPI(__func__, "MPI_Neighbor_alltoallw_init", rc);
+#endif
+
+    halo->ready[corners] = 1;
+
+    return DALEC_SUCCESS;
+}
+
+/** Set up the ghost cell state of an array that has ghost cells.
+  *
+  * @return            Zero on success
+  */
+int DALECI_Halo_create(DALEC_Array_handle * h)
+{
+    int any = 0;
+    for (int i=0; i<h->ndim; i++) {
+        any |= (h->ghosts[i] > 0);
+    }
+    if (!any) return DALEC_SUCCESS;
+
+    h->halo = calloc(1, sizeof(struct DALECI_Halo_s));
+    if (h->halo == NULL) {
+        DALECI_Error("calloc of halo state failed");
+        return DALEC_INPUT_ERROR;
+    }
+    return DALEC_SUCCESS;
+}
+
+/** Free the ghost cell state of an array. */
+void DALECI_Halo_free(DALEC_Array_handle * h)
+{
+    struct DALECI_Halo_s * halo = h->halo;
+    if (halo == NULL) return;
+
+    for (int k=0; k<2; k++) {
+        if (!halo->ready[k]) continue;
+#if MPI_VERSION >= 4
+        MPI_Request_free(&halo->request[k]);
+#endif
+        for (int j=0; j<halo->nsend[k]; j++) MPI_Type_free(&halo->sendtypes[k][j]);
+        for (int j=0; j<halo->nrecv[k]; j++) MPI_Type_free(&halo->recvtypes[k][j]);
+        free(halo->sendtypes[k]);
+        free(halo->recvtypes[k]);
+        free(halo->counts[k]);
+        free(halo->displs[k]);
+        MPI_Comm_free(&halo->graph[k]);
+    }
+    free(halo);
+    h->halo = NULL;
+}
+
+/* -- begin weak symbols block -- */
+#if defined(HAVE_PRAGMA_WEAK)
+#  pragma weak DALEC_Update_ghosts = PDALEC_Update_ghosts
+#elif defined(HAVE_PRAGMA_HP_SEC_DEF)
+#  pragma _HP_SECONDARY_DEF PDALEC_Update_ghosts DALEC_Update_ghosts
+#elif defined(HAVE_PRAGMA_CRI_DUP)
+#  pragma _CRI duplicate DALEC_Update_ghosts as PDALEC_Update_ghosts
+#elif defined(HAVE_WEAK_ATTRIBUTE)
+int DALEC_Update_ghosts(const DALEC_Array_handle * h, int corners) __attribute__ ((weak, alias("PDALEC_Update_ghosts")));
+#else
+#define DALEC_Update_ghosts PDALEC_Update_ghosts
+#endif
+/* -- end weak symbols block -- */
+
+/** Refresh the ghost cells of every block from the blocks that own them.
+  * Ghost cells past the ends of a dimension that is not periodic are left
+  * alone.  Collective.
+  *
+  * @param[in] h       Array handle
+  * @param[in] corners Nonzero to refresh the edge and corner regions too,
+  *                    otherwise only the faces
+  * @return            Zero on success
+  */
+int DALEC_Update_ghosts(const DALEC_Array_handle * h, int corners)
+{
+    int rc;
+
+    if (h == NULL) {
+        DALECI_Error("h is a null pointer");
+        return DALEC_INPUT_ERROR;
+    }
+    if (h->halo == NULL) {
+        return DALEC_SUCCESS;
+    }
+
+    /* the interiors must be complete before they are sent */
+    rc = DALEC_Sync(h);
+    if (rc != DALEC_SUCCESS) return rc;
+
+    corners = (corners != 0);
+    struct DALECI_Halo_s * halo = h->halo;
+    if (!halo->ready[corners]) {
+        rc = DALECI_Halo_build(h, corners);
+        if (rc != DALEC_SUCCESS) return rc;
+    }
+
+#if MPI_VERSION >= 4
+    rc = MPI_Start(&halo->request[corners]);
+    DALECI_Check_MPI(__func__, "MPI_Start", rc);
+    rc = MPI_Wait(&halo->request[corners], MPI_STATUS_IGNORE);
+    DALECI_Check_MPI(__func__, "MPI_Wait", rc);
+#else
+    rc = MPI_Neighbor_alltoallw(h->base, halo->counts[corners], halo->displs[corners], halo->sendtypes[corners],
+                                h->base, halo->counts[corners], halo->displs[corners], halo->recvtypes[corners],
+                                halo->graph[corners]);
+    DALECI_Check_MPI(__func__, "MPI_Neighbor_alltoallw", rc);
+#endif
+
+    return DALEC_SUCCESS;
+}
@@ -93,7 +93,11 @@ int DALEC_Finalize(void)
             DALECI_Warning("MPI must be active when calling DALEC_Finalize");
             return DALEC_ERROR_MPI_USAGE;
         } else {
-            int rc = MPI_Comm_free(&DALECI_GLOBAL_STATE.mpi_comm);
+            /* windows of destroyed arrays */
+            int rc = DALECI_Pool_free_all();
+            if (rc != DALEC_SUCCESS) return rc;
+
+            rc = MPI_Comm_free(&DALECI_GLOBAL_STATE.mpi_comm);
             return DALECI_Check_MPI("DALEC_Finalize", "MPI_Comm_free", rc);
         }
     } else {
@@ -0,0 +1,233 @@
+/*
+ * Copyright (C) 2014. See COPYRIGHT in top-level directory.
+ */
+
+#include <complex.h>
+
+#include <dalec.h>
+#include <dalec_guts.h>
+#include <debug.h>
+
+/* Element-wise kernels on local buffers, and the panel update of
+ * DALEC_Gemm.  The loops are kept trivial so that the compiler vectorizes
+ * them, and with OpenMP the long ones are also split across threads.
+ * Element-wise results may alias inputs element for element, which is why
+ * only the packing and multiply kernels use restrict. */
+
+#if defined(_OPENMP)
+#  define DALECI_PRAGMA_SIMD         _Pragma("omp simd")
+#  define DALECI_PRAGMA_PARALLEL     _Pragma("omp parallel for simd if(n > 32768)")
+#  define DALECI_PRAGMA_PARALLEL_SUM _Pragma("omp parallel for simd reduction(+:sum) if(n > 32768)")
+#  define DALECI_PRAGMA_PARALLEL_RI  _Pragma("omp parallel for simd reduction(+:re,im) if(n > 32768)")
+#  define DALECI_PRAGMA_PARALLEL_ROW _Pragma("omp parallel for if(m*n*k > 32768)")
+#else
+#  define DALECI_PRAGMA_SIMD
+#  define DALECI_PRAGMA_PARALLEL
+#  define DALECI_PRAGMA_PARALLEL_SUM
+#  define DALECI_PRAGMA_PARALLEL_RI
+#  define DALECI_PRAGMA_PARALLEL_ROW
+#endif
+
+#define DALECI_KERNELS(SUFFIX_, T_)                                                 \
+static void DALECI_Scale_##SUFFIX_(size_t n, T_ alpha, const T_ * restrict src, T_ * restrict dst) \
+{                                                                                   \
+    DALECI_PRAGMA_SIMD                                                              \
+    for (size_t i=0; i<n; i++) {                                                    \
+        dst[i] = alpha * src[i];                                                    \
+    }                                                                               \
+}                                                                                   \
+static void DALECI_Fill_##SUFFIX_(size_t n, T_ value, T_ * dst)                     \
+{                                                                                   \
+    DALECI_PRAGMA_PARALLEL                                                          \
+    for (size_t i=0; i<n; i++) {                                                    \
+        dst[i] = value;                                                             \
+    }                                                                               \
+}                                                                                   \
+static void DALECI_Axpby_##SUFFIX_(size_t n, T_ alpha, const T_ * a, T_ beta, const T_ * b, T_ * c) \
+{                                                                                   \
+    if (b == NULL) {                                                                \
+        DALECI_PRAGMA_PARALLEL                                                      \
+        for (size_t i=0; i<n; i++) {                                                \
+            c[i] = alpha * a[i];                                                    \
+        }                                                                           \
+    } else {                                                                        \
+        DALECI_PRAGMA_PARALLEL                                                      \
+        for (size_t i=0; i<n; i++) {                                                \
+            c[i] = alpha * a[i] + beta * b[i];                                      \
+        }                                                                           \
+    }                                                                               \
+}                                                                                   \
+static void DALECI_Gemm_##SUFFIX_(size_t m, size_t n, size_t k, T_ alpha,          \
+                                  const T_ * a, size_t lda, const T_ * b, size_t ldb, \
+                                  T_ * c, size_t ldc)                               \
+{                                                                                   \
+    DALECI_PRAGMA_PARALLEL_ROW                                                      \
+    for (size_t i=0; i<m; i++) {                                                    \
+        T_ * restrict ci = c + i*ldc;                                               \
+        for (size_t p=0; p<k; p++) {                                                \
+            const T_ aip = alpha * a[i*lda + p];                                    \
+            const T_ * restrict bp = b + p*ldb;                                     \
+            DALECI_PRAGMA_SIMD                                                      \
+            for (size_t j=0; j<n; j++) {                                            \
+                ci[j] += aip * bp[j];                                               \
+            }                                                                       \
+        }                                                                           \
+    }                                                                               \
+}
+
+#define DALECI_REAL_KERNELS(SUFFIX_, T_)                                            \
+DALECI_KERNELS(SUFFIX_, T_)                                                         \
+static T_ DALECI_Dot_##SUFFIX_(size_t n, const T_ * a, const T_ * b)                \
+{                                                                                   \
+    T_ sum = 0;                                                                     \
+    DALECI_PRAGMA_PARALLEL_SUM                                                      \
+    for (size_t i=0; i<n; i++) {                                                    \
+        sum += a[i] * b[i];                                                         \
+    }                                                                               \
+    return sum;                                                                     \
+}                                                                                   \
+static double DALECI_Sumsq_##SUFFIX_(size_t n, const T_ * a)                        \
+{                                                                                   \
+    double sum = 0;                                                                 \
+    DALECI_PRAGMA_PARALLEL_SUM                                                      \
+    for (size_t i=0; i<n; i++) {                                                    \
+        sum += (double)a[i] * (double)a[i];                                         \
+    }                                                                               \
+    return sum;                                                                     \
+}
+
+/* OpenMP has no complex reductions in C, so the parts are reduced apart */
+#define DALECI_COMPLEX_KERNELS(SUFFIX_, T_, R_)                                     \
+DALECI_KERNELS(SUFFIX_, T_)                                                         \
+static T_ DALECI_Dot_##SUFFIX_(size_t n, const T_ * a, const T_ * b)                \
+{                                                                                   \
+    const R_ * x = (const R_ *)a, * y = (const R_ *)b;                              \
+    R_ re = 0, im = 0;                                                              \
+    DALECI_PRAGMA_PARALLEL_RI                                                       \
+    for (size_t i=0; i<n; i++) {                                                    \
+        re += x[2*i] * y[2*i]   - x[2*i+1] * y[2*i+1];                              \
+        im += x[2*i] * y[2*i+1] + x[2*i+1] * y[2*i];                                \
+    }                                                                               \
+    return re + im * I;                                                             \
+}                                                                                   \
+static double DALECI_Sumsq_##SUFFIX_(size_t n, const T_ * a)                        \
+{                                                                                   \
+    const R_ * x = (const R_ *)a;                                                   \
+    double sum = 0;                                                                 \
+    DALECI_PRAGMA_PARALLEL_SUM                                                      \
+    for (size_t i=0; i<2*n; i++) {                                                  \
+        sum += (double)x[i] * (double)x[i];                                         \
+    }                                                                               \
+    return sum;                                                                     \
+}
+
+DALECI_REAL_KERNELS(int,      int)
+DALECI_REAL_KERNELS(long,     long)
+DALECI_REAL_KERNELS(longlong, long long)
+DALECI_REAL_KERNELS(float,    float)
+DALECI_REAL_KERNELS(double,   double)
+DALECI_COMPLEX_KERNELS(cfloat,  float _Complex,  float)
+DALECI_COMPLEX_KERNELS(cdouble, double _Complex, double)
+
+/* expand CALL_(suffix, C type) for the C type that matches an MPI type */
+#define DALECI_DISPATCH(type_, CALL_)                                               \
+    if      ((type_) == MPI_INT)              { CALL_(int,      int);              } \
+    else if ((type_) == MPI_LONG)             { CALL_(long,     long);             } \
+    else if ((type_) == MPI_LONG_LONG)        { CALL_(longlong, long long);        } \
+    else if ((type_) == MPI_FLOAT)            { CALL_(float,    float);            } \
+    else if ((type_) == MPI_DOUBLE)           { CALL_(double,   double);           } \
+    else if ((type_) == MPI_C_FLOAT_COMPLEX)  { CALL_(cfloat,   float _Complex);   } \
+    else if ((type_) == MPI_C_DOUBLE_COMPLEX) { CALL_(cdouble,  double _Complex);  } \
+    else {                                                                          \
+        DALECI_Error("the type of this array is not supported by this operation"); \
+        return DALEC_INPUT_ERROR;                                                   \
+    }
+
+/** Check whether a scale factor is one, in which case no scaling is needed.
+  *
+  * @return            Nonzero if alpha is NULL or one
+  */
+int DALECI_Scale_is_one(MPI_Datatype type, const void * alpha)
+{
+    if (alpha == NULL) return 1;
+
+#define DALECI_IS_ONE(S_, T_) return *(const T_*)alpha == 1
+    DALECI_DISPATCH(type, DALECI_IS_ONE)
+#undef DALECI_IS_ONE
+}
+
+/** Scale n elements of src by alpha into dst, which must not overlap.
+  *
+  * @return            Zero on success
+  */
+int DALECI_Scale(MPI_Datatype type, size_t n, const void * alpha, const void * src, void * dst)
+{
+#define DALECI_CALL(S_, T_) DALECI_Scale_##S_(n, *(const T_*)alpha, src, dst)
+    DALECI_DISPATCH(type, DALECI_CALL)
+#undef DALECI_CALL
+    return DALEC_SUCCESS;
+}
+
+/** Set n elements of dst to value.
+  *
+  * @return            Zero on success
+  */
+int DALECI_Fill(MPI_Datatype type, size_t n, const void * value, void * dst)
+{
+#define DALECI_CALL(S_, T_) DALECI_Fill_##S_(n, *(const T_*)value, dst)
+    DALECI_DISPATCH(type, DALECI_CALL)
+#undef DALECI_CALL
+    return DALEC_SUCCESS;
+}
+
+/** Compute c = alpha*a + beta*b element-wise, or c = alpha*a if b is NULL.
+  * c may be a or b.
+  *
+  * @return            Zero on success
+  */
+int DALECI_Axpby(MPI_Datatype type, size_t n, const void * alpha, const void * a,
+                 const void * beta, const void * b, void * c)
+{
+#define DALECI_CALL(S_, T_) DALECI_Axpby_##S_(n, *(const T_*)alpha, a, (b != NULL) ? *(const T_*)beta : 0, b, c)
+    DALECI_DISPATCH(type, DALECI_CALL)
+#undef DALECI_CALL
+    return DALEC_SUCCESS;
+}
+
+/** Compute the sum of a[i]*b[i], without conjugation, into result.
+  *
+  * @return            Zero on success
+  */
+int DALECI_Dot(MPI_Datatype type, size_t n, const void * a, const void * b, void * result)
+{
+#define DALECI_CALL(S_, T_) *(T_*)result = DALECI_Dot_##S_(n, a, b)
+    DALECI_DISPATCH(type, DALECI_CALL)
+#undef DALECI_CALL
+    return DALEC_SUCCESS;
+}
+
+/** Compute the sum of |a[i]|^2 in double precision into result.
+  *
+  * @return            Zero on success
+  */
+int DALECI_Sumsq(MPI_Datatype type, size_t n, const void * a, double * result)
+{
+#define DALECI_CALL(S_, T_) *result = DALECI_Sumsq_##S_(n, a)
+    DALECI_DISPATCH(type, DALECI_CALL)
+#undef DALECI_CALL
+    return DALEC_SUCCESS;
+}
+
+/** Compute c += alpha*a*b for row-major a (m by k), b (k by n) and c (m by n)
+  * with leading dimensions lda, ldb and ldc.  c must not overlap a or b.
+  *
+  * @return            Zero on success
+  */
+int DALECI_Gemm(MPI_Datatype type, size_t m, size_t n, size_t k, const void * alpha,
+                const void * a, size_t lda, const void * b, size_t ldb, void * c, size_t ldc)
+{
+#define DALECI_CALL(S_, T_) DALECI_Gemm_##S_(m, n, k, *(const T_*)alpha, a, lda, b, ldb, c, ldc)
+    DALECI_DISPATCH(type, DALECI_CALL)
+#undef DALECI_CALL
+    return DALEC_SUCCESS;
+}
@@ -0,0 +1,517 @@
+/*
+ * Copyright (C) 2014. See COPYRIGHT in top-level directory.
+ */
+
+#include <dalec.h>
+#include <dalec_guts.h>
+#include <debug.h>
+
+/** Check the arguments that describe a patch and the user buffer that holds it.
+  *
+  * @return            Zero on success
+  */
+int DALECI_Check_patch(const DALEC_Array_handle * h, const size_t lo[], const size_t hi[],
+                       const void * buf, const size_t ld[])
+{
+    if (h==NULL || lo==NULL || hi==NULL || buf==NULL || (ld==NULL && h->ndim>1)) {
+        DALECI_Error("h (%p), lo (%p), hi (%p), buf (%p) or ld (%p) is a null pointer", h, lo, hi, buf, ld);
+        return DALEC_INPUT_ERROR;
+    }
+    for (int i=0; i<h->ndim; i++) {
+        if (lo[i] > hi[i] || hi[i] >= h->dims[i]) {
+            DALECI_Error("patch [%zu,%zu] is not within dims[%d] = %zu", lo[i], hi[i], i, h->dims[i]);
+            return DALEC_INPUT_ERROR;
+        }
+        if (i>0 && ld[i-1] < hi[i]-lo[i]+1) {
+            DALECI_Error("ld[%d] (%zu) is smaller than the patch extent (%zu)", i-1, ld[i-1], hi[i]-lo[i]+1);
+            return DALEC_INPUT_ERROR;
+        }
+    }
+    return DALEC_SUCCESS;
+}
+
+/** Build the datatype of the user buffer for the part of a patch that the
+  * owner of segments c holds, when the owner holds several blocks of it
+  * along some dimension of a block-cyclic array.
+  *
+  * @return            Zero on success
+  */
+static int DALECI_Patch_origin_type(const DALEC_Array_handle * h, const size_t lo[], const size_t hi[],
+                                    const int c[], const int osizes[], MPI_Datatype * otype)
+{
+    int nruns[DALEC_ARRAY_MAX_DIM], * starts[DALEC_ARRAY_MAX_DIM] = {NULL}, * lens[DALEC_ARRAY_MAX_DIM];
+    for (int i=0; i<h->ndim; i++) {
+        const size_t p    = h->pedims[i];
+        const size_t last = c[i] + (DALECI_Seg_of(h, i, hi[i]) - c[i]) / p * p;
+        nruns[i]  = (int)((last - c[i]) / p + 1);
+        starts[i] = malloc(2 * nruns[i] * sizeof(int));
+        if (starts[i] == NULL) {
+            DALECI_Error("malloc of %d runs failed", nruns[i]);
+            return DALEC_INPUT_ERROR;
+        }
+        lens[i] = starts[i] + nruns[i];
+        for (int k=0; k<nruns[i]; k++) {
+            const size_t s   = c[i] + k*p;
+            const size_t slo = DALECI_Seg_lo(h, i, s), shi = DALECI_Seg_lo(h, i, s+1);
+            const size_t rlo = (lo[i] > slo) ? lo[i] : slo;
+            const size_t rhi = (hi[i]+1 < shi) ? hi[i]+1 : shi;
+            starts[i][k] = (int)(rlo - lo[i]);
+            lens[i][k]   = (int)(rhi - rlo);
+        }
+    }
+
+    int rc = DALECI_Runs_type(h->ndim, osizes, nruns, starts, lens, h->type, otype);
+
+    for (int i=0; i<h->ndim; i++) {
+        free(starts[i]);
+    }
+    return rc;
+}
+
+/** Move a patch between a user buffer and the array.  The patch is split
+  * along the block bounds and each owner is reached with a single RMA
+  * operation, using subarray datatypes to describe both the user buffer and
+  * the block of the owner.  The blocks of a block-cyclic array that one
+  * owner holds are contiguous in its memory, so only the user buffer then
+  * needs a more general datatype.
+  *
+  * Without a request the operation is locally complete on return.
+  * Otherwise request-based RMA is used and local completion is deferred to
+  * DALEC_Wait and friends.  Either way, updates are recorded as in flight
+  * until DALEC_Fence or DALEC_Sync completes them at the owners.
+  *
+  * @param[in] op      DALECI_OP_PUT, DALECI_OP_GET or DALECI_OP_ACC
+  * @param[in] h       Array handle
+  * @param[in] lo      Lowest global index of the patch in each dimension
+  * @param[in] hi      Highest global index of the patch in each dimension (inclusive)
+  * @param[in] buf     User buffer
+  * @param[in] ld      Extents of dimensions 1..ndim-1 of the user buffer
+  * @param[in] alpha   Scale factor for DALECI_OP_ACC, or NULL for one
+  * @param[out] req    Request to complete later, or NULL for a blocking operation
+  * @return            Zero on success
+  */
+int DALECI_Patch_op(enum DALECI_Op_e op, const DALEC_Array_handle * h,
+                    const size_t lo[], const size_t hi[], void * buf, const size_t ld[],
+                    const void * alpha, DALEC_Request * req)
+{
+    int rc; /* MPI return code */
+
+    const int ndim = h->ndim;
+
+    int type_size = 0;
+    rc = MPI_Type_size(h->type, &type_size);
+    DALECI_Check_MPI(__func__, "MPI_Type_size", rc);
+
+    /* the segments that stand for the owners of the patch */
+    int cfirst[DALEC_ARRAY_MAX_DIM], clast[DALEC_ARRAY_MAX_DIM], c[DALEC_ARRAY_MAX_DIM];
+    const int count = DALECI_Split_patch(h, lo, hi, cfirst, clast);
+    for (int i=0; i<ndim; i++) {
+        c[i] = cfirst[i];
+    }
+
+    int * targets = NULL;
+    if (req == NULL) {
+        targets = malloc(count * sizeof(int));
+        if (targets == NULL) {
+            DALECI_Error("malloc of %d targets failed", count);
+            return DALEC_INPUT_ERROR;
+        }
+    } else {
+        req->reqs = malloc(count * sizeof(MPI_Request));
+        if (req->reqs == NULL) {
+            DALECI_Error("malloc of %d requests failed", count);
+            return DALEC_INPUT_ERROR;
+        }
+        req->pool    = h->staging;
+        req->staging = NULL;
+    }
+
+    int osizes[DALEC_ARRAY_MAX_DIM];
+    osizes[0] = (int)(hi[0]-lo[0]+1);
+    for (int i=1; i<ndim; i++) {
+        osizes[i] = (int)ld[i-1];
+    }
+
+    /* scale into a packed staging buffer, which then stands in for the
+     * user buffer */
+    void * staging = NULL;
+    if (op == DALECI_OP_ACC && !DALECI_Scale_is_one(h->type, alpha)) {
+        size_t nrows = 1;
+        for (int i=0; i<ndim-1; i++) {
+            nrows *= hi[i]-lo[i]+1;
+        }
+        const size_t rowlen = hi[ndim-1]-lo[ndim-1]+1;
+        staging = DALECI_Staging_get(h->staging, nrows * rowlen * type_size);
+        if (staging == NULL) return DALEC_INPUT_ERROR;
+
+        int idx[DALEC_ARRAY_MAX_DIM] = {0};
+        for (size_t r=0; r<nrows; r++) {
+            size_t odisp = 0;
+            for (int i=0; i<ndim; i++) {
+                odisp = odisp * osizes[i] + idx[i];
+            }
+            rc = DALECI_Scale(h->type, rowlen, alpha, (char*)buf + odisp * type_size,
+                              (char*)staging + r * rowlen * type_size);
+            if (rc != DALEC_SUCCESS) return rc;
+
+            for (int i=ndim-2; i>=0; i--) {
+                if (++idx[i] < (int)(hi[i]-lo[i]+1)) break;
+                idx[i] = 0;
+            }
+        }
+
+        buf = staging;
+        for (int i=0; i<ndim; i++) {
+            osizes[i] = (int)(hi[i]-lo[i]+1);
+        }
+        if (req != NULL) {
+            req->staging = staging;
+            staging = NULL;
+        }
+    }
+
+    /* index of the next directly issued operation */
+    int k = 0;
+    do {
+        int target = 0, simple = 1, empty = 0;
+        int subsizes[DALEC_ARRAY_MAX_DIM], ostarts[DALEC_ARRAY_MAX_DIM];
+        int tsizes[DALEC_ARRAY_MAX_DIM], tstarts[DALEC_ARRAY_MAX_DIM];
+        for (int i=0; i<ndim; i++) {
+            /* the owner holds segments c[i], c[i]+p, ... up to last */
+            const size_t p    = h->pedims[i];
+            const size_t last = c[i] + (DALECI_Seg_of(h, i, hi[i]) - c[i]) / p * p;
+            const size_t blo  = DALECI_Seg_lo(h, i, c[i]);
+            const size_t bhi  = DALECI_Seg_lo(h, i, last+1);
+            const size_t plo  = (lo[i] > blo) ? lo[i] : blo;
+            const size_t phi  = (hi[i]+1 < bhi) ? hi[i]+1 : bhi;
+            const int coord   = DALECI_Seg_coord(h, i, c[i]);
+            /* empty blocks of irregular arrays own nothing */
+            if (phi <= plo) {
+                empty = 1;
+                break;
+            }
+            subsizes[i] = (int)(DALECI_Local_index(h, i, phi-1) - DALECI_Local_index(h, i, plo) + 1);
+            ostarts[i]  = (int)(plo-lo[i]);
+            tsizes[i]   = (int)DALECI_Block_padded(h, i, coord);
+            tstarts[i]  = (int)(DALECI_Local_index(h, i, plo) + h->ghosts[i]);
+            target = target * h->pedims[i] + coord;
+            simple &= (last == (size_t)c[i]);
+        }
+        if (empty) continue;
+
+        /* owners on the same node are accessed with load/store */
+        void * base = (op != DALECI_OP_ACC && simple) ? DALECI_Shm_base(h, target) : NULL;
+        if (base != NULL) {
+            if (h->aggregate != NULL) {
+                rc = DALECI_Aggregate_flush_target(h, target);
+                if (rc != DALEC_SUCCESS) return rc;
+            }
+            rc = DALECI_Dirty_order(h, target, op);
+            if (rc != DALEC_SUCCESS) return rc;
+            rc = DALECI_Shm_copy(h, op, base, buf, type_size, osizes, ostarts, tsizes, tstarts, subsizes);
+            if (rc != DALEC_SUCCESS) return rc;
+            continue;
+        }
+
+        /* small updates may be queued, anything else must not overtake them */
+        if (h->aggregate != NULL) {
+            size_t elements = 1;
+            for (int i=0; i<ndim; i++) {
+                elements *= subsizes[i];
+            }
+            if (req == NULL && op != DALECI_OP_GET && simple && DALECI_Aggregate_eligible(h, elements)) {
+                rc = DALECI_Aggregate_enqueue(h, op, target, buf, osizes, ostarts, tsizes, tstarts, subsizes);
+                if (rc != DALEC_SUCCESS) return rc;
+                continue;
+            }
+            rc = DALECI_Aggregate_flush_target(h, target);
+            if (rc != DALEC_SUCCESS) return rc;
+        }
+
+        rc = DALECI_Dirty_order(h, target, op);
+        if (rc != DALEC_SUCCESS) return rc;
+
+        DALECI_Dbg_print(DEBUG_CAT_RMA, "op = %d target = %d\n", op, target);
+
+        MPI_Datatype otype, ttype;
+        if (simple) {
+            rc = MPI_Type_create_subarray(ndim, osizes, subsizes, ostarts, MPI_ORDER_C, h->type, &otype);
+            DALECI_Check_MPI(__func__, "MPI_Type_create_subarray", rc);
+        } else {
+            rc = DALECI_Patch_origin_type(h, lo, hi, c, osizes, &otype);
+            if (rc != DALEC_SUCCESS) return rc;
+        }
+        rc = MPI_Type_commit(&otype);
+        DALECI_Check_MPI(__func__, "MPI_Type_commit", rc);
+        rc = MPI_Type_create_subarray(ndim, tsizes, subsizes, tstarts, MPI_ORDER_C, h->type, &ttype);
+        DALECI_Check_MPI(__func__, "MPI_Type_create_subarray", rc);
+        rc = MPI_Type_commit(&ttype);
+        DALECI_Check_MPI(__func__, "MPI_Type_commit", rc);
+        const MPI_Aint tdisp = DALECI_Target_disp(h, target, 0);
+
+        if (req == NULL) {
+            switch (op) {
+                case DALECI_OP_PUT:
+                    rc = MPI_Put(buf, 1, otype, target, tdisp, 1, ttype, h->win);
+                    DALECI_Check_MPI(__func__, "MPI_Put", rc);
+                    break;
+                case DALECI_OP_GET:
+                    rc = MPI_Get(buf, 1, otype, target, tdisp, 1, ttype, h->win);
+                    DALECI_Check_MPI(__func__, "MPI_Get", rc);
+                    break;
+                case DALECI_OP_ACC:
+                    rc = MPI_Accumulate(buf, 1, otype, target, tdisp, 1, ttype, MPI_SUM, h->win);
+                    DALECI_Check_MPI(__func__, "MPI_Accumulate", rc);
+                    break;
+            }
+        } else {
+            switch (op) {
+                case DALECI_OP_PUT:
+                    rc = MPI_Rput(buf, 1, otype, target, tdisp, 1, ttype, h->win, &(req->reqs[k]));
+                    DALECI_Check_MPI(__func__, "MPI_Rput", rc);
+                    break;
+                case DALECI_OP_GET:
+                    rc = MPI_Rget(buf, 1, otype, target, tdisp, 1, ttype, h->win, &(req->reqs[k]));
+                    DALECI_Check_MPI(__func__, "MPI_Rget", rc);
+                    break;
+                case DALECI_OP_ACC:
+                    rc = MPI_Raccumulate(buf, 1, otype, target, tdisp, 1, ttype, MPI_SUM, h->win, &(req->reqs[k]));
+                    DALECI_Check_MPI(__func__, "MPI_Raccumulate", rc);
+                    break;
+            }
+        }
+        if (req == NULL) {
+            targets[k] = target;
+        }
+        k++;
+        DALECI_Dirty_mark(h, target, op);
+
+        /* pending operations keep their own reference to the datatypes */
+        MPI_Type_free(&otype);
+        MPI_Type_free(&ttype);
+
+    } while (DALECI_Next_coord(ndim, cfirst, clast, c));
+
+    if (req != NULL) {
+        req->count = k;
+    }
+
+    /* the operations to different owners were issued back to back, now
+     * wait until the buffer can be reused; updates are completed at the
+     * owners later, by DALEC_Fence or when they could conflict */
+    if (req == NULL) {
+        for (int j=0; j<k; j++) {
+            rc = MPI_Win_flush_local(targets[j], h->win);
+            DALECI_Check_MPI(__func__, "MPI_Win_flush_local", rc);
+        }
+        free(targets);
+    }
+    DALECI_Staging_put(h->staging, staging);
+
+    return DALEC_SUCCESS;
+}
+
+/* -- begin weak symbols block -- */
+#if defined(HAVE_PRAGMA_WEAK)
+#  pragma weak DALEC_Put = PDALEC_Put
+#elif defined(HAVE_PRAGMA_HP_SEC_DEF)
+#  pragma _HP_SECONDARY_DEF PDALEC_Put DALEC_Put
+#elif defined(HAVE_PRAGMA_CRI_DUP)
+#  pragma _CRI duplicate DALEC_Put as PDALEC_Put
+#elif defined(HAVE_WEAK_ATTRIBUTE)
+int DALEC_Put(const DALEC_Array_handle * h, const size_t lo[], const size_t hi[], const void * buf, const size_t ld[])
+    __attribute__ ((weak, alias("PDALEC_Put")));
+#else
+#define DALEC_Put PDALEC_Put
+#endif
+/* -- end weak symbols block -- */
+
+/** Copy a patch from a local buffer into the array.  Blocking: the buffer
+  * may be reused on return.  The data is visible to other processes after
+  * DALEC_Fence by the caller, or after DALEC_Sync.
+  *
+  * @param[in] h       Array handle
+  * @param[in] lo      Lowest global index of the patch in each dimension
+  * @param[in] hi      Highest global index of the patch in each dimension (inclusive)
+  * @param[in] buf     Source buffer, row-major
+  * @param[in] ld      Extents of dimensions 1..ndim-1 of buf
+  * @return            Zero on success
+  */
+int DALEC_Put(const DALEC_Array_handle * h, const size_t lo[], const size_t hi[], const void * buf, const size_t ld[])
+{
+    int rc = DALECI_Check_patch(h, lo, hi, buf, ld);
+    if (rc != DALEC_SUCCESS) return rc;
+
+    return DALECI_Patch_op(DALECI_OP_PUT, h, lo, hi, (void*)buf, ld, NULL, NULL);
+}
+
+/* -- begin weak symbols block -- */
+#if defined(HAVE_PRAGMA_WEAK)
+#  pragma weak DALEC_Get = PDALEC_Get
+#elif defined(HAVE_PRAGMA_HP_SEC_DEF)
+#  pragma _HP_SECONDARY_DEF PDALEC_Get DALEC_Get
+#elif defined(HAVE_PRAGMA_CRI_DUP)
+#  pragma _CRI duplicate DALEC_Get as PDALEC_Get
+#elif defined(HAVE_WEAK_ATTRIBUTE)
+int DALEC_Get(const DALEC_Array_handle * h, const size_t lo[], const size_t hi[], void * buf, const size_t ld[])
+    __attribute__ ((weak, alias("PDALEC_Get")));
+#else
+#define DALEC_Get PDALEC_Get
+#endif
+/* -- end weak symbols block -- */
+
+/** Copy a patch of the array into a local buffer.  Blocking.
+  *
+  * @param[in]  h      Array handle
+  * @param[in]  lo     Lowest global index of the patch in each dimension
+  * @param[in]  hi     Highest global index of the patch in each dimension (inclusive)
+  * @param[out] buf    Destination buffer, row-major
+  * @param[in]  ld     Extents of dimensions 1..ndim-1 of buf
+  * @return            Zero on success
+  */
+int DALEC_Get(const DALEC_Array_handle * h, const size_t lo[], const size_t hi[], void * buf, const size_t ld[])
+{
+    int rc = DALECI_Check_patch(h, lo, hi, buf, ld);
+    if (rc != DALEC_SUCCESS) return rc;
+
+    return DALECI_Patch_op(DALECI_OP_GET, h, lo, hi, buf, ld, NULL, NULL);
+}
+
+/* -- begin weak symbols block -- */
+#if defined(HAVE_PRAGMA_WEAK)
+#  pragma weak DALEC_Acc = PDALEC_Acc
+#elif defined(HAVE_PRAGMA_HP_SEC_DEF)
+#  pragma _HP_SECONDARY_DEF PDALEC_Acc DALEC_Acc
+#elif defined(HAVE_PRAGMA_CRI_DUP)
+#  pragma _CRI duplicate DALEC_Acc as PDALEC_Acc
+#elif defined(HAVE_WEAK_ATTRIBUTE)
+int DALEC_Acc(const DALEC_Array_handle * h, const size_t lo[], const size_t hi[], const void * buf, const size_t ld[], const void * alpha)
+    __attribute__ ((weak, alias("PDALEC_Acc")));
+#else
+#define DALEC_Acc PDALEC_Acc
+#endif
+/* -- end weak symbols block -- */
+
+/** Add alpha times a local buffer to a patch of the array, element-wise
+  * atomically with respect to other accumulates.  Blocking: the buffer may
+  * be reused on return.  Completion at the owners is as for DALEC_Put.
+  *
+  * @param[in] h       Array handle
+  * @param[in] lo      Lowest global index of the patch in each dimension
+  * @param[in] hi      Highest global index of the patch in each dimension (inclusive)
+  * @param[in] buf     Source buffer, row-major
+  * @param[in] ld      Extents of dimensions 1..ndim-1 of buf
+  * @param[in] alpha   Scale factor of the type of the array, or NULL for one
+  * @return            Zero on success
+  */
+int DALEC_Acc(const DALEC_Array_handle * h, const size_t lo[], const size_t hi[], const void * buf, const size_t ld[], const void * alpha)
+{
+    int rc = DALECI_Check_patch(h, lo, hi, buf, ld);
+    if (rc != DALEC_SUCCESS) return rc;
+
+    return DALECI_Patch_op(DALECI_OP_ACC, h, lo, hi, (void*)buf, ld, alpha, NULL);
+}
+
+/* -- begin weak symbols block -- */
+#if defined(HAVE_PRAGMA_WEAK)
+#  pragma weak DALEC_NbPut = PDALEC_NbPut
+#elif defined(HAVE_PRAGMA_HP_SEC_DEF)
+#  pragma _HP_SECONDARY_DEF PDALEC_NbPut DALEC_NbPut
+#elif defined(HAVE_PRAGMA_CRI_DUP)
+#  pragma _CRI duplicate DALEC_NbPut as PDALEC_NbPut
+#elif defined(HAVE_WEAK_ATTRIBUTE)
+int DALEC_NbPut(const DALEC_Array_handle * h, const size_t lo[], const size_t hi[], const void * buf, const size_t ld[], DALEC_Request * req)
+    __attribute__ ((weak, alias("PDALEC_NbPut")));
+#else
+#define DALEC_NbPut PDALEC_NbPut
+#endif
+/* -- end weak symbols block -- */
+
+/** Start copying a patch from a local buffer into the array.  The buffer
+  * must not be modified until the request is completed.
+  *
+  * @param[in]  h      Array handle
+  * @param[in]  lo     Lowest global index of the patch in each dimension
+  * @param[in]  hi     Highest global index of the patch in each dimension (inclusive)
+  * @param[in]  buf    Source buffer, row-major
+  * @param[in]  ld     Extents of dimensions 1..ndim-1 of buf
+  * @param[out] req    Request to pass to DALEC_Wait, DALEC_Test or DALEC_Waitall
+  * @return            Zero on success
+  */
+int DALEC_NbPut(const DALEC_Array_handle * h, const size_t lo[], const size_t hi[], const void * buf, const size_t ld[], DALEC_Request * req)
+{
+    int rc = DALECI_Check_patch(h, lo, hi, buf, ld);
+    if (rc != DALEC_SUCCESS) return rc;
+
+    return DALECI_Patch_op(DALECI_OP_PUT, h, lo, hi, (void*)buf, ld, NULL, req);
+}
+
+/* -- begin weak symbols block -- */
+#if defined(HAVE_PRAGMA_WEAK)
+#  pragma weak DALEC_NbGet = PDALEC_NbGet
+#elif defined(HAVE_PRAGMA_HP_SEC_DEF)
+#  pragma _HP_SECONDARY_DEF PDALEC_NbGet DALEC_NbGet
+#elif defined(HAVE_PRAGMA_CRI_DUP)
+#  pragma _CRI duplicate DALEC_NbGet as PDALEC_NbGet
+#elif defined(HAVE_WEAK_ATTRIBUTE)
+int DALEC_NbGet(const DALEC_Array_handle * h, const size_t lo[], const size_t hi[], void * buf, const size_t ld[], DALEC_Request * req)
+    __attribute__ ((weak, alias("PDALEC_NbGet")));
+#else
+#define DALEC_NbGet PDALEC_NbGet
+#endif
+/* -- end weak symbols block -- */
+
+/** Start copying a patch of the array into a local buffer.  The buffer
+  * must not be accessed until the request is completed.
+  *
+  * @param[in]  h      Array handle
+  * @param[in]  lo     Lowest global index of the patch in each dimension
+  * @param[in]  hi     Highest global index of the patch in each dimension (inclusive)
+  * @param[out] buf    Destination buffer, row-major
+  * @param[in]  ld     Extents of dimensions 1..ndim-1 of buf
+  * @param[out] req    Request to pass to DALEC_Wait, DALEC_Test or DALEC_Waitall
+  * @return            Zero on success
+  */
+int DALEC_NbGet(const DALEC_Array_handle * h, const size_t lo[], const size_t hi[], void * buf, const size_t ld[], DALEC_Request * req)
+{
+    int rc = DALECI_Check_patch(h, lo, hi, buf, ld);
+    if (rc != DALEC_SUCCESS) return rc;
+
+    return DALECI_Patch_op(DALECI_OP_GET, h, lo, hi, buf, ld, NULL, req);
+}
+
+/* -- begin weak symbols block -- */
+#if defined(HAVE_PRAGMA_WEAK)
+#  pragma weak DALEC_NbAcc = PDALEC_NbAcc
+#elif defined(HAVE_PRAGMA_HP_SEC_DEF)
+#  pragma _HP_SECONDARY_DEF PDALEC_NbAcc DALEC_NbAcc
+#elif defined(HAVE_PRAGMA_CRI_DUP)
+#  pragma _CRI duplicate DALEC_NbAcc as PDALEC_NbAcc
+#elif defined(HAVE_WEAK_ATTRIBUTE)
+int DALEC_NbAcc(const DALEC_Array_handle * h, const size_t lo[], const size_t hi[], const void * buf, const size_t ld[], const void * alpha, DALEC_Request * req)
+    __attribute__ ((weak, alias("PDALEC_NbAcc")));
+#else
+#define DALEC_NbAcc PDALEC_NbAcc
+#endif
+/* -- end weak symbols block -- */
+
+/** Start adding alpha times a local buffer to a patch of the array.  The
+  * buffer must not be modified until the request is completed, unless
+  * alpha is given and not one, in which case it is copied before return.
+  *
+  * @param[in]  h      Array handle
+  * @param[in]  lo     Lowest global index of the patch in each dimension
+  * @param[in]  hi     Highest global index of the patch in each dimension (inclusive)
+  * @param[in]  buf    Source buffer, row-major
+  * @param[in]  ld     Extents of dimensions 1..ndim-1 of buf
+  * @param[in]  alpha  Scale factor of the type of the array, or NULL for one
+  * @param[out] req    Request to pass to DALEC_Wait, DALEC_Test or DALEC_Waitall
+  * @return            Zero on success
+  */
+int DALEC_NbAcc(const DALEC_Array_handle * h, const size_t lo[], const size_t hi[], const void * buf, const size_t ld[], const void * alpha, DALEC_Request * req)
+{
+    int rc = DALECI_Check_patch(h, lo, hi, buf, ld);
+    if (rc != DALEC_SUCCESS) return rc;
+
+    return DALECI_Patch_op(DALECI_OP_ACC, h, lo, hi, (void*)buf, ld, alpha, req);
+}
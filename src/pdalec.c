@@ -27,9 +27,249 @@ int DALEC_Create_array(const DALEC_Array_descriptor * d, DALEC_Array_handle * h)
     return PDALEC_Create_array(d, h);
 }
 
+#pragma weak DALEC_Create_array_irreg
+int DALEC_Create_array_irreg(const DALEC_Array_descriptor * d, const int nblock[], const size_t map[],
+                             DALEC_Array_handle * h) {
+    return PDALEC_Create_array_irreg(d, nblock, map, h);
+}
+
+#pragma weak DALEC_Create_arrays
+int DALEC_Create_arrays(int n, const DALEC_Array_descriptor d[], DALEC_Array_handle h[]) {
+    return PDALEC_Create_arrays(n, d, h);
+}
+
 #pragma weak DALEC_Destroy_array
 int DALEC_Destroy_array(DALEC_Array_handle * h) {
     return PDALEC_Destroy_array(h);
 }
 
+#pragma weak DALEC_Resize_array
+int DALEC_Resize_array(DALEC_Array_handle * h, const size_t dims[]) {
+    return PDALEC_Resize_array(h, dims);
+}
+
+#pragma weak DALEC_Pool_trim
+int DALEC_Pool_trim(MPI_Comm comm) {
+    return PDALEC_Pool_trim(comm);
+}
+
+#pragma weak DALEC_Locate
+int DALEC_Locate(const DALEC_Array_handle * h, const size_t idx[], int * rank, size_t * offset) {
+    return PDALEC_Locate(h, idx, rank, offset);
+}
+
+#pragma weak DALEC_Distribution
+int DALEC_Distribution(const DALEC_Array_handle * h, int rank, size_t lo[], size_t extents[]) {
+    return PDALEC_Distribution(h, rank, lo, extents);
+}
+
+#pragma weak DALEC_Descinit
+int DALEC_Descinit(const DALEC_Array_handle * h, int ictxt, int desc[9]) {
+    return PDALEC_Descinit(h, ictxt, desc);
+}
+
+#pragma weak DALEC_Put
+int DALEC_Put(const DALEC_Array_handle * h, const size_t lo[], const size_t hi[], const void * buf, const size_t ld[]) {
+    return PDALEC_Put(h, lo, hi, buf, ld);
+}
+
+#pragma weak DALEC_Get
+int DALEC_Get(const DALEC_Array_handle * h, const size_t lo[], const size_t hi[], void * buf, const size_t ld[]) {
+    return PDALEC_Get(h, lo, hi, buf, ld);
+}
+
+#pragma weak DALEC_Acc
+int DALEC_Acc(const DALEC_Array_handle * h, const size_t lo[], const size_t hi[], const void * buf, const size_t ld[], const void * alpha) {
+    return PDALEC_Acc(h, lo, hi, buf, ld, alpha);
+}
+
+#pragma weak DALEC_NbPut
+int DALEC_NbPut(const DALEC_Array_handle * h, const size_t lo[], const size_t hi[], const void * buf, const size_t ld[], DALEC_Request * req) {
+    return PDALEC_NbPut(h, lo, hi, buf, ld, req);
+}
+
+#pragma weak DALEC_NbGet
+int DALEC_NbGet(const DALEC_Array_handle * h, const size_t lo[], const size_t hi[], void * buf, const size_t ld[], DALEC_Request * req) {
+    return PDALEC_NbGet(h, lo, hi, buf, ld, req);
+}
+
+#pragma weak DALEC_NbAcc
+int DALEC_NbAcc(const DALEC_Array_handle * h, const size_t lo[], const size_t hi[], const void * buf, const size_t ld[], const void * alpha, DALEC_Request * req) {
+    return PDALEC_NbAcc(h, lo, hi, buf, ld, alpha, req);
+}
+
+#pragma weak DALEC_Scatter
+int DALEC_Scatter(const DALEC_Array_handle * h, size_t n, const size_t subs[], const void * buf) {
+    return PDALEC_Scatter(h, n, subs, buf);
+}
+
+#pragma weak DALEC_Gather
+int DALEC_Gather(const DALEC_Array_handle * h, size_t n, const size_t subs[], void * buf) {
+    return PDALEC_Gather(h, n, subs, buf);
+}
+
+#pragma weak DALEC_Scatter_acc
+int DALEC_Scatter_acc(const DALEC_Array_handle * h, size_t n, const size_t subs[], const void * buf, const void * alpha) {
+    return PDALEC_Scatter_acc(h, n, subs, buf, alpha);
+}
+
+#pragma weak DALEC_Fetch_and_op
+int DALEC_Fetch_and_op(const DALEC_Array_handle * h, const size_t idx[], const void * value, void * result, MPI_Op op) {
+    return PDALEC_Fetch_and_op(h, idx, value, result, op);
+}
+
+#pragma weak DALEC_Compare_and_swap
+int DALEC_Compare_and_swap(const DALEC_Array_handle * h, const size_t idx[], const void * value, const void * compare, void * result) {
+    return PDALEC_Compare_and_swap(h, idx, value, compare, result);
+}
+
+#pragma weak DALEC_Read_inc
+int DALEC_Read_inc(const DALEC_Array_handle * h, const size_t idx[], long inc, long * value) {
+    return PDALEC_Read_inc(h, idx, inc, value);
+}
+
+#pragma weak DALEC_Update_ghosts
+int DALEC_Update_ghosts(const DALEC_Array_handle * h, int corners) {
+    return PDALEC_Update_ghosts(h, corners);
+}
+
+#pragma weak DALEC_Fill
+int DALEC_Fill(const DALEC_Array_handle * h, const void * value) {
+    return PDALEC_Fill(h, value);
+}
+
+#pragma weak DALEC_Scale
+int DALEC_Scale(const DALEC_Array_handle * h, const void * alpha) {
+    return PDALEC_Scale(h, alpha);
+}
+
+#pragma weak DALEC_Copy
+int DALEC_Copy(const DALEC_Array_handle * src, const DALEC_Array_handle * dst) {
+    return PDALEC_Copy(src, dst);
+}
+
+#pragma weak DALEC_Add
+int DALEC_Add(const void * alpha, const DALEC_Array_handle * a, const void * beta, const DALEC_Array_handle * b,
+              const DALEC_Array_handle * c) {
+    return PDALEC_Add(alpha, a, beta, b, c);
+}
+
+#pragma weak DALEC_Dot
+int DALEC_Dot(const DALEC_Array_handle * a, const DALEC_Array_handle * b, void * result) {
+    return PDALEC_Dot(a, b, result);
+}
+
+#pragma weak DALEC_Norm2
+int DALEC_Norm2(const DALEC_Array_handle * h, double * result) {
+    return PDALEC_Norm2(h, result);
+}
+
+#pragma weak DALEC_Redistribute
+int DALEC_Redistribute(const DALEC_Array_handle * src, const DALEC_Array_handle * dst) {
+    return PDALEC_Redistribute(src, dst);
+}
+
+#pragma weak DALEC_Redistribute_plan
+int DALEC_Redistribute_plan(const DALEC_Array_handle * src, const DALEC_Array_handle * dst,
+                            DALEC_Redistribution * r) {
+    return PDALEC_Redistribute_plan(src, dst, r);
+}
+
+#pragma weak DALEC_Redistribute_exec
+int DALEC_Redistribute_exec(const DALEC_Array_handle * src, const DALEC_Array_handle * dst,
+                            const DALEC_Redistribution * r) {
+    return PDALEC_Redistribute_exec(src, dst, r);
+}
+
+#pragma weak DALEC_Redistribute_free
+int DALEC_Redistribute_free(DALEC_Redistribution * r) {
+    return PDALEC_Redistribute_free(r);
+}
+
+#pragma weak DALEC_Gemm
+int DALEC_Gemm(const void * alpha, const DALEC_Array_handle * a, const DALEC_Array_handle * b,
+               const void * beta, const DALEC_Array_handle * c) {
+    return PDALEC_Gemm(alpha, a, b, beta, c);
+}
+
+#pragma weak DALEC_Taskpool_create
+int DALEC_Taskpool_create(MPI_Comm comm, long ntasks, long min_chunk, DALEC_Taskpool * tp) {
+    return PDALEC_Taskpool_create(comm, ntasks, min_chunk, tp);
+}
+
+#pragma weak DALEC_Taskpool_next
+int DALEC_Taskpool_next(DALEC_Taskpool * tp, long * first, long * count) {
+    return PDALEC_Taskpool_next(tp, first, count);
+}
+
+#pragma weak DALEC_Taskpool_reset
+int DALEC_Taskpool_reset(DALEC_Taskpool * tp) {
+    return PDALEC_Taskpool_reset(tp);
+}
+
+#pragma weak DALEC_Taskpool_report
+int DALEC_Taskpool_report(const DALEC_Taskpool * tp, long executed[]) {
+    return PDALEC_Taskpool_report(tp, executed);
+}
+
+#pragma weak DALEC_Taskpool_destroy
+int DALEC_Taskpool_destroy(DALEC_Taskpool * tp) {
+    return PDALEC_Taskpool_destroy(tp);
+}
+
+#pragma weak DALEC_Aggregate_begin
+int DALEC_Aggregate_begin(DALEC_Array_handle * h) {
+    return PDALEC_Aggregate_begin(h);
+}
+
+#pragma weak DALEC_Aggregate_flush
+int DALEC_Aggregate_flush(DALEC_Array_handle * h) {
+    return PDALEC_Aggregate_flush(h);
+}
+
+#pragma weak DALEC_Aggregate_end
+int DALEC_Aggregate_end(DALEC_Array_handle * h) {
+    return PDALEC_Aggregate_end(h);
+}
+
+#pragma weak DALEC_Access
+int DALEC_Access(const DALEC_Array_handle * h, const size_t lo[], const size_t hi[], void ** ptr, size_t ld[]) {
+    return PDALEC_Access(h, lo, hi, ptr, ld);
+}
+
+#pragma weak DALEC_Release
+int DALEC_Release(const DALEC_Array_handle * h, const size_t lo[], const size_t hi[]) {
+    return PDALEC_Release(h, lo, hi);
+}
+
+#pragma weak DALEC_Release_update
+int DALEC_Release_update(const DALEC_Array_handle * h, const size_t lo[], const size_t hi[]) {
+    return PDALEC_Release_update(h, lo, hi);
+}
+
+#pragma weak DALEC_Fence
+int DALEC_Fence(const DALEC_Array_handle * h) {
+    return PDALEC_Fence(h);
+}
+
+#pragma weak DALEC_Sync
+int DALEC_Sync(const DALEC_Array_handle * h) {
+    return PDALEC_Sync(h);
+}
+
+#pragma weak DALEC_Wait
+int DALEC_Wait(DALEC_Request * req) {
+    return PDALEC_Wait(req);
+}
+
+#pragma weak DALEC_Test
+int DALEC_Test(DALEC_Request * req, int * flag) {
+    return PDALEC_Test(req, flag);
+}
+
+#pragma weak DALEC_Waitall
+int DALEC_Waitall(int count, DALEC_Request reqs[]) {
+    return PDALEC_Waitall(count, reqs);
+}
+
 #endif
@@ -0,0 +1,315 @@
+/*
+ * Copyright (C) 2014. See COPYRIGHT in top-level directory.
+ */
+
+#include <dalec.h>
+#include <dalec_guts.h>
+#include <debug.h>
+
+/* The windows of destroyed arrays are kept in a pool, with their memory,
+ * their shared-memory windows and their communicators, and are handed to
+ * later arrays over the same ranks in the same order, so that loops that
+ * create and destroy temporaries do not allocate, register and free a
+ * window every time.  A pooled window serves arrays of the same element
+ * size and shared-memory mode whose local memory is at least half of its
+ * own, on every rank.  The windows that a rank keeps are at most
+ * DALEC_WINDOW_POOL_BYTES (default 64 MiB) in total; zero disables the pool.
+ * DALEC_Pool_trim frees the windows of a communicator.
+ *
+ * Every window in the pool was created and destroyed collectively over
+ * its communicator, so all of its ranks hold the windows of congruent
+ * communicators in the same order.  Choosing a window to reuse, and the
+ * oldest windows to free to make room for another, is then a decision on
+ * positions in that list, which the ranks agree on with one allreduce.
+ * The allreduce also keeps a window from being reused while another rank
+ * still has operations on it in flight.
+ *
+ * The arrays of DALEC_Create_arrays share a window, which goes back to the
+ * pool with the last of them.  A window is in a passive-target epoch from
+ * the time it is handed out until then. */
+
+struct DALECI_Window_s {
+    MPI_Comm                 comm;      /* communicator of the window                   */
+    MPI_Win                  win;
+    void                   * base;      /* local memory                                 */
+    struct DALECI_Shm_s    * shm;       /* shared-memory state, or NULL                 */
+    MPI_Aint                 bytes;     /* size of the local memory                     */
+    int                      type_size; /* displacement unit                            */
+    int                      refs;      /* arrays that use the window                   */
+    struct DALECI_Window_s * next;      /* next window in the pool                      */
+};
+
+static struct DALECI_Window_s * DALECI_Pool      = NULL;   /* oldest first */
+static size_t                   DALECI_Pool_bytes = 0;
+
+static size_t DALECI_Pool_max_bytes(void)
+{
+    const int max = DALECI_Getenv_int("DALEC_WINDOW_POOL_BYTES", 64<<20);
+    return (max > 0) ? (size_t)max : 0;
+}
+
+static int DALECI_Congruent(MPI_Comm a, MPI_Comm b)
+{
+    int result;
+    MPI_Comm_compare(a, b, &result);
+    return (result == MPI_IDENT || result == MPI_CONGRUENT);
+}
+
+/* Free a window with everything that belongs to it.  Collective over its communicator. */
+static int DALECI_Window_destroy(struct DALECI_Window_s * w)
+{
+    int rc; /* MPI return code */
+
+    if (w->shm != NULL) {
+        rc = DALECI_Shm_free(&(w->win), w->shm);
+        if (rc != DALEC_SUCCESS) return rc;
+    } else {
+        rc = MPI_Win_free(&(w->win));
+        DALECI_Check_MPI(__func__, "MPI_Win_free", rc);
+    }
+
+    rc = MPI_Comm_free(&(w->comm));
+    DALECI_Check_MPI(__func__, "MPI_Comm_free", rc);
+
+    free(w);
+    return DALEC_SUCCESS;
+}
+
+/* Take the window at position k among the windows of communicators congruent to comm out of the pool. */
+static struct DALECI_Window_s * DALECI_Pool_remove(MPI_Comm comm, int k)
+{
+    for (struct DALECI_Window_s ** p = &DALECI_Pool; *p != NULL; p = &((*p)->next)) {
+        if (DALECI_Congruent((*p)->comm, comm) && k-- == 0) {
+            struct DALECI_Window_s * w = *p;
+            *p = w->next;
+            w->next = NULL;
+            DALECI_Pool_bytes -= w->bytes;
+            return w;
+        }
+    }
+    return NULL;
+}
+
+/** Give an array a window with bytes of local memory, from the pool if
+  * possible.  h->comm may be replaced by the congruent communicator of a
+  * pooled window.  Collective.
+  *
+  * @param[in,out] h         Array handle, comm is used and may be replaced; win, shm and window are set
+  * @param[in]     bytes     Size of the local memory
+  * @param[in]     type_size Displacement unit
+  * @param[in]     use_shm   Whether ranks on a node share the memory
+  * @param[out]    baseptr   Local memory
+  * @return                  Zero on success
+  */
+int DALECI_Window_get(DALEC_Array_handle * h, MPI_Aint bytes, int type_size, int use_shm, void * baseptr)
+{
+    int rc; /* MPI return code */
+
+    /* the pooled windows that fit on this rank, by position among the windows of the ranks of the array */
+    uint64_t fits = 0;
+    int count = 0;
+    for (struct DALECI_Window_s * w = DALECI_Pool; w != NULL && count < 64; w = w->next) {
+        if (!DALECI_Congruent(w->comm, h->comm)) continue;
+        if (w->type_size == type_size && (w->shm != NULL) == (use_shm != 0) &&
+            w->bytes >= bytes && w->bytes / 2 <= bytes) {
+            fits |= (uint64_t)1 << count;
+        }
+        count++;
+    }
+
+    /* every rank has the same list, so if it is empty nobody needs to ask */
+    if (count > 0) {
+        rc = MPI_Allreduce(MPI_IN_PLACE, &fits, 1, MPI_UINT64_T, MPI_BAND, h->comm);
+        DALECI_Check_MPI(__func__, "MPI_Allreduce", rc);
+    }
+
+    struct DALECI_Window_s * w;
+    if (fits != 0) {
+        int k = 0;
+        while (!(fits & ((uint64_t)1 << k))) k++;
+        w = DALECI_Pool_remove(h->comm, k);
+
+        rc = MPI_Comm_free(&(h->comm));
+        DALECI_Check_MPI(__func__, "MPI_Comm_free", rc);
+        h->comm   = w->comm;
+        h->win    = w->win;
+        h->shm    = w->shm;
+        h->window = w;
+        *(void**)baseptr = w->base;
+
+        DALECI_Dbg_print(DEBUG_CAT_ARRAY_DIST, "reusing a window of %zu bytes for %zu bytes\n",
+                         (size_t)w->bytes, (size_t)bytes);
+    } else {
+        w = calloc(1, sizeof(struct DALECI_Window_s));
+        if (w == NULL) {
+            DALECI_Error("calloc of window state failed");
+            return DALEC_INPUT_ERROR;
+        }
+        w->bytes     = bytes;
+        w->type_size = type_size;
+
+        if (use_shm) {
+            rc = DALECI_Shm_allocate(h, bytes, type_size, baseptr);
+            if (rc != DALEC_SUCCESS) return rc;
+        } else {
+            rc = MPI_Win_allocate(bytes, type_size, MPI_INFO_NULL, h->comm, baseptr, &(h->win));
+            DALECI_Check_MPI(__func__, "MPI_Win_allocate", rc);
+        }
+        w->base   = *(void**)baseptr;
+        h->window = w;
+    }
+    w->refs = 1;
+
+    /* a passive-target epoch spans the lifetime of the array so that
+     * operations only need to be flushed, never locked */
+    rc = MPI_Win_lock_all(MPI_MODE_NOCHECK, h->win);
+    DALECI_Check_MPI(__func__, "MPI_Win_lock_all", rc);
+
+    return DALEC_SUCCESS;
+}
+
+/** Let an array use the window of another array of the same batch.  Local.
+  *
+  * @param[in,out] h      Array handle, whose comm, win, shm and window are set
+  * @param[in]     first  Array handle that holds the window
+  */
+void DALECI_Window_share(DALEC_Array_handle * h, const DALEC_Array_handle * first)
+{
+    h->comm   = first->comm;
+    h->win    = first->win;
+    h->shm    = first->shm;
+    h->window = first->window;
+    h->window->refs++;
+}
+
+/** Complete the operations of this rank on the window of an array and
+  * return the window to the pool once no array uses it, freeing the oldest
+  * windows of the same ranks to make room, or free it if it does not fit.
+  * Collective.
+  *
+  * @param[in,out] h      Array handle, whose win, comm, shm and window are released
+  * @return               Zero on success
+  */
+int DALECI_Window_release(DALEC_Array_handle * h)
+{
+    int rc; /* MPI return code */
+
+    struct DALECI_Window_s * w = h->window;
+    w->comm = h->comm;
+    w->win  = h->win;
+    w->shm  = h->shm;
+
+    /* other arrays of the batch keep the epoch open */
+    if (--(w->refs) > 0) {
+        rc = MPI_Win_flush_all(h->win);
+        DALECI_Check_MPI(__func__, "MPI_Win_flush_all", rc);
+    } else {
+        rc = MPI_Win_unlock_all(h->win);
+        DALECI_Check_MPI(__func__, "MPI_Win_unlock_all", rc);
+    }
+
+    h->window = NULL;
+    h->shm    = NULL;
+    h->win    = MPI_WIN_NULL;
+    h->comm   = MPI_COMM_NULL;
+
+    if (w->refs > 0) {
+        return DALEC_SUCCESS;
+    }
+
+    const size_t max_bytes = DALECI_Pool_max_bytes();
+    if (max_bytes == 0) {
+        return DALECI_Window_destroy(w);
+    }
+
+    /* how many of the oldest windows of the same ranks must go to make room
+     * here, which is one more than there are if that is not enough */
+    int evict = 0, count = 0;
+    size_t bytes = DALECI_Pool_bytes + w->bytes;
+    for (struct DALECI_Window_s * p = DALECI_Pool; p != NULL; p = p->next) {
+        if (!DALECI_Congruent(p->comm, w->comm)) continue;
+        if (bytes > max_bytes) {
+            bytes -= p->bytes;
+            evict++;
+        }
+        count++;
+    }
+    if (bytes > max_bytes) evict = count + 1;
+
+    rc = MPI_Allreduce(MPI_IN_PLACE, &evict, 1, MPI_INT, MPI_MAX, w->comm);
+    DALECI_Check_MPI(__func__, "MPI_Allreduce", rc);
+
+    if (evict > count) {
+        return DALECI_Window_destroy(w);
+    }
+
+    for (int k=0; k<evict; k++) {
+        rc = DALECI_Window_destroy(DALECI_Pool_remove(w->comm, 0));
+        if (rc != DALEC_SUCCESS) return rc;
+    }
+
+    struct DALECI_Window_s ** p = &DALECI_Pool;
+    while (*p != NULL) p = &((*p)->next);
+    *p = w;
+    DALECI_Pool_bytes += w->bytes;
+
+    DALECI_Dbg_print(DEBUG_CAT_ARRAY_DIST, "pooled a window of %zu bytes, %zu bytes in the pool\n",
+                     (size_t)w->bytes, DALECI_Pool_bytes);
+    return DALEC_SUCCESS;
+}
+
+/** Free every window in the pool, oldest first.  Collective over every
+  * communicator of a pooled window, e.g. at DALEC_Finalize.
+  *
+  * @return            Zero on success
+  */
+int DALECI_Pool_free_all(void)
+{
+    while (DALECI_Pool != NULL) {
+        struct DALECI_Window_s * w = DALECI_Pool;
+        DALECI_Pool = w->next;
+        DALECI_Pool_bytes -= w->bytes;
+        int rc = DALECI_Window_destroy(w);
+        if (rc != DALEC_SUCCESS) return rc;
+    }
+    return DALEC_SUCCESS;
+}
+
+/* -- begin weak symbols block -- */
+#if defined(HAVE_PRAGMA_WEAK)
+#  pragma weak DALEC_Pool_trim = PDALEC_Pool_trim
+#elif defined(HAVE_PRAGMA_HP_SEC_DEF)
+#  pragma _HP_SECONDARY_DEF PDALEC_Pool_trim DALEC_Pool_trim
+#elif defined(HAVE_PRAGMA_CRI_DUP)
+#  pragma _CRI duplicate DALEC_Pool_trim as PDALEC_Pool_trim
+#elif defined(HAVE_WEAK_ATTRIBUTE)
+int DALEC_Pool_trim(MPI_Comm comm) __attribute__ ((weak, alias("PDALEC_Pool_trim")));
+#else
+#define DALEC_Pool_trim PDALEC_Pool_trim
+#endif
+/* -- end weak symbols block -- */
+
+/** Free the windows that destroyed arrays over the ranks of comm left in
+  * the pool, in any order of the ranks.  Collective.
+  *
+  * @param[in]  comm   Communicator
+  * @return            Zero on success
+  */
+int DALEC_Pool_trim(MPI_Comm comm)
+{
+    struct DALECI_Window_s ** p = &DALECI_Pool;
+    while (*p != NULL) {
+        int result;
+        MPI_Comm_compare((*p)->comm, comm, &result);
+        if (result == MPI_UNEQUAL) {
+            p = &((*p)->next);
+            continue;
+        }
+        struct DALECI_Window_s * w = *p;
+        *p = w->next;
+        DALECI_Pool_bytes -= w->bytes;
+        int rc = DALECI_Window_destroy(w);
+        if (rc != DALEC_SUCCESS) return rc;
+    }
+    return DALEC_SUCCESS;
+}
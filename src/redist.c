@@ -0,0 +1,511 @@
+/*
+ * Copyright (C) 2014. See COPYRIGHT in top-level directory.
+ */
+
+#include <dalec.h>
+#include <dalec_guts.h>
+#include <debug.h>
+
+/* Redistribution copies an array into another of the same shape and type
+ * but with another grid, block size or communicator.  The communicators
+ * must be nested: the smaller one holds a subset of the ranks of the
+ * larger one, and ranks of the larger one that are not in the smaller one
+ * pass NULL for the array that lives there.  Every rank intersects its own
+ * blocks with the blocks of the other array that they overlap, which the
+ * closed-form distribution gives directly.  This is done one dimension at
+ * a time, in one sweep over the blocks of both arrays along it (there is
+ * one per grid coordinate unless an array is block-cyclic), so planning
+ * costs O(ndim) per peer that data is exchanged with, plus those sweeps,
+ * one MPI_Allgather and one MPI_Bcast to learn the layout of the smaller
+ * communicator. */
+
+/* what ranks outside the smaller communicator need to know about its array */
+typedef struct {
+    int    ndim;
+    int    pedims[DALEC_ARRAY_MAX_DIM];
+    size_t dims[DALEC_ARRAY_MAX_DIM];
+    size_t blocksizes[DALEC_ARRAY_MAX_DIM];
+    size_t remainders[DALEC_ARRAY_MAX_DIM];
+    int    irregular[DALEC_ARRAY_MAX_DIM];
+    int    cyclic;
+    int    nbounds; /* boundaries of the irregular dimensions, sent after */
+} DALECI_Layout;
+
+/* The elements that mine and a grid coordinate of other share along one
+ * dimension, as runs of consecutive positions in the local block of mine.
+ * Coordinate k has nruns[k] runs, from index first[k] of starts and lens. */
+typedef struct {
+    int * first;
+    int * nruns;
+    int * starts;
+    int * lens;
+} DALECI_Overlap;
+
+/** Intersect, along dimension i, the segments of the local block of mine
+  * with those of every grid coordinate of other, in one sweep over both.
+  *
+  * @return            Zero on success
+  */
+static int DALECI_Redist_overlap(const DALEC_Array_handle * mine, const DALEC_Array_handle * other,
+                                 int i, DALECI_Overlap * o)
+{
+    const int mc = mine->coords[i], p = other->pedims[i];
+    const size_t nmine = DALECI_Seg_count(mine, i, mc);
+
+    o->first = calloc(2*p + 1, sizeof(int));
+    if (o->first == NULL) {
+        DALECI_Error("calloc of %d run offsets failed", 2*p + 1);
+        return DALEC_INPUT_ERROR;
+    }
+    o->nruns = o->first + p + 1;
+
+    /* the first pass counts the runs into first[k+1], the second fills
+     * them in and merges the ones that touch */
+    for (int pass=0; pass<2; pass++) {
+        for (size_t j=0; j<nmine; j++) {
+            const size_t s = mc + j * mine->pedims[i];
+            const size_t a = DALECI_Seg_lo(mine, i, s), b = DALECI_Seg_lo(mine, i, s+1);
+            for (size_t t=DALECI_Seg_of(other, i, a); DALECI_Seg_lo(other, i, t) < b; t++) {
+                const size_t olo = DALECI_Seg_lo(other, i, t), ohi = DALECI_Seg_lo(other, i, t+1);
+                const size_t rlo = (a > olo) ? a : olo, rhi = (b < ohi) ? b : ohi;
+                if (rhi <= rlo) continue;
+                const int k = DALECI_Seg_coord(other, i, t);
+                if (pass == 0) {
+                    o->first[k+1]++;
+                    continue;
+                }
+                const int start = (int)(DALECI_Local_index(mine, i, rlo) + mine->ghosts[i]);
+                const int n = o->first[k] + o->nruns[k];
+                if (o->nruns[k] > 0 && o->starts[n-1] + o->lens[n-1] == start) {
+                    o->lens[n-1] += (int)(rhi - rlo);
+                } else {
+                    o->starts[n] = start;
+                    o->lens[n]   = (int)(rhi - rlo);
+                    o->nruns[k]++;
+                }
+            }
+        }
+        if (pass == 0) {
+            for (int k=0; k<p; k++) {
+                o->first[k+1] += o->first[k];
+            }
+            o->starts = malloc(2 * (o->first[p] + 1) * sizeof(int));
+            if (o->starts == NULL) {
+                DALECI_Error("malloc of %d runs failed", o->first[p]);
+                return DALEC_INPUT_ERROR;
+            }
+            o->lens = o->starts + o->first[p] + 1;
+        }
+    }
+
+    return DALEC_SUCCESS;
+}
+
+/** Build the datatypes that move the local block of mine to, or from, the
+  * blocks of other that overlap it.
+  *
+  * @param[in]  map    Rank in comm of each rank of the grid of other
+  * @param[out] counts One for each rank of comm that is exchanged with
+  * @param[out] types  Datatype on the local block of mine for each of them
+  * @return            Zero on success
+  */
+static int DALECI_Redist_types(const DALEC_Array_handle * mine, const DALEC_Array_handle * other,
+                               const int map[], MPI_Datatype type, int counts[], MPI_Datatype types[])
+{
+    int rc;
+
+    const int ndim = mine->ndim;
+    if (mine->coords[0] < 0) return DALEC_SUCCESS;
+    for (int i=0; i<ndim; i++) {
+        if (mine->local_dims[i] == 0) return DALEC_SUCCESS;
+    }
+
+    /* the grid coordinates of other that overlap along every dimension span
+     * the box [cfirst,clast] */
+    DALECI_Overlap o[DALEC_ARRAY_MAX_DIM];
+    int sizes[DALEC_ARRAY_MAX_DIM], cfirst[DALEC_ARRAY_MAX_DIM], clast[DALEC_ARRAY_MAX_DIM], c[DALEC_ARRAY_MAX_DIM];
+    for (int i=0; i<ndim; i++) {
+        rc = DALECI_Redist_overlap(mine, other, i, &o[i]);
+        if (rc != DALEC_SUCCESS) return rc;
+        sizes[i]  = (int)(mine->local_dims[i] + 2*mine->ghosts[i]);
+        cfirst[i] = other->pedims[i];
+        clast[i]  = -1;
+        for (int k=0; k<other->pedims[i]; k++) {
+            if (o[i].nruns[k] == 0) continue;
+            if (k < cfirst[i]) cfirst[i] = k;
+            clast[i] = k;
+        }
+        c[i] = cfirst[i];
+    }
+
+    int overlap = 1;
+    for (int i=0; i<ndim; i++) {
+        overlap &= (clast[i] >= 0);
+    }
+
+    if (overlap) do {
+        int g = 0, empty = 0;
+        int nruns[DALEC_ARRAY_MAX_DIM], * starts[DALEC_ARRAY_MAX_DIM], * lens[DALEC_ARRAY_MAX_DIM];
+        for (int i=0; i<ndim; i++) {
+            if (o[i].nruns[c[i]] == 0) {
+                empty = 1;
+                break;
+            }
+            nruns[i]  = o[i].nruns[c[i]];
+            starts[i] = o[i].starts + o[i].first[c[i]];
+            lens[i]   = o[i].lens + o[i].first[c[i]];
+            g = g * other->pedims[i] + c[i];
+        }
+        if (empty) continue;
+
+        const int peer = map[g];
+        rc = DALECI_Runs_type(ndim, sizes, nruns, starts, lens, type, &types[peer]);
+        if (rc != DALEC_SUCCESS) return rc;
+        rc = MPI_Type_commit(&types[peer]);
+        DALECI_Check_MPI(__func__, "MPI_Type_commit", rc);
+        counts[peer] = 1;
+    } while (DALECI_Next_coord(ndim, cfirst, clast, c));
+
+    for (int i=0; i<ndim; i++) {
+        free(o[i].first);
+        free(o[i].starts);
+    }
+
+    return DALEC_SUCCESS;
+}
+
+/* -- begin weak symbols block -- */
+#if defined(HAVE_PRAGMA_WEAK)
+#  pragma weak DALEC_Redistribute_plan = PDALEC_Redistribute_plan
+#elif defined(HAVE_PRAGMA_HP_SEC_DEF)
+#  pragma _HP_SECONDARY_DEF PDALEC_Redistribute_plan DALEC_Redistribute_plan
+#elif defined(HAVE_PRAGMA_CRI_DUP)
+#  pragma _CRI duplicate DALEC_Redistribute_plan as PDALEC_Redistribute_plan
+#elif defined(HAVE_WEAK_ATTRIBUTE)
+int DALEC_Redistribute_plan(const DALEC_Array_handle * src, const DALEC_Array_handle * dst, DALEC_Redistribution * r)
+    __attribute__ ((weak, alias("PDALEC_Redistribute_plan")));
+#else
+#define DALEC_Redistribute_plan PDALEC_Redistribute_plan
+#endif
+/* -- end weak symbols block -- */
+
+/** Compute the schedule that copies src into dst.  Collective over the
+  * larger of the two communicators.  Ranks outside the smaller one pass
+  * NULL for the array that lives on it.
+  *
+  * @param[in]  src    Source array handle, or NULL
+  * @param[in]  dst    Destination array handle, or NULL
+  * @param[out] r      Schedule, to be freed with DALEC_Redistribute_free
+  * @return            Zero on success
+  */
+int DALEC_Redistribute_plan(const DALEC_Array_handle * src, const DALEC_Array_handle * dst, DALEC_Redistribution * r)
+{
+    int rc;
+
+    if ((src == NULL && dst == NULL) || r == NULL) {
+        DALECI_Error("src (%p) and dst (%p) are null pointers, or r (%p) is", src, dst, r);
+        return DALEC_INPUT_ERROR;
+    }
+    if (src == dst) {
+        DALECI_Error("src and dst are the same array");
+        return DALEC_INPUT_ERROR;
+    }
+
+    /* which array lives on the larger communicator; src on a tie */
+    int src_is_big = (dst == NULL);
+    if (src != NULL && dst != NULL) {
+        if (src->type != dst->type || src->ndim != dst->ndim) {
+            DALECI_Error("arrays have different types or numbers of dimensions");
+            return DALEC_INPUT_ERROR;
+        }
+        for (int i=0; i<src->ndim; i++) {
+            if (src->dims[i] != dst->dims[i]) {
+                DALECI_Error("arrays differ in dimension %d (%zu vs %zu)", i, src->dims[i], dst->dims[i]);
+                return DALEC_INPUT_ERROR;
+            }
+        }
+        int ssize, dsize;
+        MPI_Comm_size(src->comm, &ssize);
+        MPI_Comm_size(dst->comm, &dsize);
+        src_is_big = (ssize >= dsize);
+    }
+    const DALEC_Array_handle * big   = src_is_big ? src : dst;
+    const DALEC_Array_handle * other = src_is_big ? dst : src;
+
+    MPI_Comm comm = big->comm;
+    int np;
+    MPI_Comm_size(comm, &np);
+
+    /* where the ranks of the other array are in comm */
+    int me_other = -1;
+    if (other != NULL) {
+        MPI_Comm_rank(other->comm, &me_other);
+    }
+    int * where = malloc(2 * np * sizeof(int));
+    if (where == NULL) {
+        DALECI_Error("malloc of %d ranks failed", 2*np);
+        return DALEC_INPUT_ERROR;
+    }
+    int * map_other = where + np;
+    rc = MPI_Allgather(&me_other, 1, MPI_INT, where, 1, MPI_INT, comm);
+    DALECI_Check_MPI(__func__, "MPI_Allgather", rc);
+
+    int osize = 0, root = -1;
+    for (int p=0; p<np; p++) {
+        if (where[p] < 0) continue;
+        if (where[p] >= np) {
+            DALECI_Error("the communicator of the smaller array is not nested in the larger one");
+            return DALEC_INPUT_ERROR;
+        }
+        map_other[where[p]] = p;
+        if (where[p] == 0) root = p;
+        osize++;
+    }
+    if (root < 0) {
+        DALECI_Error("the communicator of the smaller array is not nested in the larger one");
+        return DALEC_INPUT_ERROR;
+    }
+
+    /* ranks outside the other communicator stand in a copy of its layout */
+    DALECI_Layout layout;
+    if (other != NULL) {
+        layout.ndim    = other->ndim;
+        layout.cyclic  = other->cyclic;
+        layout.nbounds = 0;
+        for (int i=0; i<DALEC_ARRAY_MAX_DIM; i++) {
+            layout.pedims[i]     = other->pedims[i];
+            layout.dims[i]       = other->dims[i];
+            layout.blocksizes[i] = other->blocksizes[i];
+            layout.remainders[i] = other->remainders[i];
+            layout.irregular[i]  = (other->irreg[i] != NULL);
+            if (layout.irregular[i]) layout.nbounds += other->pedims[i] + 1;
+        }
+    }
+    rc = MPI_Bcast(&layout, sizeof(DALECI_Layout), MPI_BYTE, root, comm);
+    DALECI_Check_MPI(__func__, "MPI_Bcast", rc);
+
+    size_t * bounds = NULL;
+    if (layout.nbounds > 0) {
+        bounds = malloc(layout.nbounds * sizeof(size_t));
+        if (bounds == NULL) {
+            DALECI_Error("malloc of %d block boundaries failed", layout.nbounds);
+            return DALEC_INPUT_ERROR;
+        }
+        if (other != NULL) {
+            size_t * b = bounds;
+            for (int i=0; i<layout.ndim; i++) {
+                if (!layout.irregular[i]) continue;
+                memcpy(b, other->irreg[i], (layout.pedims[i]+1) * sizeof(size_t));
+                b += layout.pedims[i]+1;
+            }
+        }
+        rc = MPI_Bcast(bounds, layout.nbounds * sizeof(size_t), MPI_BYTE, root, comm);
+        DALECI_Check_MPI(__func__, "MPI_Bcast", rc);
+    }
+
+    DALEC_Array_handle shadow;
+    if (other == NULL) {
+        memset(&shadow, 0, sizeof(DALEC_Array_handle));
+        shadow.type = big->type;
+        shadow.ndim = layout.ndim;
+        shadow.cyclic = layout.cyclic;
+        for (int i=0; i<DALEC_ARRAY_MAX_DIM; i++) {
+            shadow.pedims[i]     = layout.pedims[i];
+            shadow.dims[i]       = layout.dims[i];
+            shadow.blocksizes[i] = layout.blocksizes[i];
+            shadow.remainders[i] = layout.remainders[i];
+            shadow.coords[i]     = -1;
+        }
+        size_t * b = bounds;
+        for (int i=0; i<layout.ndim; i++) {
+            if (!layout.irregular[i]) continue;
+            shadow.irreg[i] = b;
+            b += layout.pedims[i]+1;
+        }
+        other = &shadow;
+    }
+
+    /* the grid of the array on comm is laid out over comm itself */
+    for (int p=0; p<np; p++) {
+        where[p] = p;
+    }
+    const DALEC_Array_handle * s = src_is_big ? big : other;
+    const DALEC_Array_handle * d = src_is_big ? other : big;
+    const int * smap = src_is_big ? where : map_other;
+    const int * dmap = src_is_big ? map_other : where;
+
+    r->comm       = comm;
+    r->sendcounts = calloc(3 * np, sizeof(int));
+    r->sendtypes  = malloc(2 * np * sizeof(MPI_Datatype));
+    if (r->sendcounts == NULL || r->sendtypes == NULL) {
+        DALECI_Error("calloc of a schedule for %d ranks failed", np);
+        return DALEC_INPUT_ERROR;
+    }
+    r->recvcounts = r->sendcounts + np;
+    r->displs     = r->sendcounts + 2*np;
+    r->recvtypes  = r->sendtypes + np;
+    for (int p=0; p<2*np; p++) {
+        r->sendtypes[p] = MPI_BYTE;
+    }
+
+    if (src != NULL) {
+        rc = DALECI_Redist_types(s, d, dmap, big->type, r->sendcounts, r->sendtypes);
+        if (rc != DALEC_SUCCESS) return rc;
+    }
+    if (dst != NULL) {
+        rc = DALECI_Redist_types(d, s, smap, big->type, r->recvcounts, r->recvtypes);
+        if (rc != DALEC_SUCCESS) return rc;
+    }
+
+    free(where);
+    free(bounds);
+
+    return DALEC_SUCCESS;
+}
+
+/* -- begin weak symbols block -- */
+#if defined(HAVE_PRAGMA_WEAK)
+#  pragma weak DALEC_Redistribute_exec = PDALEC_Redistribute_exec
+#elif defined(HAVE_PRAGMA_HP_SEC_DEF)
+#  pragma _HP_SECONDARY_DEF PDALEC_Redistribute_exec DALEC_Redistribute_exec
+#elif defined(HAVE_PRAGMA_CRI_DUP)
+#  pragma _CRI duplicate DALEC_Redistribute_exec as PDALEC_Redistribute_exec
+#elif defined(HAVE_WEAK_ATTRIBUTE)
+int DALEC_Redistribute_exec(const DALEC_Array_handle * src, const DALEC_Array_handle * dst, const DALEC_Redistribution * r)
+    __attribute__ ((weak, alias("PDALEC_Redistribute_exec")));
+#else
+#define DALEC_Redistribute_exec PDALEC_Redistribute_exec
+#endif
+/* -- end weak symbols block -- */
+
+/** Copy src into dst with a schedule from DALEC_Redistribute_plan on the
+  * same arrays.  Collective like the plan.
+  *
+  * @param[in] src     Source array handle, or NULL
+  * @param[in] dst     Destination array handle, or NULL
+  * @param[in] r       Schedule
+  * @return            Zero on success
+  */
+int DALEC_Redistribute_exec(const DALEC_Array_handle * src, const DALEC_Array_handle * dst, const DALEC_Redistribution * r)
+{
+    int rc;
+
+    if (r == NULL) {
+        DALECI_Error("r is a null pointer");
+        return DALEC_INPUT_ERROR;
+    }
+
+    if (src != NULL) {
+        rc = DALEC_Sync(src);
+        if (rc != DALEC_SUCCESS) return rc;
+    }
+    if (dst != NULL) {
+        rc = DALEC_Sync(dst);
+        if (rc != DALEC_SUCCESS) return rc;
+    }
+
+    const int has_src = (src != NULL) && src->coords[0] >= 0;
+    const int has_dst = (dst != NULL) && dst->coords[0] >= 0;
+    void * sbuf = NULL, * rbuf = NULL, * ptr;
+    size_t ld[DALEC_ARRAY_MAX_DIM];
+
+    /* the datatypes are relative to the padded local blocks */
+    if (has_src) {
+        rc = DALECI_Access_block(src, &ptr, ld);
+        if (rc != DALEC_SUCCESS) return rc;
+        sbuf = src->base;
+    }
+    if (has_dst) {
+        rc = DALECI_Access_block(dst, &ptr, ld);
+        if (rc != DALEC_SUCCESS) return rc;
+        rbuf = dst->base;
+    }
+
+    rc = MPI_Alltoallw(sbuf, r->sendcounts, r->displs, r->sendtypes,
+                       rbuf, r->recvcounts, r->displs, r->recvtypes, r->comm);
+    DALECI_Check_MPI(__func__, "MPI_Alltoallw", rc);
+
+    if (has_dst) {
+        rc = DALECI_Release_block(dst, 1);
+        if (rc != DALEC_SUCCESS) return rc;
+    }
+
+    if (dst != NULL) {
+        return DALEC_Sync(dst);
+    }
+    return DALEC_SUCCESS;
+}
+
+/* -- begin weak symbols block -- */
+#if defined(HAVE_PRAGMA_WEAK)
+#  pragma weak DALEC_Redistribute_free = PDALEC_Redistribute_free
+#elif defined(HAVE_PRAGMA_HP_SEC_DEF)
+#  pragma _HP_SECONDARY_DEF PDALEC_Redistribute_free DALEC_Redistribute_free
+#elif defined(HAVE_PRAGMA_CRI_DUP)
+#  pragma _CRI duplicate DALEC_Redistribute_free as PDALEC_Redistribute_free
+#elif defined(HAVE_WEAK_ATTRIBUTE)
+int DALEC_Redistribute_free(DALEC_Redistribution * r) __attribute__ ((weak, alias("PDALEC_Redistribute_free")));
+#else
+#define DALEC_Redistribute_free PDALEC_Redistribute_free
+#endif
+/* -- end weak symbols block -- */
+
+/** Free a schedule.  Local.
+  *
+  * @param[in] r       Schedule
+  * @return            Zero on success
+  */
+int DALEC_Redistribute_free(DALEC_Redistribution * r)
+{
+    if (r == NULL || r->sendcounts == NULL) {
+        DALECI_Error("r (%p) is a null pointer or was freed", r);
+        return DALEC_INPUT_ERROR;
+    }
+
+    int np;
+    MPI_Comm_size(r->comm, &np);
+    for (int p=0; p<np; p++) {
+        if (r->sendcounts[p] > 0) MPI_Type_free(&r->sendtypes[p]);
+        if (r->recvcounts[p] > 0) MPI_Type_free(&r->recvtypes[p]);
+    }
+    free(r->sendcounts);
+    free(r->sendtypes);
+    r->sendcounts = r->recvcounts = r->displs = NULL;
+    r->sendtypes  = r->recvtypes  = NULL;
+
+    return DALEC_SUCCESS;
+}
+
+/* -- begin weak symbols block -- */
+#if defined(HAVE_PRAGMA_WEAK)
+#  pragma weak DALEC_Redistribute = PDALEC_Redistribute
+#elif defined(HAVE_PRAGMA_HP_SEC_DEF)
+#  pragma _HP_SECONDARY_DEF PDALEC_Redistribute DALEC_Redistribute
+#elif defined(HAVE_PRAGMA_CRI_DUP)
+#  pragma _CRI duplicate DALEC_Redistribute as PDALEC_Redistribute
+#elif defined(HAVE_WEAK_ATTRIBUTE)
+int DALEC_Redistribute(const DALEC_Array_handle * src, const DALEC_Array_handle * dst)
+    __attribute__ ((weak, alias("PDALEC_Redistribute")));
+#else
+#define DALEC_Redistribute PDALEC_Redistribute
+#endif
+/* -- end weak symbols block -- */
+
+/** Copy src into dst once, without keeping the schedule.  Collective like
+  * DALEC_Redistribute_plan.
+  *
+  * @param[in] src     Source array handle, or NULL
+  * @param[in] dst     Destination array handle, or NULL
+  * @return            Zero on success
+  */
+int DALEC_Redistribute(const DALEC_Array_handle * src, const DALEC_Array_handle * dst)
+{
+    int rc;
+    DALEC_Redistribution r;
+
+    rc = DALEC_Redistribute_plan(src, dst, &r);
+    if (rc != DALEC_SUCCESS) return rc;
+    rc = DALEC_Redistribute_exec(src, dst, &r);
+    if (rc != DALEC_SUCCESS) return rc;
+    return DALEC_Redistribute_free(&r);
+}
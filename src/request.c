@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2014. See COPYRIGHT in top-level directory.
+ */
+
+#include <dalec.h>
+#include <dalec_guts.h>
+#include <debug.h>
+
+/** Finish a request whose MPI requests have completed.  Request-based RMA
+  * only guarantees local completion, which is the same guarantee as the
+  * blocking calls give; the targets were recorded as in flight when the
+  * operations were issued.
+  *
+  * @return            Zero on success
+  */
+static int DALECI_Request_complete(DALEC_Request * req)
+{
+    free(req->reqs);
+    req->reqs  = NULL;
+    req->count = 0;
+
+    if (req->staging != NULL) {
+        DALECI_Staging_put(req->pool, req->staging);
+        req->staging = NULL;
+    }
+
+    return DALEC_SUCCESS;
+}
+
+/* -- begin weak symbols block -- */
+#if defined(HAVE_PRAGMA_WEAK)
+#  pragma weak DALEC_Wait = PDALEC_Wait
+#elif defined(HAVE_PRAGMA_HP_SEC_DEF)
+#  pragma _HP_SECONDARY_DEF PDALEC_Wait DALEC_Wait
+#elif defined(HAVE_PRAGMA_CRI_DUP)
+#  pragma _CRI duplicate DALEC_Wait as PDALEC_Wait
+#elif defined(HAVE_WEAK_ATTRIBUTE)
+int DALEC_Wait(DALEC_Request * req) __attribute__ ((weak, alias("PDALEC_Wait")));
+#else
+#define DALEC_Wait PDALEC_Wait
+#endif
+/* -- end weak symbols block -- */
+
+#undef FUNCNAME
+#define FUNCNAME DALEC_Wait
+#undef FNAME
+#define FCNAME DALECI_QUOTE_STRING(FUNCNAME)
+
+/** Block until a nonblocking operation is complete.  Waiting on a request
+  * that has already completed returns immediately.
+  *
+  * @param[in,out] req Request from DALEC_NbPut, DALEC_NbGet or DALEC_NbAcc
+  * @return            Zero on success
+  */
+int DALEC_Wait(DALEC_Request * req)
+{
+    int rc; /* MPI return code */
+
+    if (req == NULL) {
+        DALECI_Error("req is a null pointer");
+        return DALEC_INPUT_ERROR;
+    }
+    if (req->count == 0) {
+        return DALEC_SUCCESS;
+    }
+
+    rc = MPI_Waitall(req->count, req->reqs, MPI_STATUSES_IGNORE);
+    DALECI_Check_MPI(FCNAME, "MPI_Waitall", rc);
+
+    return DALECI_Request_complete(req);
+}
+
+/* -- begin weak symbols block -- */
+#if defined(HAVE_PRAGMA_WEAK)
+#  pragma weak DALEC_Test = PDALEC_Test
+#elif defined(HAVE_PRAGMA_HP_SEC_DEF)
+#  pragma _HP_SECONDARY_DEF PDALEC_Test DALEC_Test
+#elif defined(HAVE_PRAGMA_CRI_DUP)
+#  pragma _CRI duplicate DALEC_Test as PDALEC_Test
+#elif defined(HAVE_WEAK_ATTRIBUTE)
+int DALEC_Test(DALEC_Request * req, int * flag) __attribute__ ((weak, alias("PDALEC_Test")));
+#else
+#define DALEC_Test PDALEC_Test
+#endif
+/* -- end weak symbols block -- */
+
+#undef FUNCNAME
+#define FUNCNAME DALEC_Test
+#undef FNAME
+#define FCNAME DALECI_QUOTE_STRING(FUNCNAME)
+
+/** Check whether a nonblocking operation is complete, and complete it if so.
+  *
+  * @param[in,out] req  Request from DALEC_NbPut, DALEC_NbGet or DALEC_NbAcc
+  * @param[out]    flag Nonzero if the operation is complete
+  * @return             Zero on success
+  */
+int DALEC_Test(DALEC_Request * req, int * flag)
+{
+    int rc; /* MPI return code */
+
+    if (req == NULL || flag == NULL) {
+        DALECI_Error("req (%p) or flag (%p) is a null pointer", req, flag);
+        return DALEC_INPUT_ERROR;
+    }
+    if (req->count == 0) {
+        *flag = 1;
+        return DALEC_SUCCESS;
+    }
+
+    rc = MPI_Testall(req->count, req->reqs, flag, MPI_STATUSES_IGNORE);
+    DALECI_Check_MPI(FCNAME, "MPI_Testall", rc);
+
+    return (*flag) ? DALECI_Request_complete(req) : DALEC_SUCCESS;
+}
+
+/* -- begin weak symbols block -- */
+#if defined(HAVE_PRAGMA_WEAK)
+#  pragma weak DALEC_Waitall = PDALEC_Waitall
+#elif defined(HAVE_PRAGMA_HP_SEC_DEF)
+#  pragma _HP_SECONDARY_DEF PDALEC_Waitall DALEC_Waitall
+#elif defined(HAVE_PRAGMA_CRI_DUP)
+#  pragma _CRI duplicate DALEC_Waitall as PDALEC_Waitall
+#elif defined(HAVE_WEAK_ATTRIBUTE)
+int DALEC_Waitall(int count, DALEC_Request reqs[]) __attribute__ ((weak, alias("PDALEC_Waitall")));
+#else
+#define DALEC_Waitall PDALEC_Waitall
+#endif
+/* -- end weak symbols block -- */
+
+/** Block until all of a list of nonblocking operations are complete.
+  *
+  * @param[in]     count Number of requests
+  * @param[in,out] reqs  Requests from DALEC_NbPut, DALEC_NbGet or DALEC_NbAcc
+  * @return              Zero on success
+  */
+int DALEC_Waitall(int count, DALEC_Request reqs[])
+{
+    for (int i=0; i<count; i++) {
+        int rc = DALEC_Wait(&reqs[i]);
+        if (rc != DALEC_SUCCESS) return rc;
+    }
+    return DALEC_SUCCESS;
+}
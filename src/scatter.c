@@ -0,0 +1,301 @@
+/*
+ * Copyright (C) 2014. See COPYRIGHT in top-level directory.
+ */
+
+#include <dalec.h>
+#include <dalec_guts.h>
+#include <debug.h>
+
+/* Irregular element lists are sorted by owner and by position in the block
+ * of the owner, so that each owner is reached with a single RMA operation
+ * whose target datatype lists the elements in increasing order.  Repeated
+ * elements are merged first because MPI does not allow a target datatype to
+ * name a location twice: for scatter the last value in the list wins, for
+ * accumulate the values are added, and for gather the value is fetched once
+ * and copied to every position that asked for it. */
+
+typedef struct {
+    int    target;
+    size_t disp;                        /* in elements of the block of target           */
+    size_t k;                           /* position in the user list                    */
+} DALECI_Scatter_elem;
+
+static int DALECI_Scatter_compare(const void * a, const void * b)
+{
+    const DALECI_Scatter_elem * x = a, * y = b;
+    if (x->target != y->target) return (x->target < y->target) ? -1 : 1;
+    if (x->disp   != y->disp)   return (x->disp   < y->disp)   ? -1 : 1;
+    return (x->k < y->k) ? -1 : (x->k > y->k);
+}
+
+/** Move a list of elements between a user buffer and the array.
+  *
+  * @param[in] op      DALECI_OP_PUT, DALECI_OP_GET or DALECI_OP_ACC
+  * @param[in] h       Array handle
+  * @param[in] n       Number of elements
+  * @param[in] subs    Global index of element k in subs[k*ndim .. k*ndim+ndim-1]
+  * @param[in] buf     Value of element k in buf[k]
+  * @param[in] alpha   Scale factor for DALECI_OP_ACC, or NULL for one
+  * @return            Zero on success
+  */
+static int DALECI_Scatter_op(enum DALECI_Op_e op, const DALEC_Array_handle * h,
+                             size_t n, const size_t subs[], void * buf, const void * alpha)
+{
+    int rc; /* MPI return code */
+
+    if (h==NULL || (n>0 && (subs==NULL || buf==NULL))) {
+        DALECI_Error("h (%p), subs (%p) or buf (%p) is a null pointer", h, subs, buf);
+        return DALEC_INPUT_ERROR;
+    }
+    if (n == 0) {
+        return DALEC_SUCCESS;
+    }
+
+    const int ndim = h->ndim;
+
+    int type_size = 0;
+    rc = MPI_Type_size(h->type, &type_size);
+    DALECI_Check_MPI(__func__, "MPI_Type_size", rc);
+
+    DALECI_Scatter_elem * elems = malloc(n * sizeof(DALECI_Scatter_elem));
+    MPI_Aint * tdisps = malloc(n * sizeof(MPI_Aint));
+    int * targets = malloc(n * sizeof(int));
+    size_t * slot = (op == DALECI_OP_GET) ? malloc(n * sizeof(size_t)) : NULL;
+    char * packed = DALECI_Staging_get(h->staging, n * type_size);
+    if (elems == NULL || tdisps == NULL || targets == NULL || packed == NULL || (op == DALECI_OP_GET && slot == NULL)) {
+        DALECI_Error("malloc for %zu elements failed", n);
+        return DALEC_INPUT_ERROR;
+    }
+
+    /* owner and position of every element, from the closed-form distribution */
+    for (size_t k=0; k<n; k++) {
+        int target = 0;
+        size_t disp = 0;
+        for (int i=0; i<ndim; i++) {
+            const size_t x = subs[k*ndim+i];
+            if (x >= h->dims[i]) {
+                DALECI_Error("element %zu: index %zu is not within dims[%d] = %zu", k, x, i, h->dims[i]);
+                return DALEC_INPUT_ERROR;
+            }
+            const int c = DALECI_Block_coord(h, i, x);
+            target = target * h->pedims[i] + c;
+            disp   = disp * DALECI_Block_padded(h, i, c) + (DALECI_Local_index(h, i, x) + h->ghosts[i]);
+        }
+        elems[k].target = target;
+        elems[k].disp   = disp;
+        elems[k].k      = k;
+    }
+    qsort(elems, n, sizeof(DALECI_Scatter_elem), DALECI_Scatter_compare);
+
+    /* merge repeated elements; u counts the distinct ones */
+    size_t u = 0;
+    for (size_t j=0; j<n; j++) {
+        const char * src = (char*)buf + elems[j].k * type_size;
+        const int repeat = (j > 0 && elems[j].target == elems[j-1].target && elems[j].disp == elems[j-1].disp);
+        if (!repeat) {
+            elems[u] = elems[j];
+            u++;
+            if (op != DALECI_OP_GET) {
+                memcpy(packed + (u-1) * type_size, src, type_size);
+            }
+        } else if (op == DALECI_OP_PUT) {
+            memcpy(packed + (u-1) * type_size, src, type_size);
+        } else if (op == DALECI_OP_ACC) {
+            rc = MPI_Reduce_local(src, packed + (u-1) * type_size, 1, h->type, MPI_SUM);
+            DALECI_Check_MPI(__func__, "MPI_Reduce_local", rc);
+        }
+        if (op == DALECI_OP_GET) {
+            slot[elems[j].k] = u-1;
+        }
+    }
+
+    char * origin = packed;
+    if (op == DALECI_OP_ACC && !DALECI_Scale_is_one(h->type, alpha)) {
+        origin = DALECI_Staging_get(h->staging, u * type_size);
+        if (origin == NULL) return DALEC_INPUT_ERROR;
+        rc = DALECI_Scale(h->type, u, alpha, packed, origin);
+        if (rc != DALEC_SUCCESS) return rc;
+    }
+
+    /* one operation per owner */
+    int ntargets = 0;
+    for (size_t first=0, last; first<u; first=last) {
+        const int target = elems[first].target;
+        for (last=first; last<u && elems[last].target == target; last++) {
+            tdisps[last] = (MPI_Aint)(elems[last].disp * type_size);
+        }
+        const int count = (int)(last-first);
+        char * o = origin + first * type_size;
+
+        if (h->aggregate != NULL) {
+            rc = DALECI_Aggregate_flush_target(h, target);
+            if (rc != DALEC_SUCCESS) return rc;
+        }
+        rc = DALECI_Dirty_order(h, target, op);
+        if (rc != DALEC_SUCCESS) return rc;
+
+        /* owners on the same node are accessed with load/store */
+        char * base = (op != DALECI_OP_ACC) ? DALECI_Shm_base(h, target) : NULL;
+        if (base != NULL) {
+            if (op == DALECI_OP_GET) {
+                rc = MPI_Win_sync(h->shm->win);
+                DALECI_Check_MPI(__func__, "MPI_Win_sync", rc);
+            }
+            for (int j=0; j<count; j++) {
+                char * t = base + tdisps[first+j];
+                if (op == DALECI_OP_PUT) {
+                    memcpy(t, o + j * type_size, type_size);
+                } else {
+                    memcpy(o + j * type_size, t, type_size);
+                }
+            }
+            if (op == DALECI_OP_PUT) {
+                rc = MPI_Win_sync(h->shm->win);
+                DALECI_Check_MPI(__func__, "MPI_Win_sync", rc);
+            }
+            continue;
+        }
+
+        DALECI_Dbg_print(DEBUG_CAT_RMA, "op = %d target = %d elements = %d\n", op, target, count);
+
+        MPI_Datatype ttype;
+        rc = MPI_Type_create_hindexed_block(count, 1, tdisps + first, h->type, &ttype);
+        DALECI_Check_MPI(__func__, "MPI_Type_create_hindexed_block", rc);
+        rc = MPI_Type_commit(&ttype);
+        DALECI_Check_MPI(__func__, "MPI_Type_commit", rc);
+        const MPI_Aint tdisp = DALECI_Target_disp(h, target, 0);
+
+        switch (op) {
+            case DALECI_OP_PUT:
+                rc = MPI_Put(o, count, h->type, target, tdisp, 1, ttype, h->win);
+                DALECI_Check_MPI(__func__, "MPI_Put", rc);
+                break;
+            case DALECI_OP_GET:
+                rc = MPI_Get(o, count, h->type, target, tdisp, 1, ttype, h->win);
+                DALECI_Check_MPI(__func__, "MPI_Get", rc);
+                break;
+            case DALECI_OP_ACC:
+                rc = MPI_Accumulate(o, count, h->type, target, tdisp, 1, ttype, MPI_SUM, h->win);
+                DALECI_Check_MPI(__func__, "MPI_Accumulate", rc);
+                break;
+        }
+        MPI_Type_free(&ttype);
+
+        DALECI_Dirty_mark(h, target, op);
+        targets[ntargets++] = target;
+    }
+
+    for (int j=0; j<ntargets; j++) {
+        rc = MPI_Win_flush_local(targets[j], h->win);
+        DALECI_Check_MPI(__func__, "MPI_Win_flush_local", rc);
+    }
+
+    /* back to the order of the user */
+    if (op == DALECI_OP_GET) {
+        for (size_t k=0; k<n; k++) {
+            memcpy((char*)buf + k * type_size, packed + slot[k] * type_size, type_size);
+        }
+    }
+
+    if (origin != packed) {
+        DALECI_Staging_put(h->staging, origin);
+    }
+    DALECI_Staging_put(h->staging, packed);
+    free(slot);
+    free(targets);
+    free(tdisps);
+    free(elems);
+
+    return DALEC_SUCCESS;
+}
+
+/* -- begin weak symbols block -- */
+#if defined(HAVE_PRAGMA_WEAK)
+#  pragma weak DALEC_Scatter = PDALEC_Scatter
+#elif defined(HAVE_PRAGMA_HP_SEC_DEF)
+#  pragma _HP_SECONDARY_DEF PDALEC_Scatter DALEC_Scatter
+#elif defined(HAVE_PRAGMA_CRI_DUP)
+#  pragma _CRI duplicate DALEC_Scatter as PDALEC_Scatter
+#elif defined(HAVE_WEAK_ATTRIBUTE)
+int DALEC_Scatter(const DALEC_Array_handle * h, size_t n, const size_t subs[], const void * buf)
+    __attribute__ ((weak, alias("PDALEC_Scatter")));
+#else
+#define DALEC_Scatter PDALEC_Scatter
+#endif
+/* -- end weak symbols block -- */
+
+/** Write a list of elements of the array.  If an element appears more than
+  * once, the last value given for it is written.  Blocking, with the same
+  * completion as DALEC_Put.
+  *
+  * @param[in] h       Array handle
+  * @param[in] n       Number of elements
+  * @param[in] subs    Global index of element k in subs[k*ndim .. k*ndim+ndim-1]
+  * @param[in] buf     Value of element k in buf[k]
+  * @return            Zero on success
+  */
+int DALEC_Scatter(const DALEC_Array_handle * h, size_t n, const size_t subs[], const void * buf)
+{
+    return DALECI_Scatter_op(DALECI_OP_PUT, h, n, subs, (void*)buf, NULL);
+}
+
+/* -- begin weak symbols block -- */
+#if defined(HAVE_PRAGMA_WEAK)
+#  pragma weak DALEC_Gather = PDALEC_Gather
+#elif defined(HAVE_PRAGMA_HP_SEC_DEF)
+#  pragma _HP_SECONDARY_DEF PDALEC_Gather DALEC_Gather
+#elif defined(HAVE_PRAGMA_CRI_DUP)
+#  pragma _CRI duplicate DALEC_Gather as PDALEC_Gather
+#elif defined(HAVE_WEAK_ATTRIBUTE)
+int DALEC_Gather(const DALEC_Array_handle * h, size_t n, const size_t subs[], void * buf)
+    __attribute__ ((weak, alias("PDALEC_Gather")));
+#else
+#define DALEC_Gather PDALEC_Gather
+#endif
+/* -- end weak symbols block -- */
+
+/** Read a list of elements of the array, in the order of the list.
+  * Blocking.
+  *
+  * @param[in]  h      Array handle
+  * @param[in]  n      Number of elements
+  * @param[in]  subs   Global index of element k in subs[k*ndim .. k*ndim+ndim-1]
+  * @param[out] buf    Value of element k in buf[k]
+  * @return            Zero on success
+  */
+int DALEC_Gather(const DALEC_Array_handle * h, size_t n, const size_t subs[], void * buf)
+{
+    return DALECI_Scatter_op(DALECI_OP_GET, h, n, subs, buf, NULL);
+}
+
+/* -- begin weak symbols block -- */
+#if defined(HAVE_PRAGMA_WEAK)
+#  pragma weak DALEC_Scatter_acc = PDALEC_Scatter_acc
+#elif defined(HAVE_PRAGMA_HP_SEC_DEF)
+#  pragma _HP_SECONDARY_DEF PDALEC_Scatter_acc DALEC_Scatter_acc
+#elif defined(HAVE_PRAGMA_CRI_DUP)
+#  pragma _CRI duplicate DALEC_Scatter_acc as PDALEC_Scatter_acc
+#elif defined(HAVE_WEAK_ATTRIBUTE)
+int DALEC_Scatter_acc(const DALEC_Array_handle * h, size_t n, const size_t subs[], const void * buf, const void * alpha)
+    __attribute__ ((weak, alias("PDALEC_Scatter_acc")));
+#else
+#define DALEC_Scatter_acc PDALEC_Scatter_acc
+#endif
+/* -- end weak symbols block -- */
+
+/** Add alpha times a list of values to elements of the array, element-wise
+  * atomically with respect to other accumulates.  An element that appears
+  * more than once receives the sum of its values.  Blocking, with the same
+  * completion as DALEC_Acc.
+  *
+  * @param[in] h       Array handle
+  * @param[in] n       Number of elements
+  * @param[in] subs    Global index of element k in subs[k*ndim .. k*ndim+ndim-1]
+  * @param[in] buf     Value of element k in buf[k]
+  * @param[in] alpha   Scale factor of the type of the array, or NULL for one
+  * @return            Zero on success
+  */
+int DALEC_Scatter_acc(const DALEC_Array_handle * h, size_t n, const size_t subs[], const void * buf, const void * alpha)
+{
+    return DALECI_Scatter_op(DALECI_OP_ACC, h, n, subs, (void*)buf, alpha);
+}
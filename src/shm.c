@@ -0,0 +1,215 @@
+/*
+ * Copyright (C) 2014. See COPYRIGHT in top-level directory.
+ */
+
+#include <dalec.h>
+#include <dalec_guts.h>
+#include <debug.h>
+
+/* The memory of an array is allocated node by node with
+ * MPI_Win_allocate_shared and then exposed to all ranks of the array with
+ * MPI_Win_create.  Puts and gets whose owner is on the same node are then
+ * done with load/store through the pointers from MPI_Win_shared_query, and
+ * only owners on other nodes are reached with RMA.  Accumulates always use
+ * RMA to keep their element-wise atomicity.  When all ranks of the array are
+ * on one node, the shared-memory window serves as the window of the array. */
+
+/** Allocate the memory of an array in a shared-memory window on each node
+  * and create the window of the array on top of it.
+  *
+  * @param[in,out] h         Array handle, comm is used and win and shm are set
+  * @param[in]     bytes     Size of the local block in bytes
+  * @param[in]     type_size Displacement unit
+  * @param[out]    baseptr   Base of the local block
+  * @return                  Zero on success
+  */
+int DALECI_Shm_allocate(DALEC_Array_handle * h, MPI_Aint bytes, int type_size, void * baseptr)
+{
+    int rc; /* MPI return code */
+
+    struct DALECI_Shm_s * shm = calloc(1, sizeof(struct DALECI_Shm_s));
+    if (shm == NULL) {
+        DALECI_Error("calloc of shared-memory state failed");
+        return DALEC_INPUT_ERROR;
+    }
+
+    rc = MPI_Comm_split_type(h->comm, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &(shm->comm));
+    DALECI_Check_MPI(__func__, "MPI_Comm_split_type", rc);
+
+    MPI_Comm_size(shm->comm, &(shm->size));
+
+    /* there is no reason for the segments of a node to be contiguous */
+    MPI_Info info;
+    MPI_Info_create(&info);
+    MPI_Info_set(info, "alloc_shared_noncontig", "true");
+    rc = MPI_Win_allocate_shared(bytes, type_size, info, shm->comm, baseptr, &(shm->win));
+    DALECI_Check_MPI(__func__, "MPI_Win_allocate_shared", rc);
+    MPI_Info_free(&info);
+
+    int size;
+    MPI_Comm_size(h->comm, &size);
+    if (shm->size < size) {
+        rc = MPI_Win_create(*(void**)baseptr, bytes, type_size, MPI_INFO_NULL, h->comm, &(h->win));
+        DALECI_Check_MPI(__func__, "MPI_Win_create", rc);
+    } else {
+        h->win = shm->win;
+    }
+
+    /* ranks of the node in the array communicator, which are sorted because
+     * the split used the same key everywhere */
+    shm->ranks = malloc(shm->size * sizeof(int));
+    shm->bases = malloc(shm->size * sizeof(void*));
+    int * node_ranks = malloc(shm->size * sizeof(int));
+    if (shm->ranks == NULL || shm->bases == NULL || node_ranks == NULL) {
+        DALECI_Error("malloc of %d node peers failed", shm->size);
+        return DALEC_INPUT_ERROR;
+    }
+
+    MPI_Group node_group, array_group;
+    MPI_Comm_group(shm->comm, &node_group);
+    MPI_Comm_group(h->comm, &array_group);
+    for (int i=0; i<shm->size; i++) {
+        node_ranks[i] = i;
+    }
+    rc = MPI_Group_translate_ranks(node_group, shm->size, node_ranks, array_group, shm->ranks);
+    DALECI_Check_MPI(__func__, "MPI_Group_translate_ranks", rc);
+    MPI_Group_free(&node_group);
+    MPI_Group_free(&array_group);
+    free(node_ranks);
+
+    for (int i=0; i<shm->size; i++) {
+        MPI_Aint size;
+        int disp_unit;
+        rc = MPI_Win_shared_query(shm->win, i, &size, &disp_unit, &(shm->bases[i]));
+        DALECI_Check_MPI(__func__, "MPI_Win_shared_query", rc);
+    }
+
+    /* needed for MPI_Win_sync, the window of the array is locked by the caller */
+    if (shm->win != h->win) {
+        rc = MPI_Win_lock_all(MPI_MODE_NOCHECK, shm->win);
+        DALECI_Check_MPI(__func__, "MPI_Win_lock_all", rc);
+    }
+
+    DALECI_Dbg_print(DEBUG_CAT_ARRAY_DIST, "%d ranks share memory\n", shm->size);
+
+    h->shm = shm;
+
+    return DALEC_SUCCESS;
+}
+
+/** Free the window of an array and the shared-memory window under it.  The
+  * window of the array must already be unlocked.
+  *
+  * @param[in,out] win  Window of the array, set to MPI_WIN_NULL
+  * @param[in]     shm  Shared-memory state under it, freed
+  * @return             Zero on success
+  */
+int DALECI_Shm_free(MPI_Win * win, struct DALECI_Shm_s * shm)
+{
+    int rc; /* MPI return code */
+
+    if (shm->win != *win) {
+        rc = MPI_Win_free(win);
+        DALECI_Check_MPI(__func__, "MPI_Win_free", rc);
+
+        rc = MPI_Win_unlock_all(shm->win);
+        DALECI_Check_MPI(__func__, "MPI_Win_unlock_all", rc);
+    } else {
+        *win = MPI_WIN_NULL;
+    }
+
+    rc = MPI_Win_free(&(shm->win));
+    DALECI_Check_MPI(__func__, "MPI_Win_free", rc);
+
+    rc = MPI_Comm_free(&(shm->comm));
+    DALECI_Check_MPI(__func__, "MPI_Comm_free", rc);
+
+    free(shm->ranks);
+    free(shm->bases);
+    free(shm);
+
+    return DALEC_SUCCESS;
+}
+
+/** Find the local block of a rank that shares memory with the caller.
+  *
+  * @return            Base of the block, or NULL if the rank is on another node
+  */
+void * DALECI_Shm_base(const DALEC_Array_handle * h, int target)
+{
+    const struct DALECI_Shm_s * shm = h->shm;
+    if (shm == NULL) {
+        return NULL;
+    }
+
+    int lo = 0, hi = shm->size-1;
+    while (lo < hi) {
+        const int mid = lo + (hi-lo)/2;
+        if (shm->ranks[mid] < target) {
+            lo = mid+1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (shm->ranks[lo] != target) {
+        return NULL;
+    }
+
+    int type_size;
+    MPI_Type_size(h->type, &type_size);
+    return (char*)shm->bases[lo] + h->disp * type_size;
+}
+
+/** Put or get a subarray with load/store, row by row.  The subarray is
+  * described as for MPI_Type_create_subarray on both sides.
+  *
+  * @return            Zero on success
+  */
+int DALECI_Shm_copy(const DALEC_Array_handle * h, enum DALECI_Op_e op, void * base, void * buf, int type_size,
+                    const int osizes[], const int ostarts[],
+                    const int tsizes[], const int tstarts[], const int subsizes[])
+{
+    int rc; /* MPI return code */
+
+    const int ndim = h->ndim;
+    const size_t rowbytes = (size_t)subsizes[ndim-1] * type_size;
+    int nrows = 1;
+    for (int i=0; i<ndim-1; i++) {
+        nrows *= subsizes[i];
+    }
+
+    /* see the stores of other processes */
+    if (op == DALECI_OP_GET) {
+        rc = MPI_Win_sync(h->shm->win);
+        DALECI_Check_MPI(__func__, "MPI_Win_sync", rc);
+    }
+
+    int idx[DALEC_ARRAY_MAX_DIM] = {0};
+    for (int r=0; r<nrows; r++) {
+        size_t tdisp = 0, odisp = 0;
+        for (int i=0; i<ndim; i++) {
+            tdisp = tdisp * tsizes[i] + tstarts[i] + idx[i];
+            odisp = odisp * osizes[i] + ostarts[i] + idx[i];
+        }
+        char * t = (char*)base + tdisp * type_size;
+        char * o = (char*)buf  + odisp * type_size;
+        if (op == DALECI_OP_PUT) {
+            memcpy(t, o, rowbytes);
+        } else {
+            memcpy(o, t, rowbytes);
+        }
+
+        for (int i=ndim-2; i>=0; i--) {
+            if (++idx[i] < subsizes[i]) break;
+            idx[i] = 0;
+        }
+    }
+
+    /* make our stores visible to other processes */
+    if (op == DALECI_OP_PUT) {
+        rc = MPI_Win_sync(h->shm->win);
+        DALECI_Check_MPI(__func__, "MPI_Win_sync", rc);
+    }
+
+    return DALEC_SUCCESS;
+}
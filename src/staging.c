@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2014. See COPYRIGHT in top-level directory.
+ */
+
+#include <dalec.h>
+#include <dalec_guts.h>
+#include <debug.h>
+
+/* Staging buffers, e.g. for scaled accumulates, are taken from a pool that
+ * belongs to the array and are returned to it when the operation that
+ * uses them is locally complete, so that steady-state loops do not call the
+ * allocator.  Buffers are sized in powers of two and cache-line aligned.
+ * Returned buffers are kept up to DALEC_STAGING_BYTES (default 64 MiB) in
+ * total and freed beyond that. */
+
+#define DALECI_STAGING_ALIGN 64
+#define DALECI_STAGING_MIN   4096
+
+typedef struct DALECI_Staging_buf_s {
+    struct DALECI_Staging_buf_s * next;
+    size_t                        bytes;
+} DALECI_Staging_buf;
+
+struct DALECI_Staging_s {
+    DALECI_Staging_buf * free;          /* buffers not in use                           */
+    size_t               cached;        /* total size of the buffers not in use         */
+    size_t               max_cached;    /* limit on cached                              */
+};
+
+/* the header is padded to keep the data aligned */
+#define DALECI_STAGING_HEADER(ptr_) ((DALECI_Staging_buf*)((char*)(ptr_) - DALECI_STAGING_ALIGN))
+
+/** Set up the staging pool of an array.
+  *
+  * @return            Zero on success
+  */
+int DALECI_Staging_create(DALEC_Array_handle * h)
+{
+    struct DALECI_Staging_s * s = calloc(1, sizeof(struct DALECI_Staging_s));
+    if (s == NULL) {
+        DALECI_Error("calloc of staging pool failed");
+        return DALEC_INPUT_ERROR;
+    }
+    s->max_cached = (size_t)DALECI_Getenv_int("DALEC_STAGING_BYTES", 64<<20);
+    h->staging = s;
+    return DALEC_SUCCESS;
+}
+
+/** Free the staging pool of an array.  No buffer may be in use. */
+void DALECI_Staging_free(DALEC_Array_handle * h)
+{
+    struct DALECI_Staging_s * s = h->staging;
+    if (s == NULL) return;
+    while (s->free != NULL) {
+        DALECI_Staging_buf * next = s->free->next;
+        free(s->free);
+        s->free = next;
+    }
+    free(s);
+    h->staging = NULL;
+}
+
+/** Take a buffer of at least bytes bytes from the staging pool of an array.
+  *
+  * @return            The buffer, or NULL if allocation failed
+  */
+void * DALECI_Staging_get(struct DALECI_Staging_s * s, size_t bytes)
+{
+    /* first fit, the pool is short */
+    for (DALECI_Staging_buf ** p = &(s->free); *p != NULL; p = &((*p)->next)) {
+        if ((*p)->bytes >= bytes) {
+            DALECI_Staging_buf * b = *p;
+            *p = b->next;
+            s->cached -= b->bytes;
+            return (char*)b + DALECI_STAGING_ALIGN;
+        }
+    }
+
+    size_t size = DALECI_STAGING_MIN;
+    while (size < bytes) size *= 2;
+
+    void * ptr = NULL;
+    if (posix_memalign(&ptr, DALECI_STAGING_ALIGN, DALECI_STAGING_ALIGN + size) != 0) {
+        DALECI_Error("posix_memalign of %zu staging bytes failed", size);
+        return NULL;
+    }
+    DALECI_Staging_buf * b = ptr;
+    b->bytes = size;
+
+    DALECI_Dbg_print(DEBUG_CAT_RMA, "new staging buffer of %zu bytes\n", size);
+
+    return (char*)b + DALECI_STAGING_ALIGN;
+}
+
+/** Return a buffer to the staging pool it came from. */
+void DALECI_Staging_put(struct DALECI_Staging_s * s, void * ptr)
+{
+    if (ptr == NULL) return;
+    DALECI_Staging_buf * b = DALECI_STAGING_HEADER(ptr);
+    if (s->cached + b->bytes > s->max_cached) {
+        free(b);
+        return;
+    }
+    b->next = s->free;
+    s->free = b;
+    s->cached += b->bytes;
+}
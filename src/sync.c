@@ -0,0 +1,238 @@
+/*
+ * Copyright (C) 2014. See COPYRIGHT in top-level directory.
+ */
+
+#include <dalec.h>
+#include <dalec_guts.h>
+#include <debug.h>
+
+/* The window of an array stays in a lock_all epoch from creation to
+ * destruction.  Operations are only completed locally (MPI_Win_flush_local)
+ * when they are issued, and every target with an update in flight is
+ * recorded in a bitmap, plus a list so that completing them costs time in
+ * the number of targets touched rather than in the size of the array.
+ * MPI orders neither puts nor gets against other operations to the same
+ * target, so a target is flushed before an operation that could conflict
+ * with what is in flight there; accumulates are ordered among themselves. */
+
+struct DALECI_Dirty_s {
+    int             size;               /* number of ranks of the array                 */
+    int             count;              /* number of entries in list                    */
+    int           * list;               /* targets with an update in flight             */
+    unsigned char * bits;               /* bitmap of list                               */
+    unsigned char * puts;               /* targets with a put in flight                 */
+};
+
+#define DALECI_BIT_GET(map_,r_) ((map_)[(r_)>>3] &  (1u<<((r_)&7)))
+#define DALECI_BIT_SET(map_,r_) ((map_)[(r_)>>3] |= (1u<<((r_)&7)))
+#define DALECI_BIT_CLR(map_,r_) ((map_)[(r_)>>3] &= ~(1u<<((r_)&7)))
+
+/** Set up the tracking of targets with updates in flight.
+  *
+  * @return            Zero on success
+  */
+int DALECI_Dirty_create(DALEC_Array_handle * h)
+{
+    struct DALECI_Dirty_s * d = calloc(1, sizeof(struct DALECI_Dirty_s));
+    if (d == NULL) {
+        DALECI_Error("calloc of dirty-target state failed");
+        return DALEC_INPUT_ERROR;
+    }
+    MPI_Comm_size(h->comm, &(d->size));
+
+    const size_t nbytes = (d->size + 7) / 8;
+    d->bits = calloc(2*nbytes, 1);
+    d->list = malloc(d->size * sizeof(int));
+    if (d->bits == NULL || d->list == NULL) {
+        DALECI_Error("malloc of dirty-target bitmap for %d ranks failed", d->size);
+        return DALEC_INPUT_ERROR;
+    }
+    d->puts = d->bits + nbytes;
+
+    h->dirty = d;
+
+    return DALEC_SUCCESS;
+}
+
+/** Release the tracking state.  Nothing may be in flight. */
+void DALECI_Dirty_free(DALEC_Array_handle * h)
+{
+    if (h->dirty != NULL) {
+        free(h->dirty->bits);
+        free(h->dirty->list);
+        free(h->dirty);
+        h->dirty = NULL;
+    }
+}
+
+/** Complete all updates in flight at one target.
+  *
+  * @return            Zero on success
+  */
+int DALECI_Dirty_flush_target(const DALEC_Array_handle * h, int target)
+{
+    int rc; /* MPI return code */
+
+    struct DALECI_Dirty_s * d = h->dirty;
+    if (!DALECI_BIT_GET(d->bits, target)) {
+        return DALEC_SUCCESS;
+    }
+
+    rc = MPI_Win_flush(target, h->win);
+    DALECI_Check_MPI(__func__, "MPI_Win_flush", rc);
+
+    DALECI_BIT_CLR(d->bits, target);
+    DALECI_BIT_CLR(d->puts, target);
+    for (int j=0; j<d->count; j++) {
+        if (d->list[j] == target) {
+            d->list[j] = d->list[--(d->count)];
+            break;
+        }
+    }
+
+    return DALEC_SUCCESS;
+}
+
+/** Complete all updates in flight at every target.
+  *
+  * @return            Zero on success
+  */
+int DALECI_Dirty_flush_all(const DALEC_Array_handle * h)
+{
+    int rc; /* MPI return code */
+
+    struct DALECI_Dirty_s * d = h->dirty;
+    if (d->count == 0) {
+        return DALEC_SUCCESS;
+    }
+
+    DALECI_Dbg_print(DEBUG_CAT_RMA, "flushing %d of %d targets\n", d->count, d->size);
+
+    /* past some point one call is cheaper than many */
+    if (2*d->count > d->size) {
+        rc = MPI_Win_flush_all(h->win);
+        DALECI_Check_MPI(__func__, "MPI_Win_flush_all", rc);
+    } else {
+        for (int j=0; j<d->count; j++) {
+            rc = MPI_Win_flush(d->list[j], h->win);
+            DALECI_Check_MPI(__func__, "MPI_Win_flush", rc);
+        }
+    }
+
+    for (int j=0; j<d->count; j++) {
+        DALECI_BIT_CLR(d->bits, d->list[j]);
+        DALECI_BIT_CLR(d->puts, d->list[j]);
+    }
+    d->count = 0;
+
+    return DALEC_SUCCESS;
+}
+
+/** Make sure that an operation about to be issued to a target cannot
+  * conflict with the updates in flight there.
+  *
+  * @return            Zero on success
+  */
+int DALECI_Dirty_order(const DALEC_Array_handle * h, int target, enum DALECI_Op_e op)
+{
+    const struct DALECI_Dirty_s * d = h->dirty;
+    const int conflict = (op == DALECI_OP_ACC) ? DALECI_BIT_GET(d->puts, target)
+                                               : DALECI_BIT_GET(d->bits, target);
+    return conflict ? DALECI_Dirty_flush_target(h, target) : DALEC_SUCCESS;
+}
+
+/** Record that an update to a target has been issued. */
+void DALECI_Dirty_mark(const DALEC_Array_handle * h, int target, enum DALECI_Op_e op)
+{
+    struct DALECI_Dirty_s * d = h->dirty;
+    if (op == DALECI_OP_GET) {
+        return;
+    }
+    if (!DALECI_BIT_GET(d->bits, target)) {
+        DALECI_BIT_SET(d->bits, target);
+        d->list[(d->count)++] = target;
+    }
+    if (op == DALECI_OP_PUT) {
+        DALECI_BIT_SET(d->puts, target);
+    }
+}
+
+/* -- begin weak symbols block -- */
+#if defined(HAVE_PRAGMA_WEAK)
+#  pragma weak DALEC_Fence = PDALEC_Fence
+#elif defined(HAVE_PRAGMA_HP_SEC_DEF)
+#  pragma _HP_SECONDARY_DEF PDALEC_Fence DALEC_Fence
+#elif defined(HAVE_PRAGMA_CRI_DUP)
+#  pragma _CRI duplicate DALEC_Fence as PDALEC_Fence
+#elif defined(HAVE_WEAK_ATTRIBUTE)
+int DALEC_Fence(const DALEC_Array_handle * h) __attribute__ ((weak, alias("PDALEC_Fence")));
+#else
+#define DALEC_Fence PDALEC_Fence
+#endif
+/* -- end weak symbols block -- */
+
+/** Complete all updates to an array issued by this process, including
+  * queued small updates, at their targets.  Only targets updated since the
+  * last fence are flushed.  Local.
+  *
+  * @param[in] h       Array handle
+  * @return            Zero on success
+  */
+int DALEC_Fence(const DALEC_Array_handle * h)
+{
+    int rc;
+
+    if (h == NULL) {
+        DALECI_Error("h is a null pointer");
+        return DALEC_INPUT_ERROR;
+    }
+
+    if (h->aggregate != NULL) {
+        rc = DALECI_Aggregate_flush_all(h);
+        if (rc != DALEC_SUCCESS) return rc;
+    }
+
+    return DALECI_Dirty_flush_all(h);
+}
+
+/* -- begin weak symbols block -- */
+#if defined(HAVE_PRAGMA_WEAK)
+#  pragma weak DALEC_Sync = PDALEC_Sync
+#elif defined(HAVE_PRAGMA_HP_SEC_DEF)
+#  pragma _HP_SECONDARY_DEF PDALEC_Sync DALEC_Sync
+#elif defined(HAVE_PRAGMA_CRI_DUP)
+#  pragma _CRI duplicate DALEC_Sync as PDALEC_Sync
+#elif defined(HAVE_WEAK_ATTRIBUTE)
+int DALEC_Sync(const DALEC_Array_handle * h) __attribute__ ((weak, alias("PDALEC_Sync")));
+#else
+#define DALEC_Sync PDALEC_Sync
+#endif
+/* -- end weak symbols block -- */
+
+/** Complete all updates to an array by all processes.  On return every
+  * process sees the updates that any process issued before the call.
+  * Collective over the communicator of the array.
+  *
+  * @param[in] h       Array handle
+  * @return            Zero on success
+  */
+int DALEC_Sync(const DALEC_Array_handle * h)
+{
+    int rc;
+
+    rc = DALEC_Fence(h);
+    if (rc != DALEC_SUCCESS) return rc;
+
+    /* load/store updates were already published when they were made */
+    rc = MPI_Barrier(h->comm);
+    DALECI_Check_MPI(__func__, "MPI_Barrier", rc);
+
+    rc = MPI_Win_sync(h->win);
+    DALECI_Check_MPI(__func__, "MPI_Win_sync", rc);
+    if (h->shm != NULL && h->shm->win != h->win) {
+        rc = MPI_Win_sync(h->shm->win);
+        DALECI_Check_MPI(__func__, "MPI_Win_sync", rc);
+    }
+
+    return DALEC_SUCCESS;
+}
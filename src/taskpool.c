@@ -0,0 +1,303 @@
+/*
+ * Copyright (C) 2014. See COPYRIGHT in top-level directory.
+ */
+
+#include <dalec.h>
+#include <dalec_guts.h>
+#include <debug.h>
+
+/* The counter of shard s is element s*shard_ranks of an array with one
+ * element per rank, so it lives with the first rank of the group that draws
+ * from it, i.e. on the same node as the group when ranks are placed by node.
+ * A counter holds the number of ids of its shard that have been handed out
+ * and may run past the end of the shard.  Chunks follow a guided schedule:
+ * a rank takes 1/(2*shard_ranks) of what it last saw remaining, but never
+ * less than min_chunk. */
+
+/** First task id of shard s. */
+static long DALECI_Taskpool_shard_lo(const DALEC_Taskpool * tp, int s)
+{
+    const long q = tp->ntasks / tp->nshards, r = tp->ntasks % tp->nshards;
+    return s*q + (s < r ? s : r);
+}
+
+/** Zero the counters owned by this rank and make that visible.  Collective.
+  *
+  * @return            Zero on success
+  */
+static int DALECI_Taskpool_zero(DALEC_Taskpool * tp)
+{
+    int rc;
+
+    const DALEC_Array_handle * h = &(tp->counters);
+    if (h->local_dims[0] > 0) {
+        const size_t lo[1] = {h->local_lo[0]}, hi[1] = {h->local_lo[0] + h->local_dims[0] - 1};
+        long * ptr;
+        rc = DALEC_Access(h, lo, hi, (void**)&ptr, NULL);
+        if (rc != DALEC_SUCCESS) return rc;
+        for (size_t k=0; k<h->local_dims[0]; k++) {
+            ptr[k] = 0;
+        }
+        rc = DALEC_Release_update(h, lo, hi);
+        if (rc != DALEC_SUCCESS) return rc;
+    }
+
+    tp->current  = tp->home;
+    tp->visited  = 0;
+    tp->seen     = 0;
+    tp->executed = 0;
+
+    return DALEC_Sync(h);
+}
+
+/* -- begin weak symbols block -- */
+#if defined(HAVE_PRAGMA_WEAK)
+#  pragma weak DALEC_Taskpool_create = PDALEC_Taskpool_create
+#elif defined(HAVE_PRAGMA_HP_SEC_DEF)
+#  pragma _HP_SECONDARY_DEF PDALEC_Taskpool_create DALEC_Taskpool_create
+#elif defined(HAVE_PRAGMA_CRI_DUP)
+#  pragma _CRI duplicate DALEC_Taskpool_create as PDALEC_Taskpool_create
+#elif defined(HAVE_WEAK_ATTRIBUTE)
+int DALEC_Taskpool_create(MPI_Comm comm, long ntasks, long min_chunk, DALEC_Taskpool * tp)
+    __attribute__ ((weak, alias("PDALEC_Taskpool_create")));
+#else
+#define DALEC_Taskpool_create PDALEC_Taskpool_create
+#endif
+/* -- end weak symbols block -- */
+
+/** Create a pool of the task ids [0,ntasks).  Collective.
+  *
+  * The number of ranks per shard is the largest number of ranks of comm on
+  * one node, unless DALEC_TASKPOOL_SHARD_RANKS is set.
+  *
+  * @param[in]  comm      Communicator of the ranks that draw tasks
+  * @param[in]  ntasks    Number of tasks
+  * @param[in]  min_chunk Smallest number of tasks handed out at once (at least 1)
+  * @param[out] tp        Task pool
+  * @return               Zero on success
+  */
+int DALEC_Taskpool_create(MPI_Comm comm, long ntasks, long min_chunk, DALEC_Taskpool * tp)
+{
+    int rc;
+
+    if (tp == NULL || ntasks < 0) {
+        DALECI_Error("tp (%p) is a null pointer or ntasks (%ld) is negative", tp, ntasks);
+        return DALEC_INPUT_ERROR;
+    }
+
+    int np, me;
+    MPI_Comm_size(comm, &np);
+    MPI_Comm_rank(comm, &me);
+
+    int shard_ranks = DALECI_Getenv_int("DALEC_TASKPOOL_SHARD_RANKS", 0);
+    if (shard_ranks <= 0) {
+        MPI_Comm node;
+        rc = MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &node);
+        DALECI_Check_MPI(__func__, "MPI_Comm_split_type", rc);
+        MPI_Comm_size(node, &shard_ranks);
+        MPI_Comm_free(&node);
+    }
+    /* every rank must agree */
+    rc = MPI_Allreduce(MPI_IN_PLACE, &shard_ranks, 1, MPI_INT, MPI_MAX, comm);
+    DALECI_Check_MPI(__func__, "MPI_Allreduce", rc);
+    if (shard_ranks > np) shard_ranks = np;
+
+    tp->ntasks      = ntasks;
+    tp->min_chunk   = (min_chunk > 0) ? min_chunk : 1;
+    tp->shard_ranks = shard_ranks;
+    tp->nshards     = (np + shard_ranks - 1) / shard_ranks;
+    tp->home        = me / shard_ranks;
+
+    DALECI_Dbg_print(DEBUG_CAT_ARRAY_DIST, "ntasks = %ld, nshards = %d, shard_ranks = %d, home = %d\n",
+                     ntasks, tp->nshards, tp->shard_ranks, tp->home);
+
+    DALEC_Array_descriptor d = { .comm = comm, .type = MPI_LONG, .ndim = 1, .dims = {np}, .name = "DALEC taskpool" };
+    rc = DALEC_Create_array(&d, &(tp->counters));
+    if (rc != DALEC_SUCCESS) return rc;
+
+    return DALECI_Taskpool_zero(tp);
+}
+
+/* -- begin weak symbols block -- */
+#if defined(HAVE_PRAGMA_WEAK)
+#  pragma weak DALEC_Taskpool_next = PDALEC_Taskpool_next
+#elif defined(HAVE_PRAGMA_HP_SEC_DEF)
+#  pragma _HP_SECONDARY_DEF PDALEC_Taskpool_next DALEC_Taskpool_next
+#elif defined(HAVE_PRAGMA_CRI_DUP)
+#  pragma _CRI duplicate DALEC_Taskpool_next as PDALEC_Taskpool_next
+#elif defined(HAVE_WEAK_ATTRIBUTE)
+int DALEC_Taskpool_next(DALEC_Taskpool * tp, long * first, long * count)
+    __attribute__ ((weak, alias("PDALEC_Taskpool_next")));
+#else
+#define DALEC_Taskpool_next PDALEC_Taskpool_next
+#endif
+/* -- end weak symbols block -- */
+
+/** Take the next chunk of tasks.  Every id is handed out exactly once.
+  * Local.
+  *
+  * @param[in,out] tp    Task pool
+  * @param[out]    first First task id of the chunk
+  * @param[out]    count Number of tasks in the chunk, zero when the pool is empty
+  * @return              Zero on success
+  */
+int DALEC_Taskpool_next(DALEC_Taskpool * tp, long * first, long * count)
+{
+    int rc;
+
+    if (tp == NULL || first == NULL || count == NULL) {
+        DALECI_Error("tp (%p), first (%p) or count (%p) is a null pointer", tp, first, count);
+        return DALEC_INPUT_ERROR;
+    }
+
+    while (tp->visited < tp->nshards) {
+        const int s = tp->current;
+        const size_t idx[1] = {(size_t)s * tp->shard_ranks};
+        const long lo  = DALECI_Taskpool_shard_lo(tp, s);
+        const long len = DALECI_Taskpool_shard_lo(tp, s+1) - lo;
+
+        /* we know nothing about a shard we help with until we look */
+        if (tp->seen < 0) {
+            rc = DALEC_Read_inc(&(tp->counters), idx, 0, &(tp->seen));
+            if (rc != DALEC_SUCCESS) return rc;
+        }
+
+        if (tp->seen < len) {
+            long chunk = (len - tp->seen) / (2*tp->shard_ranks);
+            if (chunk < tp->min_chunk) chunk = tp->min_chunk;
+
+            long old;
+            rc = DALEC_Read_inc(&(tp->counters), idx, chunk, &old);
+            if (rc != DALEC_SUCCESS) return rc;
+
+            tp->seen = old + chunk;
+            if (old < len) {
+                *first = lo + old;
+                *count = (chunk < len - old) ? chunk : len - old;
+                tp->executed += *count;
+                return DALEC_SUCCESS;
+            }
+        }
+
+        /* this shard is done, help with the next one */
+        tp->current = (tp->current + 1) % tp->nshards;
+        tp->visited++;
+        tp->seen = -1;
+    }
+
+    *first = tp->ntasks;
+    *count = 0;
+
+    return DALEC_SUCCESS;
+}
+
+/* -- begin weak symbols block -- */
+#if defined(HAVE_PRAGMA_WEAK)
+#  pragma weak DALEC_Taskpool_reset = PDALEC_Taskpool_reset
+#elif defined(HAVE_PRAGMA_HP_SEC_DEF)
+#  pragma _HP_SECONDARY_DEF PDALEC_Taskpool_reset DALEC_Taskpool_reset
+#elif defined(HAVE_PRAGMA_CRI_DUP)
+#  pragma _CRI duplicate DALEC_Taskpool_reset as PDALEC_Taskpool_reset
+#elif defined(HAVE_WEAK_ATTRIBUTE)
+int DALEC_Taskpool_reset(DALEC_Taskpool * tp) __attribute__ ((weak, alias("PDALEC_Taskpool_reset")));
+#else
+#define DALEC_Taskpool_reset PDALEC_Taskpool_reset
+#endif
+/* -- end weak symbols block -- */
+
+/** Put all tasks back into the pool and clear the counts of executed
+  * tasks.  Collective.
+  *
+  * @param[in,out] tp  Task pool
+  * @return            Zero on success
+  */
+int DALEC_Taskpool_reset(DALEC_Taskpool * tp)
+{
+    if (tp == NULL) {
+        DALECI_Error("tp is a null pointer");
+        return DALEC_INPUT_ERROR;
+    }
+
+    /* nobody may still be drawing from the counters */
+    int rc = DALEC_Sync(&(tp->counters));
+    if (rc != DALEC_SUCCESS) return rc;
+
+    return DALECI_Taskpool_zero(tp);
+}
+
+/* -- begin weak symbols block -- */
+#if defined(HAVE_PRAGMA_WEAK)
+#  pragma weak DALEC_Taskpool_report = PDALEC_Taskpool_report
+#elif defined(HAVE_PRAGMA_HP_SEC_DEF)
+#  pragma _HP_SECONDARY_DEF PDALEC_Taskpool_report DALEC_Taskpool_report
+#elif defined(HAVE_PRAGMA_CRI_DUP)
+#  pragma _CRI duplicate DALEC_Taskpool_report as PDALEC_Taskpool_report
+#elif defined(HAVE_WEAK_ATTRIBUTE)
+int DALEC_Taskpool_report(const DALEC_Taskpool * tp, long executed[])
+    __attribute__ ((weak, alias("PDALEC_Taskpool_report")));
+#else
+#define DALEC_Taskpool_report PDALEC_Taskpool_report
+#endif
+/* -- end weak symbols block -- */
+
+/** Gather the number of tasks each rank has taken since the pool was
+  * created or reset.  Collective.
+  *
+  * @param[in]  tp       Task pool
+  * @param[out] executed Number of tasks of each rank, one entry per rank of the pool
+  * @return              Zero on success
+  */
+int DALEC_Taskpool_report(const DALEC_Taskpool * tp, long executed[])
+{
+    int rc; /* MPI return code */
+
+    if (tp == NULL || executed == NULL) {
+        DALECI_Error("tp (%p) or executed (%p) is a null pointer", tp, executed);
+        return DALEC_INPUT_ERROR;
+    }
+
+    rc = MPI_Allgather(&(tp->executed), 1, MPI_LONG, executed, 1, MPI_LONG, tp->counters.comm);
+    DALECI_Check_MPI(__func__, "MPI_Allgather", rc);
+
+    if (DEBUG_CAT_ENABLED(DEBUG_CAT_ARRAY_DIST)) {
+        int np;
+        MPI_Comm_size(tp->counters.comm, &np);
+        long min = executed[0], max = executed[0];
+        for (int i=1; i<np; i++) {
+            if (executed[i] < min) min = executed[i];
+            if (executed[i] > max) max = executed[i];
+        }
+        DALECI_Dbg_print(DEBUG_CAT_ARRAY_DIST, "%ld tasks, min %ld max %ld mean %g per rank\n",
+                         tp->ntasks, min, max, (double)tp->ntasks/np);
+    }
+
+    return DALEC_SUCCESS;
+}
+
+/* -- begin weak symbols block -- */
+#if defined(HAVE_PRAGMA_WEAK)
+#  pragma weak DALEC_Taskpool_destroy = PDALEC_Taskpool_destroy
+#elif defined(HAVE_PRAGMA_HP_SEC_DEF)
+#  pragma _HP_SECONDARY_DEF PDALEC_Taskpool_destroy DALEC_Taskpool_destroy
+#elif defined(HAVE_PRAGMA_CRI_DUP)
+#  pragma _CRI duplicate DALEC_Taskpool_destroy as PDALEC_Taskpool_destroy
+#elif defined(HAVE_WEAK_ATTRIBUTE)
+int DALEC_Taskpool_destroy(DALEC_Taskpool * tp) __attribute__ ((weak, alias("PDALEC_Taskpool_destroy")));
+#else
+#define DALEC_Taskpool_destroy PDALEC_Taskpool_destroy
+#endif
+/* -- end weak symbols block -- */
+
+/** Free a task pool.  Collective.
+  *
+  * @param[in,out] tp  Task pool
+  * @return            Zero on success
+  */
+int DALEC_Taskpool_destroy(DALEC_Taskpool * tp)
+{
+    if (tp == NULL) {
+        DALECI_Error("tp is a null pointer");
+        return DALEC_INPUT_ERROR;
+    }
+    return DALEC_Destroy_array(&(tp->counters));
+}
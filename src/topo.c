@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2014. See COPYRIGHT in top-level directory.
+ */
+
+#include <dalec.h>
+#include <dalec_guts.h>
+#include <debug.h>
+
+/* With DALEC_NODE_GRID set, the ranks of an array are placed on its process
+ * grid node by node: the grid is split into an inter-node grid of boxes and
+ * an intra-node subgrid within each box, and the ranks of a node take the
+ * blocks of one box.  Halo exchanges and GEMM panels between the blocks of a
+ * box then stay on the node.  The placement is carried by the communicator
+ * of the array, whose rank order is the row-major order of the grid as
+ * always, so nothing downstream needs to know.  It needs nodes with the same
+ * number of ranks and a grid with a block for every rank, which then always
+ * has boxes of the size of a node: the node size divides the product of
+ * pedims, so its prime factors can be dealt to the dimensions.  Otherwise
+ * ranks keep their order.  The box with the least surface is used.
+ * DALEC_NODE_RANKS sets the number of consecutive ranks that count as a
+ * node, e.g. a socket, instead of asking MPI. */
+
+/* Exchange with the neighbouring boxes of a box of q blocks per dimension,
+ * as the sum of the areas of its faces between two different boxes. */
+static double DALECI_Node_cost(const DALEC_Array_handle * h, const int q[])
+{
+    double cost = 0;
+    for (int i=0; i<h->ndim; i++) {
+        if (h->pedims[i] == q[i] && !h->periodic[i]) continue;
+        double face = 1;
+        for (int j=0; j<h->ndim; j++) {
+            if (j != i) face *= (double)q[j] * h->dims[j] / h->pedims[j];
+        }
+        cost += face;
+    }
+    return cost;
+}
+
+/* Find the cheapest subgrid q of nsize blocks, q[j] dividing pedims[j],
+ * among those that agree with q on the dimensions before i. */
+static void DALECI_Node_search(const DALEC_Array_handle * h, int i, int rem, int q[],
+                               int best[], double * best_cost)
+{
+    if (i == h->ndim - 1) {
+        if (h->pedims[i] % rem != 0) return;
+        q[i] = rem;
+        const double cost = DALECI_Node_cost(h, q);
+        if (*best_cost < 0 || cost < *best_cost) {
+            *best_cost = cost;
+            for (int j=0; j<h->ndim; j++) best[j] = q[j];
+        }
+        return;
+    }
+    for (int f=1; f<=rem; f++) {
+        if (rem % f != 0 || h->pedims[i] % f != 0) continue;
+        q[i] = f;
+        DALECI_Node_search(h, i+1, rem / f, q, best, best_cost);
+    }
+}
+
+/** Create the communicator of an array, with its ranks placed on the grid
+  * node by node if DALEC_NODE_GRID is set.  Collective.
+  *
+  * @param[in,out] h      Array handle, dims, pedims and periodic are used and comm is set
+  * @param[in]     comm   Communicator from the descriptor
+  * @return               Zero on success
+  */
+int DALECI_Node_comm(DALEC_Array_handle * h, MPI_Comm comm)
+{
+    int rc; /* MPI return code */
+
+    int np, me;
+    MPI_Comm_size(comm, &np);
+    MPI_Comm_rank(comm, &me);
+
+    int grid_size = 1;
+    for (int i=0; i<h->ndim; i++) {
+        grid_size *= h->pedims[i];
+    }
+
+    if (!DALECI_Getenv_bool("DALEC_NODE_GRID", 0) || grid_size != np) {
+        rc = MPI_Comm_dup(comm, &(h->comm));
+        return DALECI_Check_MPI(__func__, "MPI_Comm_dup", rc);
+    }
+
+    /* which node this rank is on, and where on it */
+    int node, local, nsize;
+    const int node_ranks = DALECI_Getenv_int("DALEC_NODE_RANKS", 0);
+    if (node_ranks > 0) {
+        node  = me / node_ranks;
+        local = me % node_ranks;
+        nsize = (np - node * node_ranks < node_ranks) ? np - node * node_ranks : node_ranks;
+    } else {
+        MPI_Comm nodecomm, leaders;
+        rc = MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &nodecomm);
+        DALECI_Check_MPI(__func__, "MPI_Comm_split_type", rc);
+        MPI_Comm_size(nodecomm, &nsize);
+        MPI_Comm_rank(nodecomm, &local);
+
+        /* nodes are numbered by their leaders, in the order of comm */
+        rc = MPI_Comm_split(comm, (local == 0) ? 0 : MPI_UNDEFINED, me, &leaders);
+        DALECI_Check_MPI(__func__, "MPI_Comm_split", rc);
+        if (local == 0) {
+            MPI_Comm_rank(leaders, &node);
+            MPI_Comm_free(&leaders);
+        }
+        rc = MPI_Bcast(&node, 1, MPI_INT, 0, nodecomm);
+        DALECI_Check_MPI(__func__, "MPI_Bcast", rc);
+        MPI_Comm_free(&nodecomm);
+    }
+
+    /* every node must have the same number of ranks */
+    int sizes[2] = { nsize, -nsize };
+    rc = MPI_Allreduce(MPI_IN_PLACE, sizes, 2, MPI_INT, MPI_MAX, comm);
+    DALECI_Check_MPI(__func__, "MPI_Allreduce", rc);
+    const int uniform = (sizes[0] == -sizes[1]) && (nsize > 1) && (nsize < np);
+
+    /* the box of blocks of a node */
+    int q[DALEC_ARRAY_MAX_DIM], box[DALEC_ARRAY_MAX_DIM];
+    double cost = -1;
+    if (uniform) {
+        DALECI_Node_search(h, 0, nsize, q, box, &cost);
+    }
+    if (cost < 0) {
+        DALECI_Dbg_print(DEBUG_CAT_ARRAY_DIST, "ranks keep their order (%d ranks per node)\n", nsize);
+        rc = MPI_Comm_dup(comm, &(h->comm));
+        return DALECI_Check_MPI(__func__, "MPI_Comm_dup", rc);
+    }
+
+    /* block (node coordinate * box + local coordinate) of the grid */
+    int key = 0;
+    for (int i=h->ndim-1, n=node, l=local, stride=1; i>=0; i--) {
+        const int boxes = h->pedims[i] / box[i];
+        key    += ((n % boxes) * box[i] + l % box[i]) * stride;
+        stride *= h->pedims[i];
+        n      /= boxes;
+        l      /= box[i];
+    }
+    for (int i=0; i<h->ndim; i++) {
+        DALECI_Dbg_print(DEBUG_CAT_ARRAY_DIST, "dim %d: pedims = %d, box = %d\n", i, h->pedims[i], box[i]);
+    }
+
+    rc = MPI_Comm_split(comm, 0, key, &(h->comm));
+    return DALECI_Check_MPI(__func__, "MPI_Comm_split", rc);
+}
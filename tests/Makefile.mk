@@ -6,17 +6,68 @@ check_PROGRAMS += tests/test_hello            \
 		  tests/test_assert           \
 		  tests/test_array            \
 		  tests/test_ddb              \
+		  tests/test_patch            \
+		  tests/test_atomic           \
+		  tests/test_taskpool         \
+		  tests/test_scatter          \
+		  tests/test_arrayops         \
+		  tests/test_gemm             \
+		  tests/test_redist           \
+		  tests/test_ghosts           \
+		  tests/test_irreg            \
+		  tests/test_irreg_mismatch   \
+		  tests/test_cyclic           \
+		  tests/test_topology         \
+		  tests/test_cost             \
+		  tests/test_pool             \
+		  tests/test_batch            \
+		  tests/test_resize           \
+		  tests/bench_ddb             \
                   # end
 
 TESTS          += tests/test_hello            \
 		  tests/test_array	      \
 		  tests/test_ddb              \
+		  tests/test_patch            \
+		  tests/test_atomic           \
+		  tests/test_taskpool         \
+		  tests/test_scatter          \
+		  tests/test_arrayops         \
+		  tests/test_gemm             \
+		  tests/test_redist           \
+		  tests/test_ghosts           \
+		  tests/test_irreg            \
+		  tests/test_irreg_mismatch   \
+		  tests/test_cyclic           \
+		  tests/test_topology         \
+		  tests/test_cost             \
+		  tests/test_pool             \
+		  tests/test_batch            \
+		  tests/test_resize           \
                   # end
 
 XFAIL_TESTS    += tests/test_assert           \
+		  tests/test_irreg_mismatch   \
                   # end
 
 tests_test_hello_LDADD = libdalec.la
 tests_test_assert_LDADD = libdalec.la
 tests_test_array_LDADD = libdalec.la
 tests_test_ddb_LDADD = libdalec.la
+tests_bench_ddb_LDADD = libdalec.la
+tests_test_patch_LDADD = libdalec.la
+tests_test_atomic_LDADD = libdalec.la
+tests_test_taskpool_LDADD = libdalec.la
+tests_test_scatter_LDADD = libdalec.la
+tests_test_arrayops_LDADD = libdalec.la
+tests_test_gemm_LDADD = libdalec.la
+tests_test_redist_LDADD = libdalec.la
+tests_test_ghosts_LDADD = libdalec.la
+tests_test_irreg_LDADD = libdalec.la
+tests_test_irreg_mismatch_LDADD = libdalec.la
+tests_test_cyclic_LDADD = libdalec.la
+tests_test_topology_LDADD = libdalec.la
+tests_test_cost_LDADD = libdalec.la
+tests_test_pool_LDADD = libdalec.la
+tests_test_batch_LDADD = libdalec.la
+tests_test_resize_LDADD = libdalec.la
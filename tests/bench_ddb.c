@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2018. See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <mpi.h>
+#include <dalec.h>
+
+void ddb(ssize_t ndims, ssize_t ardims[], ssize_t npes, ssize_t blk[], ssize_t pedims[]);
+void ddb_ex(ssize_t ndims, ssize_t ardims[], ssize_t npes, double threshold, ssize_t blk[], ssize_t pedims[]);
+void ddb_h1(ssize_t ndims, ssize_t ardims[], ssize_t npes, double threshold, ssize_t blk[], ssize_t pedims[]);
+void ddb_h2(ssize_t ndims, ssize_t ardims[], ssize_t npes, double threshold, ssize_t bias, ssize_t blk[], ssize_t pedims[]);
+
+enum { DDB, DDB_H1, DDB_H2, DDB_EX, NHEUR };
+
+static const char * names[NHEUR] = { "ddb", "ddb_h1", "ddb_h2", "ddb_ex" };
+
+/* Time one call of heuristic h, which sets pedims */
+static double run(int h, int ndim, const ssize_t dims[], ssize_t npes, ssize_t pedims[])
+{
+    ssize_t ardims[DALEC_ARRAY_MAX_DIM], blk[DALEC_ARRAY_MAX_DIM];
+    for (int j=0; j<ndim; j++) {
+        ardims[j] = dims[j];
+        blk[j] = (h == DDB) ? 0 : 1;
+    }
+
+    double t0 = MPI_Wtime();
+    switch (h) {
+        case DDB:    ddb(ndim, ardims, npes, blk, pedims);              break;
+        case DDB_H1: ddb_h1(ndim, ardims, npes, 0.1, blk, pedims);      break;
+        case DDB_H2: ddb_h2(ndim, ardims, npes, 0.1, 0, blk, pedims);   break;
+        /* a threshold above any load balance ratio searches everything */
+        case DDB_EX: ddb_ex(ndim, ardims, npes, 1.1, blk, pedims);      break;
+    }
+    return MPI_Wtime() - t0;
+}
+
+int main(int argc, char ** argv)
+{
+    int rank;
+
+    MPI_Init(&argc, &argv);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    /* powers of ten and two, a prime, and numbers with many small factors */
+    const ssize_t npes[] = { 1, 10, 64, 100, 997, 1000, 4096, 10000, 65536, 100000,
+                             262144, 360360, 524288, 720720, 999983, 1000000 };
+    const int nnpes = sizeof(npes) / sizeof(npes[0]);
+    const ssize_t maxpes = (argc>1) ? atol(argv[1]) : 1000000;
+    const ssize_t dim    = (argc>2) ? atol(argv[2]) : 100000;
+
+    if (rank == 0) {
+
+        printf("%8s %4s %8s %12s %12s  %s\n", "npes", "ndim", "name", "first (s)", "cached (s)", "pedims");
+
+        for (int n=0; n<nnpes && npes[n]<=maxpes; n++) {
+            for (int ndim=1; ndim<=DALEC_ARRAY_MAX_DIM; ndim++) {
+
+                /* slightly different extents so that the axes are not interchangeable */
+                ssize_t dims[DALEC_ARRAY_MAX_DIM];
+                for (int j=0; j<ndim; j++) dims[j] = dim + 7*j;
+
+                for (int h=0; h<NHEUR; h++) {
+                    ssize_t pedims[DALEC_ARRAY_MAX_DIM] = {0};
+                    /* ddb_h1 is not cached, so its second call searches again */
+                    double first  = run(h, ndim, dims, npes[n], pedims);
+                    double cached = run(h, ndim, dims, npes[n], pedims);
+
+                    printf("%8zd %4d %8s %12.3e %12.3e  ", npes[n], ndim, names[h], first, cached);
+                    for (int j=0; j<ndim; j++) printf("%zd%s", pedims[j], (j<ndim-1) ? "x" : "\n");
+                }
+            }
+        }
+    }
+
+    MPI_Finalize();
+
+    return 0;
+}
@@ -6,8 +6,45 @@
 #include <mpi.h>
 #include <dalec.h>
 
+/* the local blocks must tile the array exactly */
+static int check_blocks(const DALEC_Array_handle * h)
+{
+    long long local = 1, total = 1;
+    for (int i=0; i<h->ndim; i++) {
+        local *= h->local_dims[i];
+        total *= h->dims[i];
+        if (h->local_dims[i] > 0 && h->local_lo[i] + h->local_dims[i] > h->dims[i]) return 1;
+    }
+    MPI_Allreduce(MPI_IN_PLACE, &local, 1, MPI_LONG_LONG, MPI_SUM, h->comm);
+    int errors = (local != total);
+
+    /* the closed-form lookups must agree with the local block */
+    int me;
+    MPI_Comm_rank(h->comm, &me);
+    size_t lo[DALEC_ARRAY_MAX_DIM], ext[DALEC_ARRAY_MAX_DIM], idx[DALEC_ARRAY_MAX_DIM];
+    DALEC_Distribution(h, me, lo, ext);
+    size_t n = (local > 0) ? 1 : 0;
+    for (int i=0; i<h->ndim; i++) {
+        if (ext[i] != h->local_dims[i] || (ext[i] > 0 && lo[i] != h->local_lo[i])) errors++;
+        n *= ext[i];
+    }
+    for (size_t k=0; k<n; k++) {
+        for (int i=h->ndim-1, r=k; i>=0; i--) {
+            idx[i] = lo[i] + r % ext[i];
+            r /= ext[i];
+        }
+        int owner;
+        size_t offset;
+        DALEC_Locate(h, idx, &owner, &offset);
+        if (owner != me || offset != k) errors++;
+    }
+    return errors;
+}
+
 int main(int argc, char ** argv) {
 
+    int errors = 0;
+
     int rank, nproc;
 
     MPI_Init(&argc, &argv);
@@ -60,8 +97,42 @@ int main(int argc, char ** argv) {
         DALEC_Destroy_array(&h);
     }
 
+    MPI_Barrier(MPI_COMM_WORLD); fflush(stdout); fflush(stderr); MPI_Barrier(MPI_COMM_WORLD);
+
+    if (rank == 0) printf("==========================\n");
+    {
+        DALEC_Array_descriptor d = { .comm = MPI_COMM_WORLD,
+                                     .type = MPI_DOUBLE,
+                                     .ndim = 2,
+                                     .dims = {100,37},
+                                     .blks = {0,0},
+                                     .name = "test array 4" };
+        DALEC_Array_handle h;
+        DALEC_Create_array(&d, &h);
+        errors += check_blocks(&h);
+        DALEC_Destroy_array(&h);
+    }
+
+    MPI_Barrier(MPI_COMM_WORLD); fflush(stdout); fflush(stderr); MPI_Barrier(MPI_COMM_WORLD);
+
+    if (rank == 0) printf("==========================\n");
+    {
+        DALEC_Array_descriptor d = { .comm = MPI_COMM_WORLD,
+                                     .type = MPI_INT,
+                                     .ndim = 4,
+                                     .dims = {9,8,7,6},
+                                     .blks = {0,4,0,0},
+                                     .name = "test array 5" };
+        DALEC_Array_handle h;
+        DALEC_Create_array(&d, &h);
+        errors += check_blocks(&h);
+        DALEC_Destroy_array(&h);
+    }
+
+    if (errors) printf("%d: %d errors\n", rank, errors);
+
     DALEC_Finalize();
     MPI_Finalize();
 
-    return 0;
+    return (errors != 0);
 }
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2014. See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <mpi.h>
+#include <dalec.h>
+
+#define NI 41
+#define NJ 19
+
+int main(int argc, char ** argv)
+{
+    int rank, nproc, errors = 0;
+
+    MPI_Init(&argc, &argv);
+    DALEC_Initialize(MPI_COMM_WORLD);
+
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+
+    if (rank == 0) printf("Starting DALEC array operations test with %d processes\n", nproc);
+
+    /* b has another distribution than a and c */
+    DALEC_Array_descriptor da = { .comm = MPI_COMM_WORLD, .type = MPI_DOUBLE, .ndim = 2, .dims = {NI, NJ}, .name = "test ops a" };
+    DALEC_Array_descriptor db = { .comm = MPI_COMM_WORLD, .type = MPI_DOUBLE, .ndim = 2, .dims = {NI, NJ},
+                                  .blks = {0, 5}, .name = "test ops b" };
+    DALEC_Array_handle a, b, c;
+    DALEC_Create_array(&da, &a);
+    DALEC_Create_array(&db, &b);
+    DALEC_Create_array(&da, &c);
+
+    const size_t lo[2] = {0, 0}, hi[2] = {NI-1, NJ-1}, ld[1] = {NJ};
+    double * buf = malloc(NI*NJ * sizeof(double));
+
+    const double two = 2.0, half = 0.5, three = 3.0;
+    DALEC_Fill(&a, &two);
+    if (rank == 0) {
+        for (size_t k=0; k<NI*NJ; k++) buf[k] = (double)k;
+        DALEC_Put(&b, lo, hi, buf, ld);
+    }
+
+    /* c = 2*a + 0.5*b = 4 + k/2 */
+    DALEC_Add(&two, &a, &half, &b, &c);
+    DALEC_Get(&c, lo, hi, buf, ld);
+    for (size_t k=0; k<NI*NJ; k++) {
+        if (buf[k] != 4.0 + 0.5*k) errors++;
+    }
+
+    double dot = 0, norm = 0;
+    const double n = NI*NJ;
+    DALEC_Dot(&a, &b, &dot);
+    if (dot != n*(n-1)) errors++;
+    DALEC_Norm2(&a, &norm);
+    if (fabs(norm - 2.0*sqrt(n)) > 1e-12*norm) errors++;
+
+    /* a = 3*b, in place on the output */
+    DALEC_Copy(&b, &a);
+    DALEC_Scale(&a, &three);
+    DALEC_Add(&half, &c, &two, &c, &c);
+    DALEC_Get(&a, lo, hi, buf, ld);
+    for (size_t k=0; k<NI*NJ; k++) {
+        if (buf[k] != 3.0*k) errors++;
+    }
+    DALEC_Get(&c, lo, hi, buf, ld);
+    for (size_t k=0; k<NI*NJ; k++) {
+        if (buf[k] != 2.5*(4.0 + 0.5*k)) errors++;
+    }
+
+    free(buf);
+    DALEC_Destroy_array(&c);
+    DALEC_Destroy_array(&b);
+    DALEC_Destroy_array(&a);
+
+    if (errors) printf("%d: %d errors\n", rank, errors);
+
+    DALEC_Finalize();
+    MPI_Finalize();
+
+    return (errors != 0);
+}
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2014. See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <mpi.h>
+#include <dalec.h>
+
+/* owners zero their blocks in place */
+static void zero(const DALEC_Array_handle * h)
+{
+    size_t lo[1] = {h->local_lo[0]}, hi[1] = {h->local_lo[0] + h->local_dims[0] - 1};
+    if (h->local_dims[0] > 0) {
+        char * ptr;
+        int type_size;
+        MPI_Type_size(h->type, &type_size);
+        DALEC_Access(h, lo, hi, (void**)&ptr, NULL);
+        for (size_t k=0; k<h->local_dims[0]*type_size; k++) ptr[k] = 0;
+        DALEC_Release_update(h, lo, hi);
+    }
+    DALEC_Sync(h);
+}
+
+static int test(MPI_Datatype type, int nproc)
+{
+    const int n = 100;
+    DALEC_Array_descriptor d = { .comm = MPI_COMM_WORLD, .type = type, .ndim = 1, .dims = {2*nproc}, .name = "test atomic" };
+
+    DALEC_Array_handle h;
+    DALEC_Create_array(&d, &h);
+    zero(&h);
+
+    /* every rank draws from the same counter, which is owned by the last rank */
+    const size_t counter[1] = {2*nproc-1};
+    long sum = 0;
+    for (int i=0; i<n; i++) {
+        long v;
+        DALEC_Read_inc(&h, counter, 1, &v);
+        sum += v;
+    }
+    MPI_Allreduce(MPI_IN_PLACE, &sum, 1, MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
+
+    /* each value was handed out exactly once */
+    const long total = (long)n*nproc;
+    int errors = (sum != total*(total-1)/2);
+
+    DALEC_Sync(&h);
+    long v;
+    DALEC_Read_inc(&h, counter, 0, &v);
+    if (v != total) errors++;
+
+    DALEC_Destroy_array(&h);
+
+    return errors;
+}
+
+static int test_cas(int nproc)
+{
+    const int n = 10;
+    DALEC_Array_descriptor d = { .comm = MPI_COMM_WORLD, .type = MPI_LONG_LONG, .ndim = 1, .dims = {nproc}, .name = "test cas" };
+
+    DALEC_Array_handle h;
+    DALEC_Create_array(&d, &h);
+    zero(&h);
+
+    /* increment element 0 with a compare-and-swap loop */
+    const size_t idx[1] = {0};
+    for (int i=0; i<n; i++) {
+        long long old, seen;
+        DALEC_Fetch_and_op(&h, idx, NULL, &old, MPI_NO_OP);
+        for (;;) {
+            long long next = old+1;
+            DALEC_Compare_and_swap(&h, idx, &next, &old, &seen);
+            if (seen == old) break;
+            old = seen;
+        }
+    }
+    DALEC_Sync(&h);
+
+    long long v, one = 1;
+    DALEC_Fetch_and_op(&h, idx, &one, &v, MPI_SUM);
+    int errors = (v < (long long)n*nproc || v > (long long)n*nproc + nproc-1);
+
+    DALEC_Destroy_array(&h);
+
+    return errors;
+}
+
+int main(int argc, char ** argv)
+{
+    int rank, nproc, errors = 0;
+
+    MPI_Init(&argc, &argv);
+    DALEC_Initialize(MPI_COMM_WORLD);
+
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+
+    if (rank == 0) printf("Starting DALEC atomic test with %d processes\n", nproc);
+
+    errors += test(MPI_LONG, nproc);
+    errors += test(MPI_INT, nproc);
+    errors += test_cas(nproc);
+
+    if (errors) printf("%d: %d errors\n", rank, errors);
+
+    DALEC_Finalize();
+    MPI_Finalize();
+
+    return (errors != 0);
+}
@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2014. See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <mpi.h>
+#include <dalec.h>
+
+#define NARRAYS 6
+
+/* Count the elements of the local block that do not hold v, in place, so
+ * that an array that spills into the slot of another is caught. */
+static int local_is(const DALEC_Array_handle * a, double v)
+{
+    if (a->coords[0] < 0) return 0;
+
+    size_t n = 1;
+    for (int i=0; i<a->ndim; i++) n *= a->local_dims[i];
+
+    int errors = 0;
+    const double * base = a->base;
+    for (size_t k=0; k<n; k++) {
+        size_t rest = k, off = 0, l[DALEC_ARRAY_MAX_DIM];
+        for (int i=a->ndim-1; i>=0; i--) {
+            l[i] = rest % a->local_dims[i];
+            rest /= a->local_dims[i];
+        }
+        for (int i=0; i<a->ndim; i++) {
+            off = off * (a->local_dims[i] + 2*a->ghosts[i]) + a->ghosts[i] + l[i];
+        }
+        errors += (base[off] != v);
+    }
+    return errors;
+}
+
+/* Get the last element, which the last owner holds, through the slot of the
+ * array in the window. */
+static int last_is(DALEC_Array_handle * a, double v)
+{
+    size_t idx[DALEC_ARRAY_MAX_DIM], ld[DALEC_ARRAY_MAX_DIM];
+    for (int i=0; i<a->ndim; i++) {
+        idx[i] = a->dims[i] - 1;
+        ld[i] = 1;
+    }
+    double out = -1.0;
+    DALEC_Get(a, idx, idx, &out, ld);
+    return (out != v);
+}
+
+int main(int argc, char ** argv)
+{
+    int rank, nproc, errors = 0;
+
+    MPI_Init(&argc, &argv);
+    DALEC_Initialize(MPI_COMM_WORLD);
+
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+
+    if (rank == 0) printf("Starting DALEC batched creation test with %d processes\n", nproc);
+
+    /* arrays of different shapes, ghosts and distributions in one window */
+    DALEC_Array_descriptor d[NARRAYS] = {
+        { .comm = MPI_COMM_WORLD, .type = MPI_DOUBLE, .ndim = 2, .dims = {20, 30}, .name = "test batch 0" },
+        { .comm = MPI_COMM_WORLD, .type = MPI_DOUBLE, .ndim = 1, .dims = {17} },
+        { .comm = MPI_COMM_WORLD, .type = MPI_DOUBLE, .ndim = 3, .dims = {5, 6, 7}, .ghosts = {1, 1, 1} },
+        { .comm = MPI_COMM_WORLD, .type = MPI_DOUBLE, .ndim = 2, .dims = {13, 9}, .blks = {2, 3}, .cyclic = 1 },
+        { .comm = MPI_COMM_WORLD, .type = MPI_DOUBLE, .ndim = 2, .dims = {1, 3} },
+        { .comm = MPI_COMM_WORLD, .type = MPI_DOUBLE, .ndim = 2, .dims = {64, 8}, .ghosts = {2, 0}, .periodic = {1, 0} },
+    };
+    DALEC_Array_handle h[NARRAYS];
+    DALEC_Create_arrays(NARRAYS, d, h);
+
+    for (int k=1; k<NARRAYS; k++) {
+        if (h[k].win != h[0].win) {
+            printf("%d: array %d has a window of its own\n", rank, k);
+            errors++;
+        }
+    }
+
+    /* every array keeps to its slot, with all of them written at once, and
+     * is found there by the other ranks */
+    for (int k=0; k<NARRAYS; k++) {
+        DALEC_Fill(&h[k], &(double){k});
+    }
+    for (int k=0; k<NARRAYS; k++) {
+        DALEC_Sync(&h[k]);
+    }
+    for (int k=0; k<NARRAYS; k++) {
+        errors += local_is(&h[k], k);
+        errors += last_is(&h[k], k);
+    }
+    for (int k=0; k<NARRAYS; k++) {
+        DALEC_Sync(&h[k]);
+    }
+
+    /* the ghost cells of one array do not spill into the next */
+    DALEC_Update_ghosts(&h[2], 1);
+    errors += local_is(&h[2], 2);
+    errors += local_is(&h[3], 3);
+    DALEC_Sync(&h[2]);
+
+    /* atomics and accumulates land in the right slot */
+    const size_t idx[2] = {0, 2};
+    DALEC_Fill(&h[4], &(double){0});
+    DALEC_Sync(&h[4]);
+    DALEC_Fetch_and_op(&h[4], idx, &(double){1}, &(double){0}, MPI_SUM);
+    DALEC_Sync(&h[4]);
+    double sum;
+    const size_t lo[2] = {0, 2}, hi[2] = {0, 2}, ld[1] = {1};
+    DALEC_Get(&h[4], lo, hi, &sum, ld);
+    if (sum != (double)nproc) {
+        printf("%d: fetch-and-op sum is %g instead of %d\n", rank, sum, nproc);
+        errors++;
+    }
+    errors += local_is(&h[3], 3);
+
+    /* arrays go one at a time, in any order, and the others keep working */
+    DALEC_Destroy_array(&h[2]);
+    DALEC_Destroy_array(&h[0]);
+    errors += last_is(&h[1], 1);
+    errors += last_is(&h[5], 5);
+    DALEC_Sync(&h[1]);
+    DALEC_Sync(&h[5]);
+    DALEC_Destroy_array(&h[1]);
+    DALEC_Destroy_array(&h[3]);
+    DALEC_Destroy_array(&h[4]);
+    DALEC_Destroy_array(&h[5]);
+
+    /* arrays of different element sizes get a window for each size */
+    DALEC_Array_descriptor m[3] = {
+        { .comm = MPI_COMM_WORLD, .type = MPI_INT,    .ndim = 1, .dims = {40} },
+        { .comm = MPI_COMM_WORLD, .type = MPI_DOUBLE, .ndim = 2, .dims = {10, 10} },
+        { .comm = MPI_COMM_WORLD, .type = MPI_FLOAT,  .ndim = 1, .dims = {25} },
+    };
+    DALEC_Array_handle g[3];
+    DALEC_Create_arrays(3, m, g);
+    if (g[0].win != g[2].win || g[0].win == g[1].win) {
+        printf("%d: arrays of 4-byte elements do not share a window apart from the others\n", rank);
+        errors++;
+    }
+    for (int k=0; k<3; k++) {
+        DALEC_Fill(&g[k], (k == 0) ? (void*)&(int){7} : (k == 1) ? (void*)&(double){7} : (void*)&(float){7});
+    }
+    for (int k=0; k<3; k++) {
+        DALEC_Sync(&g[k]);
+    }
+    int ibuf[40];
+    float fbuf[25];
+    const size_t ilo = 0, ihi = 39, flo = 0, fhi = 24;
+    DALEC_Get(&g[0], &ilo, &ihi, ibuf, NULL);
+    DALEC_Get(&g[2], &flo, &fhi, fbuf, NULL);
+    for (int j=0; j<40; j++) if (ibuf[j] != 7) errors++;
+    for (int j=0; j<25; j++) if (fbuf[j] != 7) errors++;
+    for (int k=0; k<3; k++) {
+        DALEC_Sync(&g[k]);
+        DALEC_Destroy_array(&g[k]);
+    }
+
+    if (errors) printf("%d: %d errors\n", rank, errors);
+
+    DALEC_Finalize();
+    MPI_Finalize();
+
+    return (errors != 0);
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2014. See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <mpi.h>
+#include <dalec.h>
+
+/* The process grid of an array. */
+static void grid(DALEC_Array_descriptor * d, int pedims[])
+{
+    DALEC_Array_handle a;
+    DALEC_Create_array(d, &a);
+    for (int i=0; i<a.ndim; i++) {
+        pedims[i] = a.pedims[i];
+    }
+    DALEC_Destroy_array(&a);
+}
+
+int main(int argc, char ** argv)
+{
+    int rank, nproc, errors = 0;
+
+    MPI_Init(&argc, &argv);
+    DALEC_Initialize(MPI_COMM_WORLD);
+
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+
+    if (rank == 0) printf("Starting DALEC grid cost model test with %d processes\n", nproc);
+
+    int pedims[DALEC_ARRAY_MAX_DIM];
+
+    /* row gathers are served by one owner when rows are not split */
+    DALEC_Array_descriptor rows = { .comm = MPI_COMM_WORLD, .type = MPI_INT, .ndim = 2, .dims = {64, 64},
+                                    .cost = { .owners = 1, .patch = {1, 0} }, .name = "test cost rows" };
+    grid(&rows, pedims);
+    if (pedims[0] != nproc || pedims[1] != 1) {
+        printf("%d: row gathers got a %dx%d grid\n", rank, pedims[0], pedims[1]);
+        errors++;
+    }
+
+    /* and column gathers when columns are not */
+    DALEC_Array_descriptor cols = rows;
+    cols.cost.patch[0] = 0;
+    cols.cost.patch[1] = 1;
+    cols.name = "test cost columns";
+    grid(&cols, pedims);
+    if (pedims[0] != 1 || pedims[1] != nproc) {
+        printf("%d: column gathers got a %dx%d grid\n", rank, pedims[0], pedims[1]);
+        errors++;
+    }
+
+    /* SUMMA panels are smallest on the squarest grid */
+    DALEC_Array_descriptor gemm = { .comm = MPI_COMM_WORLD, .type = MPI_INT, .ndim = 2, .dims = {48, 48},
+                                    .cost = { .panel = 1 }, .name = "test cost panels" };
+    grid(&gemm, pedims);
+    int square = 1;
+    while ((square+1) * (square+1) <= nproc) square++;
+    if (pedims[0] * pedims[1] != nproc || (square * square == nproc && pedims[0] != square)) {
+        printf("%d: panels got a %dx%d grid\n", rank, pedims[0], pedims[1]);
+        errors++;
+    }
+
+    /* a stencil on a long thin array is cut across its long dimension,
+     * without periodic halos along the short one */
+    DALEC_Array_descriptor stencil = { .comm = MPI_COMM_WORLD, .type = MPI_INT, .ndim = 2, .dims = {8*nproc, 6},
+                                       .ghosts = {1, 1}, .cost = { .halo = 1 }, .name = "test cost halo" };
+    grid(&stencil, pedims);
+    if (pedims[0] != nproc || pedims[1] != 1) {
+        printf("%d: the stencil got a %dx%d grid\n", rank, pedims[0], pedims[1]);
+        errors++;
+    }
+
+    /* a fixed block size keeps its number of blocks */
+    DALEC_Array_descriptor fixed = { .comm = MPI_COMM_WORLD, .type = MPI_INT, .ndim = 3, .dims = {12, 20, 30},
+                                     .blks = {0, 10, 0}, .cost = { .imbalance = 1, .halo = 0.01 },
+                                     .name = "test cost fixed" };
+    DALEC_Array_descriptor plain = fixed;
+    plain.cost.imbalance = 0;
+    plain.cost.halo = 0;
+    int plain_pedims[DALEC_ARRAY_MAX_DIM];
+    grid(&fixed, pedims);
+    grid(&plain, plain_pedims);
+    if (pedims[1] != plain_pedims[1] ||
+        pedims[0] * pedims[2] != plain_pedims[0] * plain_pedims[2]) {
+        printf("%d: a fixed block size got a %dx%dx%d grid instead of %dx%dx%d\n", rank,
+               pedims[0], pedims[1], pedims[2], plain_pedims[0], plain_pedims[1], plain_pedims[2]);
+        errors++;
+    }
+
+    if (errors) printf("%d: %d errors\n", rank, errors);
+
+    DALEC_Finalize();
+    MPI_Finalize();
+
+    return (errors != 0);
+}
@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2014. See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <mpi.h>
+#include <dalec.h>
+
+#define NI 23
+#define NJ 17
+#define MB 3
+#define NB 2
+
+/* ScaLAPACK's NUMROC with source 0 */
+static size_t numroc(size_t n, size_t nb, int c, int p)
+{
+    const size_t full = n / nb, extra = full % p;
+    return (full / p) * nb + ((size_t)c < extra ? nb : (size_t)c == extra ? n % nb : 0);
+}
+
+/* global index of local index l of grid coordinate c */
+static size_t global_index(size_t l, size_t nb, int c, int p)
+{
+    return ((l / nb) * p + c) * nb + l % nb;
+}
+
+int main(int argc, char ** argv)
+{
+    int rank, nproc, errors = 0;
+
+    MPI_Init(&argc, &argv);
+    DALEC_Initialize(MPI_COMM_WORLD);
+
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+
+    if (rank == 0) printf("Starting DALEC block-cyclic test with %d processes\n", nproc);
+
+    DALEC_Array_descriptor da = { .comm = MPI_COMM_WORLD, .type = MPI_DOUBLE, .ndim = 2, .dims = {NI, NJ},
+                                  .blks = {MB, NB}, .cyclic = 1, .name = "test cyclic a" };
+    DALEC_Array_descriptor db = { .comm = MPI_COMM_WORLD, .type = MPI_DOUBLE, .ndim = 2, .dims = {NI, NJ}, .name = "test cyclic b" };
+    DALEC_Array_handle a, b;
+    DALEC_Create_array(&da, &a);
+    DALEC_Create_array(&db, &b);
+
+    const int p0 = a.pedims[0], p1 = a.pedims[1];
+
+    /* the blocks are dealt round-robin */
+    for (size_t i=0; i<NI; i++) {
+        for (size_t j=0; j<NJ; j++) {
+            const size_t idx[2] = {i, j};
+            int owner;
+            size_t offset;
+            DALEC_Locate(&a, idx, &owner, &offset);
+            const int ci = (int)((i / MB) % p0), cj = (int)((j / NB) % p1);
+            const size_t li = (i / MB / p0) * MB + i % MB, lj = (j / NB / p1) * NB + j % NB;
+            if (owner != ci * p1 + cj || offset != li * numroc(NJ, NB, cj, p1) + lj) {
+                printf("%d: (%zu,%zu) at %d+%zu, expected %d+%zu\n", rank, i, j, owner, offset,
+                       ci * p1 + cj, li * numroc(NJ, NB, cj, p1) + lj);
+                errors++;
+            }
+        }
+    }
+
+    double * buf = malloc(NI*NJ * sizeof(double));
+    const size_t lo[2] = {0, 0}, hi[2] = {NI-1, NJ-1}, ld[1] = {NJ};
+    for (size_t k=0; k<NI*NJ; k++) buf[k] = (double)k;
+    if (rank == 0) DALEC_Put(&a, lo, hi, buf, ld);
+    DALEC_Sync(&a);
+
+    /* the local block is ScaLAPACK's local matrix */
+    size_t llo[2], ext[2];
+    DALEC_Distribution(&a, rank, llo, ext);
+    if (ext[0] > 0 && ext[1] > 0) {
+        const int ci = rank / p1, cj = rank % p1;
+        if (ext[0] != numroc(NI, MB, ci, p0) || ext[1] != numroc(NJ, NB, cj, p1)) errors++;
+
+        double * local;
+        size_t lld[1];
+        const size_t flo[2] = {llo[0], llo[1]}, fhi[2] = {llo[0], llo[1]};
+        DALEC_Access(&a, flo, fhi, (void**)&local, lld);
+        for (size_t li=0; li<ext[0]; li++) {
+            for (size_t lj=0; lj<ext[1]; lj++) {
+                const size_t i = global_index(li, MB, ci, p0), j = global_index(lj, NB, cj, p1);
+                if (local[li*lld[0] + lj] != (double)(i*NJ + j)) errors++;
+            }
+        }
+        DALEC_Release(&a, flo, fhi);
+
+        int desc[9];
+        DALEC_Descinit(&a, 7, desc);
+        if (desc[0] != 1 || desc[1] != 7 || desc[2] != NJ || desc[3] != NI || desc[4] != NB || desc[5] != MB ||
+            desc[6] != 0 || desc[7] != 0 || desc[8] != (int)lld[0]) {
+            errors++;
+        }
+    }
+
+    /* a patch that spans several blocks of every owner, with a wider buffer */
+    const size_t plo[2] = {1, 2}, phi[2] = {20, 14}, pld[1] = {16};
+    double * patch = calloc((phi[0]-plo[0]+1) * pld[0], sizeof(double));
+    DALEC_Get(&a, plo, phi, patch, pld);
+    for (size_t i=plo[0]; i<=phi[0]; i++) {
+        for (size_t j=plo[1]; j<=phi[1]; j++) {
+            if (patch[(i-plo[0])*pld[0] + (j-plo[1])] != (double)(i*NJ + j)) errors++;
+        }
+    }
+
+    DALEC_Sync(&a);
+
+    /* every rank adds the patch back, nonblocking */
+    DALEC_Request req;
+    DALEC_NbAcc(&a, plo, phi, patch, pld, NULL, &req);
+    DALEC_Wait(&req);
+    DALEC_Sync(&a);
+    DALEC_Get(&a, lo, hi, buf, ld);
+    for (size_t i=0; i<NI; i++) {
+        for (size_t j=0; j<NJ; j++) {
+            const int in = (i >= plo[0] && i <= phi[0] && j >= plo[1] && j <= phi[1]);
+            if (buf[i*NJ + j] != (in ? nproc + 1.0 : 1.0) * (i*NJ + j)) errors++;
+        }
+    }
+    free(patch);
+    DALEC_Sync(&a);
+
+    /* to and from a regular distribution, and operations across them */
+    const double one = 1.0, minus = -1.0;
+    DALEC_Redistribute(&a, &b);
+    DALEC_Scale(&a, &minus);
+    DALEC_Add(&one, &a, &one, &b, &a);
+    double norm = 1;
+    DALEC_Norm2(&a, &norm);
+    if (norm != 0) errors++;
+    DALEC_Copy(&b, &a);
+    DALEC_Fill(&b, &one);
+    DALEC_Redistribute(&a, &b);
+    DALEC_Get(&b, lo, hi, buf, ld);
+    for (size_t i=0; i<NI; i++) {
+        for (size_t j=0; j<NJ; j++) {
+            const int in = (i >= plo[0] && i <= phi[0] && j >= plo[1] && j <= phi[1]);
+            if (buf[i*NJ + j] != (in ? nproc + 1.0 : 1.0) * (i*NJ + j)) errors++;
+        }
+    }
+    DALEC_Sync(&b);
+
+    DALEC_Destroy_array(&a);
+    DALEC_Destroy_array(&b);
+
+    /* 3D, with one block per coordinate along the middle dimension */
+    {
+        DALEC_Array_descriptor dc = { .comm = MPI_COMM_WORLD, .type = MPI_INT, .ndim = 3, .dims = {7, 5, 9},
+                                      .blks = {2, 0, 4}, .cyclic = 1, .name = "test cyclic c" };
+        DALEC_Array_handle c;
+        DALEC_Create_array(&dc, &c);
+
+        int * in = malloc(7*5*9 * sizeof(int)), * out = malloc(7*5*9 * sizeof(int));
+        for (int k=0; k<7*5*9; k++) in[k] = k;
+        const size_t clo[3] = {0, 0, 0}, chi[3] = {6, 4, 8}, cld[2] = {5, 9};
+        if (rank == nproc-1) DALEC_Put(&c, clo, chi, in, cld);
+        DALEC_Sync(&c);
+        DALEC_Get(&c, clo, chi, out, cld);
+        for (int k=0; k<7*5*9; k++) {
+            if (out[k] != k) errors++;
+        }
+        free(in);
+        free(out);
+        DALEC_Destroy_array(&c);
+    }
+
+    free(buf);
+
+    if (errors) printf("%d: %d errors\n", rank, errors);
+
+    DALEC_Finalize();
+    MPI_Finalize();
+
+    return (errors != 0);
+}
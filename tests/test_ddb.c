@@ -11,10 +11,11 @@ void ddb(ssize_t ndims, ssize_t ardims[], ssize_t npes, ssize_t blk[], ssize_t p
 void ddb_ex(ssize_t ndims, ssize_t ardims[], ssize_t npes, double threshold, ssize_t blk[], ssize_t pedims[]);
 void ddb_h1(ssize_t ndims, ssize_t ardims[], ssize_t npes, double threshold, ssize_t blk[], ssize_t pedims[]);
 void ddb_h2(ssize_t ndims, ssize_t ardims[], ssize_t npes, double threshold, ssize_t bias, ssize_t blk[], ssize_t pedims[]);
+void dd_cache_stats(size_t * hits, size_t * misses);
 
 int main(int argc, char ** argv)
 {
-    int rank, nproc;
+    int rank, nproc, errors = 0;
 
     MPI_Init(&argc, &argv);
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
@@ -45,9 +46,37 @@ int main(int argc, char ** argv)
             for (int j=0; j<ndim; j++) printf("blks[%d] = %zd\n", j, blks[j]);
             for (int j=0; j<ndim; j++) printf("outs[%d] = %zd\n", j, outs[j]);
         }
+
+        /* the second search with the same arguments comes from the cache and agrees with the first */
+        for (int i=1; i<=DALEC_ARRAY_MAX_DIM; i++) {
+
+            int ndim = i;
+
+            ssize_t first[DALEC_ARRAY_MAX_DIM] = {0}, firstblks[DALEC_ARRAY_MAX_DIM] = {0};
+            ssize_t second[DALEC_ARRAY_MAX_DIM] = {0}, secondblks[DALEC_ARRAY_MAX_DIM] = {0};
+            size_t hits, misses, hits2, misses2;
+
+            ssize_t dims[DALEC_ARRAY_MAX_DIM] = {0};
+            for (int j=0; j<ndim; j++) dims[j] = dim + j;
+            for (int j=0; j<ndim; j++) firstblks[j] = (j % 2) ? blk : 0;
+            ddb(ndim, dims, np, firstblks, first);
+
+            dd_cache_stats(&hits, &misses);
+            for (int j=0; j<ndim; j++) dims[j] = dim + j;
+            for (int j=0; j<ndim; j++) secondblks[j] = (j % 2) ? blk : 0;
+            ddb(ndim, dims, np, secondblks, second);
+            dd_cache_stats(&hits2, &misses2);
+
+            if (hits2 != hits + 1 || misses2 != misses) errors++;
+            for (int j=0; j<ndim; j++) {
+                if (first[j] != second[j] || firstblks[j] != secondblks[j]) errors++;
+            }
+        }
     }
 
+    if (errors) printf("%d: %d errors\n", rank, errors);
+
     MPI_Finalize();
 
-    return 0;
+    return (errors != 0);
 }
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2014. See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <mpi.h>
+#include <dalec.h>
+
+/* multiply with small integer entries, so the result is exact */
+static int check_gemm(size_t m, size_t n, size_t k, size_t bblk)
+{
+    int errors = 0;
+
+    DALEC_Array_descriptor da = { .comm = MPI_COMM_WORLD, .type = MPI_DOUBLE, .ndim = 2, .dims = {m, k}, .name = "test gemm a" };
+    DALEC_Array_descriptor db = { .comm = MPI_COMM_WORLD, .type = MPI_DOUBLE, .ndim = 2, .dims = {k, n},
+                                  .blks = {bblk, 0}, .name = "test gemm b" };
+    DALEC_Array_descriptor dc = { .comm = MPI_COMM_WORLD, .type = MPI_DOUBLE, .ndim = 2, .dims = {m, n}, .name = "test gemm c" };
+    DALEC_Array_handle a, b, c;
+    DALEC_Create_array(&da, &a);
+    DALEC_Create_array(&db, &b);
+    DALEC_Create_array(&dc, &c);
+
+    double * pa = malloc(m*k * sizeof(double));
+    double * pb = malloc(k*n * sizeof(double));
+    double * pc = malloc(m*n * sizeof(double));
+    for (size_t i=0; i<m*k; i++) pa[i] = (double)((i*5) % 7) - 3.0;
+    for (size_t i=0; i<k*n; i++) pb[i] = (double)((i*3) % 5) - 2.0;
+
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    if (rank == 0) {
+        const size_t lo[2] = {0, 0};
+        const size_t ahi[2] = {m-1, k-1}, ald[1] = {k};
+        const size_t bhi[2] = {k-1, n-1}, bld[1] = {n};
+        DALEC_Put(&a, lo, ahi, pa, ald);
+        DALEC_Put(&b, lo, bhi, pb, bld);
+    }
+    const double one = 1.0, alpha = 2.0, beta = -1.0;
+    DALEC_Fill(&c, &one);
+
+    DALEC_Gemm(&alpha, &a, &b, &beta, &c);
+
+    const size_t lo[2] = {0, 0}, hi[2] = {m-1, n-1}, ld[1] = {n};
+    DALEC_Get(&c, lo, hi, pc, ld);
+    for (size_t i=0; i<m; i++) {
+        for (size_t j=0; j<n; j++) {
+            double sum = -1.0;
+            for (size_t p=0; p<k; p++) {
+                sum += alpha * pa[i*k+p] * pb[p*n+j];
+            }
+            if (pc[i*n+j] != sum) errors++;
+        }
+    }
+    DALEC_Sync(&c);
+
+    free(pc);
+    free(pb);
+    free(pa);
+    DALEC_Destroy_array(&c);
+    DALEC_Destroy_array(&b);
+    DALEC_Destroy_array(&a);
+
+    return errors;
+}
+
+int main(int argc, char ** argv)
+{
+    int rank, nproc, errors = 0;
+
+    MPI_Init(&argc, &argv);
+    DALEC_Initialize(MPI_COMM_WORLD);
+
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+
+    if (rank == 0) printf("Starting DALEC gemm test with %d processes\n", nproc);
+
+    /* narrow panels, so that several are in flight */
+    setenv("DALEC_GEMM_PANEL", "5", 1);
+
+    errors += check_gemm(48, 48, 48, 0);
+    errors += check_gemm(37, 23, 29, 4);
+    errors += check_gemm(3, 50, 2, 0);
+
+    if (errors) printf("%d: %d errors\n", rank, errors);
+
+    DALEC_Finalize();
+    MPI_Finalize();
+
+    return (errors != 0);
+}
@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2014. See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <mpi.h>
+#include <dalec.h>
+
+/* Check every ghost cell of the local block against the global row-major
+ * index of the element it mirrors, or against -1 if it must not have been
+ * written.  Interior cells are checked too. */
+static int check_ghosts(const DALEC_Array_handle * h, int corners)
+{
+    int errors = 0;
+    const int ndim = h->ndim;
+
+    size_t n = 1, lo[DALEC_ARRAY_MAX_DIM] = {0}, hi[DALEC_ARRAY_MAX_DIM] = {0}, ld[DALEC_ARRAY_MAX_DIM];
+    for (int i=0; i<ndim; i++) {
+        n *= h->local_dims[i] + 2*h->ghosts[i];
+        lo[i] = h->local_lo[i];
+        hi[i] = h->local_lo[i] + h->local_dims[i] - 1;
+        if (h->local_dims[i] == 0) return 0;
+    }
+    double * ptr;
+    DALEC_Access(h, lo, hi, (void**)&ptr, ld);
+
+    for (size_t k=0; k<n; k++) {
+        long a[DALEC_ARRAY_MAX_DIM];
+        long offset = 0, stride = 1;
+        for (int i=ndim-1, r=k; i>=0; i--) {
+            const long p = h->local_dims[i] + 2*h->ghosts[i];
+            a[i] = (long)(r % p) - (long)h->ghosts[i];
+            r /= p;
+            offset += a[i] * stride;
+            stride *= p;
+        }
+        int outside = 0, valid = 1;
+        double expected = 0;
+        for (int i=0; i<ndim; i++) {
+            long x = (long)lo[i] + a[i];
+            outside += (a[i] < 0 || a[i] >= (long)h->local_dims[i]);
+            if (x < 0 || x >= (long)h->dims[i]) {
+                if (h->periodic[i]) x = (x + h->dims[i]) % h->dims[i];
+                else valid = 0;
+            }
+            expected = expected * h->dims[i] + x;
+        }
+        if (!valid || (!corners && outside > 1)) expected = -1;
+        if (ptr[offset] != expected) errors++;
+    }
+
+    DALEC_Release(h, lo, hi);
+    return errors;
+}
+
+/* put -1 in every ghost cell */
+static void clear_ghosts(const DALEC_Array_handle * h)
+{
+    const int ndim = h->ndim;
+    size_t n = 1, lo[DALEC_ARRAY_MAX_DIM] = {0}, hi[DALEC_ARRAY_MAX_DIM] = {0}, ld[DALEC_ARRAY_MAX_DIM];
+    for (int i=0; i<ndim; i++) {
+        n *= h->local_dims[i] + 2*h->ghosts[i];
+        lo[i] = h->local_lo[i];
+        hi[i] = h->local_lo[i] + h->local_dims[i] - 1;
+        if (h->local_dims[i] == 0) return;
+    }
+    double * ptr;
+    DALEC_Access(h, lo, hi, (void**)&ptr, ld);
+    for (size_t k=0; k<n; k++) {
+        int outside = 0;
+        for (int i=ndim-1, r=k; i>=0; i--) {
+            const long p = h->local_dims[i] + 2*h->ghosts[i];
+            const long a = (long)(r % p) - (long)h->ghosts[i];
+            r /= p;
+            outside |= (a < 0 || a >= (long)h->local_dims[i]);
+        }
+        if (outside) ((double*)h->base)[k] = -1.0;
+    }
+    DALEC_Release_update(h, lo, hi);
+}
+
+static int test_array(const DALEC_Array_descriptor * d)
+{
+    int errors = 0, rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    DALEC_Array_handle h;
+    DALEC_Create_array(d, &h);
+
+    size_t n = 1, lo[DALEC_ARRAY_MAX_DIM] = {0}, hi[DALEC_ARRAY_MAX_DIM], ld[DALEC_ARRAY_MAX_DIM];
+    for (int i=0; i<d->ndim; i++) {
+        n *= d->dims[i];
+        hi[i] = d->dims[i]-1;
+        if (i>0) ld[i-1] = d->dims[i];
+    }
+    double * buf = malloc(n * sizeof(double));
+    for (size_t k=0; k<n; k++) buf[k] = (double)k;
+    if (rank == 0) DALEC_Put(&h, lo, hi, buf, ld);
+    DALEC_Sync(&h);
+
+    clear_ghosts(&h);
+    DALEC_Update_ghosts(&h, 0);
+    errors += check_ghosts(&h, 0);
+
+    clear_ghosts(&h);
+    DALEC_Update_ghosts(&h, 1);
+    errors += check_ghosts(&h, 1);
+    DALEC_Update_ghosts(&h, 1);
+    errors += check_ghosts(&h, 1);
+
+    /* remote access and whole-array operations see only the interior */
+    DALEC_Get(&h, lo, hi, buf, ld);
+    double sumsq = 0, norm = 0;
+    for (size_t k=0; k<n; k++) {
+        if (buf[k] != (double)k) errors++;
+        sumsq += (double)k * (double)k;
+    }
+    DALEC_Sync(&h);
+    DALEC_Norm2(&h, &norm);
+    if (fabs(norm - sqrt(sumsq)) > 1e-12*norm) errors++;
+
+    free(buf);
+    DALEC_Destroy_array(&h);
+    return errors;
+}
+
+int main(int argc, char ** argv)
+{
+    int rank, nproc, errors = 0;
+
+    MPI_Init(&argc, &argv);
+    DALEC_Initialize(MPI_COMM_WORLD);
+
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+
+    if (rank == 0) printf("Starting DALEC ghost cell test with %d processes\n", nproc);
+
+    {
+        DALEC_Array_descriptor d = { .comm = MPI_COMM_WORLD, .type = MPI_DOUBLE, .ndim = 2, .dims = {20, 14},
+                                     .ghosts = {2, 1}, .periodic = {1, 0}, .name = "test ghosts 2d" };
+        errors += test_array(&d);
+    }
+    {
+        /* blocks narrower than the ghosts, so halos span several owners */
+        DALEC_Array_descriptor d = { .comm = MPI_COMM_WORLD, .type = MPI_DOUBLE, .ndim = 3, .dims = {9, 8, 7},
+                                     .blks = {2, 0, 0}, .ghosts = {3, 1, 2}, .periodic = {1, 1, 0}, .name = "test ghosts 3d" };
+        errors += test_array(&d);
+    }
+    {
+        DALEC_Array_descriptor d = { .comm = MPI_COMM_WORLD, .type = MPI_DOUBLE, .ndim = 1, .dims = {5},
+                                     .ghosts = {5}, .periodic = {1}, .name = "test ghosts 1d" };
+        errors += test_array(&d);
+    }
+
+    if (errors) printf("%d: %d errors\n", rank, errors);
+
+    DALEC_Finalize();
+    MPI_Finalize();
+
+    return (errors != 0);
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2014. See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <mpi.h>
+#include <dalec.h>
+
+#define NI 30
+#define NJ 22
+
+/* boundaries of the columns, with an empty first block and, on 6 or more
+ * processes, empty trailing blocks */
+static size_t col_start(int c)
+{
+    size_t s = 4*(c/2) + c*c/3;
+    return (s < NJ) ? s : NJ;
+}
+
+int main(int argc, char ** argv)
+{
+    int rank, nproc, errors = 0;
+
+    MPI_Init(&argc, &argv);
+    DALEC_Initialize(MPI_COMM_WORLD);
+
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+
+    if (rank == 0) printf("Starting DALEC irregular distribution test with %d processes\n", nproc);
+
+    /* with an odd number of processes, the last rank owns nothing */
+    const int nblock[2] = { (nproc > 1) ? 2 : 1, (nproc > 1) ? nproc/2 : 1 };
+    size_t * map = malloc((nblock[0] + nblock[1]) * sizeof(size_t));
+    map[0] = 0;
+    if (nblock[0] > 1) map[1] = 7;
+    for (int c=0; c<nblock[1]; c++) map[nblock[0]+c] = col_start(c);
+
+    DALEC_Array_descriptor da = { .comm = MPI_COMM_WORLD, .type = MPI_DOUBLE, .ndim = 2, .dims = {NI, NJ}, .name = "test irreg a" };
+    DALEC_Array_descriptor db = { .comm = MPI_COMM_WORLD, .type = MPI_DOUBLE, .ndim = 2, .dims = {NI, NJ}, .name = "test irreg b" };
+    DALEC_Array_handle a, b;
+    DALEC_Create_array_irreg(&da, nblock, map, &a);
+    DALEC_Create_array(&db, &b);
+
+    /* every element belongs to the block that the map says */
+    for (size_t i=0; i<NI; i++) {
+        for (size_t j=0; j<NJ; j++) {
+            int ci = (nblock[0] > 1 && i >= map[1]) ? 1 : 0;
+            int cj = 0;
+            for (int c=0; c<nblock[1]; c++) {
+                if (map[nblock[0]+c] <= j) cj = c;
+            }
+            const size_t idx[2] = {i, j};
+            int owner;
+            DALEC_Locate(&a, idx, &owner, NULL);
+            if (owner != ci * nblock[1] + cj) {
+                printf("%d: (%zu,%zu) owned by %d, expected %d\n", rank, i, j, owner, ci * nblock[1] + cj);
+                errors++;
+            }
+            size_t lo[2], ext[2];
+            DALEC_Distribution(&a, owner, lo, ext);
+            if (i < lo[0] || i >= lo[0] + ext[0] || j < lo[1] || j >= lo[1] + ext[1]) {
+                printf("%d: (%zu,%zu) is not in the block of its owner %d\n", rank, i, j, owner);
+                errors++;
+            }
+        }
+    }
+
+    double * buf = malloc(NI*NJ * sizeof(double));
+    const size_t lo[2] = {0, 0}, hi[2] = {NI-1, NJ-1}, ld[1] = {NJ};
+    for (size_t k=0; k<NI*NJ; k++) buf[k] = (double)k;
+    if (rank == 0) DALEC_Put(&a, lo, hi, buf, ld);
+    DALEC_Sync(&a);
+
+    /* a patch across several irregular blocks */
+    const size_t plo[2] = {5, 3}, phi[2] = {12, 17}, pld[1] = {phi[1]-plo[1]+1};
+    double * patch = malloc((phi[0]-plo[0]+1) * pld[0] * sizeof(double));
+    DALEC_Get(&a, plo, phi, patch, pld);
+    for (size_t i=plo[0]; i<=phi[0]; i++) {
+        for (size_t j=plo[1]; j<=phi[1]; j++) {
+            if (patch[(i-plo[0])*pld[0] + (j-plo[1])] != (double)(i*NJ + j)) errors++;
+        }
+    }
+    free(patch);
+    DALEC_Sync(&a);
+
+    /* and back to a regular distribution */
+    const double two = 2.0;
+    DALEC_Scale(&a, &two);
+    DALEC_Redistribute(&a, &b);
+    DALEC_Get(&b, lo, hi, buf, ld);
+    for (size_t k=0; k<NI*NJ; k++) {
+        if (buf[k] != 2.0*k) errors++;
+    }
+    DALEC_Sync(&b);
+
+    DALEC_Destroy_array(&a);
+    DALEC_Destroy_array(&b);
+    free(buf);
+    free(map);
+
+    if (errors) printf("%d: %d errors\n", rank, errors);
+
+    DALEC_Finalize();
+    MPI_Finalize();
+
+    return (errors != 0);
+}
@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2014. See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <mpi.h>
+#include <dalec.h>
+
+/* Rank 0 disagrees with the others about the block boundaries, which must
+ * abort even though the two maps have the same sum of weighted boundaries.
+ * A single process cannot disagree with itself, so it fails outright. */
+
+int main(int argc, char ** argv)
+{
+    int rank, nproc;
+
+    MPI_Init(&argc, &argv);
+    DALEC_Initialize(MPI_COMM_WORLD);
+
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+
+    if (nproc > 1) {
+        const int nblock[1] = { (nproc < 3) ? nproc : 3 };
+        const size_t map0[3] = {0, 4, 5}, map1[3] = {0, 1, 7};
+        DALEC_Array_descriptor d = { .comm = MPI_COMM_WORLD, .type = MPI_DOUBLE, .ndim = 1, .dims = {10},
+                                     .name = "test irreg mismatch" };
+        DALEC_Array_handle h;
+        DALEC_Create_array_irreg(&d, nblock, (rank == 0) ? map0 : map1, &h);
+        printf("%d: disagreeing maps were accepted\n", rank);
+        DALEC_Destroy_array(&h);
+    }
+
+    DALEC_Finalize();
+    MPI_Finalize();
+
+    return 1;
+}
@@ -0,0 +1,281 @@
+/*
+ * Copyright (C) 2014. See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <mpi.h>
+#include <dalec.h>
+
+static double value(const size_t dims[], const size_t idx[], int ndim)
+{
+    double v = 0;
+    for (int i=0; i<ndim; i++) v = v*dims[i] + idx[i];
+    return v;
+}
+
+/* compare a row-major patch buffer against the expected contents */
+static int check(const DALEC_Array_handle * h, const size_t lo[], const size_t hi[], const double * buf, double shift)
+{
+    const int ndim = h->ndim;
+    size_t idx[DALEC_ARRAY_MAX_DIM], n = 1;
+    for (int i=0; i<ndim; i++) n *= hi[i]-lo[i]+1;
+    int errors = 0;
+    for (size_t k=0; k<n; k++) {
+        for (int i=ndim-1, r=k; i>=0; i--) {
+            const size_t e = hi[i]-lo[i]+1;
+            idx[i] = lo[i] + r%e;
+            r /= e;
+        }
+        if (buf[k] != value(h->dims, idx, ndim) + shift) errors++;
+    }
+    return errors;
+}
+
+static int test(int ndim, const size_t dims[], int rank, int nproc)
+{
+    DALEC_Array_descriptor d = { .comm = MPI_COMM_WORLD, .type = MPI_DOUBLE, .ndim = ndim, .name = "test patch" };
+    for (int i=0; i<ndim; i++) d.dims[i] = dims[i];
+
+    DALEC_Array_handle h;
+    DALEC_Create_array(&d, &h);
+
+    size_t lo[DALEC_ARRAY_MAX_DIM] = {0}, hi[DALEC_ARRAY_MAX_DIM] = {0}, ld[DALEC_ARRAY_MAX_DIM] = {0};
+    size_t n = 1;
+    for (int i=0; i<ndim; i++) {
+        hi[i] = dims[i]-1;
+        n *= dims[i];
+        if (i>0) ld[i-1] = dims[i];
+    }
+    double * buf = malloc(n * sizeof(double));
+
+    /* rank 0 writes the whole array */
+    if (rank == 0) {
+        for (size_t k=0; k<n; k++) buf[k] = k;
+        DALEC_Put(&h, lo, hi, buf, ld);
+    }
+    DALEC_Sync(&h);
+
+    /* everyone reads a patch that crosses block bounds */
+    for (int i=0; i<ndim; i++) {
+        lo[i] = (rank % 2) ? 1 : 0;
+        hi[i] = dims[i]-1 - ((rank % 3) ? 1 : 0);
+        if (i>0) ld[i-1] = hi[i]-lo[i]+1;
+    }
+    DALEC_Get(&h, lo, hi, buf, ld);
+    int errors = check(&h, lo, hi, buf, 0.0);
+
+    /* everyone adds one to the whole array */
+    DALEC_Sync(&h);
+    for (int i=0; i<ndim; i++) {
+        lo[i] = 0;
+        hi[i] = dims[i]-1;
+        if (i>0) ld[i-1] = dims[i];
+    }
+    const double two = 2.0;
+    for (size_t k=0; k<n; k++) buf[k] = 0.5;
+    DALEC_Acc(&h, lo, hi, buf, ld, &two);
+    DALEC_Sync(&h);
+
+    DALEC_Get(&h, lo, hi, buf, ld);
+    errors += check(&h, lo, hi, buf, (double)nproc);
+
+    free(buf);
+    DALEC_Destroy_array(&h);
+
+    return errors;
+}
+
+/* the same as test but with nonblocking operations */
+static int test_nb(int ndim, const size_t dims[], int rank, int nproc)
+{
+    DALEC_Array_descriptor d = { .comm = MPI_COMM_WORLD, .type = MPI_DOUBLE, .ndim = ndim, .name = "test nb patch" };
+    for (int i=0; i<ndim; i++) d.dims[i] = dims[i];
+
+    DALEC_Array_handle h;
+    DALEC_Create_array(&d, &h);
+
+    size_t lo[DALEC_ARRAY_MAX_DIM] = {0}, hi[DALEC_ARRAY_MAX_DIM] = {0}, ld[DALEC_ARRAY_MAX_DIM] = {0};
+    size_t n = 1;
+    for (int i=0; i<ndim; i++) {
+        hi[i] = dims[i]-1;
+        n *= dims[i];
+        if (i>0) ld[i-1] = dims[i];
+    }
+    double * buf = malloc(n * sizeof(double));
+    DALEC_Request req[2];
+
+    if (rank == 0) {
+        for (size_t k=0; k<n; k++) buf[k] = k;
+        DALEC_NbPut(&h, lo, hi, buf, ld, &req[0]);
+        DALEC_Wait(&req[0]);
+    }
+    DALEC_Sync(&h);
+
+    /* fetch the two halves of the leading dimension at the same time */
+    size_t lo1[DALEC_ARRAY_MAX_DIM], hi0[DALEC_ARRAY_MAX_DIM];
+    for (int i=0; i<ndim; i++) {
+        lo1[i] = lo[i];
+        hi0[i] = hi[i];
+    }
+    hi0[0] = dims[0]/2 - 1;
+    lo1[0] = dims[0]/2;
+    double * buf1 = buf + (n / dims[0]) * (dims[0]/2);
+    DALEC_NbGet(&h, lo, hi0, buf, ld, &req[0]);
+    DALEC_NbGet(&h, lo1, hi, buf1, ld, &req[1]);
+    DALEC_Waitall(2, req);
+    int errors = check(&h, lo, hi, buf, 0.0);
+
+    DALEC_Sync(&h);
+    const double four = 4.0;
+    for (size_t k=0; k<n; k++) buf[k] = 0.25;
+    DALEC_NbAcc(&h, lo, hi, buf, ld, &four, &req[0]);
+    int flag = 0;
+    while (!flag) DALEC_Test(&req[0], &flag);
+    DALEC_Sync(&h);
+
+    DALEC_Get(&h, lo, hi, buf, ld);
+    errors += check(&h, lo, hi, buf, (double)nproc);
+
+    free(buf);
+    DALEC_Destroy_array(&h);
+
+    return errors;
+}
+
+/* many tiny updates with aggregation enabled */
+static int test_aggregate(int rank, int nproc)
+{
+    const size_t n = 1000;
+    DALEC_Array_descriptor d = { .comm = MPI_COMM_WORLD, .type = MPI_DOUBLE, .ndim = 1, .dims = {n}, .name = "test aggregate" };
+
+    DALEC_Array_handle h;
+    DALEC_Create_array(&d, &h);
+    DALEC_Aggregate_begin(&h);
+
+    /* each rank puts its rank into the elements it is responsible for,
+     * then accumulates one into every element, three at a time */
+    double * buf = malloc(n * sizeof(double));
+    for (size_t k=rank; k<n; k+=nproc) {
+        const size_t lo[1] = {k}, hi[1] = {k};
+        const double v = rank;
+        DALEC_Put(&h, lo, hi, &v, NULL);
+    }
+    DALEC_Aggregate_flush(&h);
+    DALEC_Sync(&h);
+
+    for (size_t k=0; k<3; k++) buf[k] = 1.0;
+    for (size_t k=0; k<n; k++) {
+        const size_t j = (k*13 + rank) % (n-2);
+        const size_t lo[1] = {j}, hi[1] = {j+2};
+        DALEC_Acc(&h, lo, hi, buf, NULL, NULL);
+    }
+    DALEC_Aggregate_end(&h);
+    DALEC_Sync(&h);
+
+    const size_t lo[1] = {0}, hi[1] = {n-1};
+    DALEC_Get(&h, lo, hi, buf, NULL);
+
+    int errors = 0;
+    for (size_t k=0; k<n; k++) {
+        double expected = k % nproc;
+        for (int r=0; r<nproc; r++) {
+            for (size_t m=0; m<n; m++) {
+                const size_t j = (m*13 + r) % (n-2);
+                if (j <= k && k <= j+2) expected += 1.0;
+            }
+        }
+        if (buf[k] != expected) errors++;
+    }
+
+    free(buf);
+    DALEC_Destroy_array(&h);
+
+    return errors;
+}
+
+/* owners fill their blocks in place and everyone reads them back */
+static int test_access(void)
+{
+    const size_t dims[2] = {19, 11};
+    DALEC_Array_descriptor d = { .comm = MPI_COMM_WORLD, .type = MPI_DOUBLE, .ndim = 2, .dims = {19, 11}, .name = "test access" };
+
+    DALEC_Array_handle h;
+    DALEC_Create_array(&d, &h);
+
+    int errors = 0;
+    size_t lo[2], hi[2], ld[1];
+    int owner = 1;
+    for (int i=0; i<2; i++) {
+        if (h.local_dims[i] == 0) owner = 0;
+        lo[i] = h.local_lo[i];
+        hi[i] = h.local_lo[i] + h.local_dims[i] - 1;
+    }
+    if (owner) {
+        double * ptr = NULL;
+        if (DALEC_Access(&h, lo, hi, (void**)&ptr, ld) != 0) errors++;
+        for (size_t i=lo[0]; i<=hi[0]; i++) {
+            for (size_t j=lo[1]; j<=hi[1]; j++) {
+                const size_t idx[2] = {i, j};
+                ptr[(i-lo[0])*ld[0] + (j-lo[1])] = value(dims, idx, 2);
+            }
+        }
+        if (DALEC_Release_update(&h, lo, hi) != 0) errors++;
+    }
+    DALEC_Sync(&h);
+
+    lo[0] = lo[1] = 0;
+    hi[0] = dims[0]-1;
+    hi[1] = dims[1]-1;
+    ld[0] = dims[1];
+    double * buf = malloc(dims[0] * dims[1] * sizeof(double));
+    DALEC_Get(&h, lo, hi, buf, ld);
+    errors += check(&h, lo, hi, buf, 0.0);
+
+    free(buf);
+    DALEC_Destroy_array(&h);
+
+    return errors;
+}
+
+int main(int argc, char ** argv)
+{
+    int rank, nproc, errors = 0;
+
+    MPI_Init(&argc, &argv);
+    DALEC_Initialize(MPI_COMM_WORLD);
+
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+
+    if (rank == 0) printf("Starting DALEC patch test with %d processes\n", nproc);
+
+    /* the second pass keeps the ranks of a node out of shared memory, so
+     * that their patches and aggregated updates travel by RMA as well */
+    for (int pass=0; pass<2; pass++) {
+        if (pass == 1) setenv("DALEC_SHM", "0", 1);
+        {
+            const size_t dims[1] = {101};
+            errors += test(1, dims, rank, nproc);
+        }
+        {
+            const size_t dims[2] = {23, 17};
+            errors += test(2, dims, rank, nproc);
+        }
+        {
+            const size_t dims[3] = {9, 7, 5};
+            errors += test(3, dims, rank, nproc);
+            errors += test_nb(3, dims, rank, nproc);
+        }
+        errors += test_aggregate(rank, nproc);
+        errors += test_access();
+    }
+    unsetenv("DALEC_SHM");
+
+    if (errors) printf("%d: %d errors\n", rank, errors);
+
+    DALEC_Finalize();
+    MPI_Finalize();
+
+    return (errors != 0);
+}
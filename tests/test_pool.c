@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2014. See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <mpi.h>
+#include <dalec.h>
+
+/* Fill an array in place and get its first and last elements, which are
+ * owned by different ranks, back through the window, so that a reused
+ * window is locked and addressed as the new array. */
+static int check(DALEC_Array_handle * a, double v)
+{
+    int errors = 0;
+
+    DALEC_Fill(a, &v);
+    DALEC_Sync(a);
+    size_t idx[2][DALEC_ARRAY_MAX_DIM] = {{0}}, ld[DALEC_ARRAY_MAX_DIM];
+    for (int i=0; i<a->ndim; i++) {
+        idx[1][i] = a->dims[i] - 1;
+        ld[i] = 1;
+    }
+    for (int j=0; j<2; j++) {
+        double out = -1.0;
+        DALEC_Get(a, idx[j], idx[j], &out, ld);
+        if (out != v) errors++;
+    }
+    DALEC_Sync(a);
+    return errors;
+}
+
+static int owns(const DALEC_Array_handle * a)
+{
+    size_t n = 1;
+    for (int i=0; i<a->ndim; i++) n *= a->local_dims[i];
+    return n > 0;
+}
+
+int main(int argc, char ** argv)
+{
+    int rank, nproc, errors = 0;
+
+    MPI_Init(&argc, &argv);
+    DALEC_Initialize(MPI_COMM_WORLD);
+
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+
+    if (rank == 0) printf("Starting DALEC window pool test with %d processes\n", nproc);
+
+    DALEC_Array_descriptor d = { .comm = MPI_COMM_WORLD, .type = MPI_DOUBLE, .ndim = 2, .dims = {40, 30},
+                                 .name = "test pool" };
+
+    /* a loop over temporaries of the same shape gets the same window back */
+    void * base = NULL;
+    for (int iter=0; iter<4; iter++) {
+        DALEC_Array_handle a;
+        DALEC_Create_array(&d, &a);
+        if (iter > 0 && owns(&a) && a.base != base) {
+            printf("%d: iteration %d did not reuse the window\n", rank, iter);
+            errors++;
+        }
+        base = a.base;
+        errors += check(&a, 1000.0 * iter);
+        DALEC_Destroy_array(&a);
+    }
+
+    /* a much smaller array needs a window of its own, while the pooled one
+     * is still allocated */
+    DALEC_Array_descriptor small = d;
+    small.dims[0] = 8;
+    small.dims[1] = 6;
+    small.name = "test pool small";
+    DALEC_Array_handle s;
+    DALEC_Create_array(&small, &s);
+    if (owns(&s) && s.base == base) {
+        printf("%d: a small array reused a large window\n", rank);
+        errors++;
+    }
+    errors += check(&s, 0.5);
+
+    /* live arrays never share a window */
+    DALEC_Array_handle a, b;
+    DALEC_Create_array(&d, &a);
+    DALEC_Create_array(&d, &b);
+    if (owns(&a) && a.base == b.base) {
+        printf("%d: two live arrays share a window\n", rank);
+        errors++;
+    }
+    errors += check(&a, 1.0);
+    errors += check(&b, 2.0);
+    DALEC_Destroy_array(&a);
+    DALEC_Destroy_array(&b);
+    DALEC_Destroy_array(&s);
+
+    /* arrays over a subcommunicator keep to its windows */
+    MPI_Comm half;
+    MPI_Comm_split(MPI_COMM_WORLD, rank % 2, rank, &half);
+    DALEC_Array_descriptor dh = d;
+    dh.comm = half;
+    dh.name = "test pool half";
+    for (int iter=0; iter<2; iter++) {
+        DALEC_Array_handle h;
+        DALEC_Create_array(&dh, &h);
+        errors += check(&h, 4.0 + iter);
+        DALEC_Destroy_array(&h);
+    }
+    DALEC_Pool_trim(half);
+    MPI_Comm_free(&half);
+
+    /* a trimmed pool allocates afresh, and a pool of no bytes keeps nothing */
+    DALEC_Pool_trim(MPI_COMM_WORLD);
+    setenv("DALEC_WINDOW_POOL_BYTES", "0", 1);
+    for (int iter=0; iter<2; iter++) {
+        DALEC_Array_handle c;
+        DALEC_Create_array(&d, &c);
+        errors += check(&c, 3.0 + iter);
+        DALEC_Destroy_array(&c);
+    }
+    unsetenv("DALEC_WINDOW_POOL_BYTES");
+
+    if (errors) printf("%d: %d errors\n", rank, errors);
+
+    DALEC_Finalize();
+    MPI_Finalize();
+
+    return (errors != 0);
+}
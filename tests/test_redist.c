@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2014. See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <mpi.h>
+#include <dalec.h>
+
+#define NI 30
+#define NJ 22
+
+static int check(const DALEC_Array_handle * h, double factor)
+{
+    int errors = 0;
+    double * buf = malloc(NI*NJ * sizeof(double));
+    const size_t lo[2] = {0, 0}, hi[2] = {NI-1, NJ-1}, ld[1] = {NJ};
+    DALEC_Get(h, lo, hi, buf, ld);
+    for (size_t k=0; k<NI*NJ; k++) {
+        if (buf[k] != factor*k) errors++;
+    }
+    free(buf);
+    DALEC_Sync(h);
+    return errors;
+}
+
+int main(int argc, char ** argv)
+{
+    int rank, nproc, errors = 0;
+
+    MPI_Init(&argc, &argv);
+    DALEC_Initialize(MPI_COMM_WORLD);
+
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+
+    if (rank == 0) printf("Starting DALEC redistribution test with %d processes\n", nproc);
+
+    DALEC_Array_descriptor da = { .comm = MPI_COMM_WORLD, .type = MPI_DOUBLE, .ndim = 2, .dims = {NI, NJ}, .name = "test redist a" };
+    DALEC_Array_descriptor db = { .comm = MPI_COMM_WORLD, .type = MPI_DOUBLE, .ndim = 2, .dims = {NI, NJ},
+                                  .blks = {0, 4}, .name = "test redist b" };
+    DALEC_Array_handle a, b;
+    DALEC_Create_array(&da, &a);
+    DALEC_Create_array(&db, &b);
+
+    double * buf = malloc(NI*NJ * sizeof(double));
+    const size_t lo[2] = {0, 0}, hi[2] = {NI-1, NJ-1}, ld[1] = {NJ};
+    for (size_t k=0; k<NI*NJ; k++) buf[k] = (double)k;
+    if (rank == 0) DALEC_Put(&a, lo, hi, buf, ld);
+
+    /* a schedule is reused after the source changes */
+    DALEC_Redistribution r;
+    DALEC_Redistribute_plan(&a, &b, &r);
+    DALEC_Redistribute_exec(&a, &b, &r);
+    errors += check(&b, 1.0);
+    const double one = 1.0, two = 2.0;
+    DALEC_Add(&one, &a, &one, &a, &a);
+    DALEC_Redistribute_exec(&a, &b, &r);
+    DALEC_Redistribute_free(&r);
+    DALEC_Scale(&b, &two);
+    errors += check(&b, 4.0);
+
+    /* shrink onto the even ranks and back */
+    MPI_Comm half;
+    MPI_Comm_split(MPI_COMM_WORLD, rank % 2, rank, &half);
+    DALEC_Array_handle c, * pc = NULL;
+    if (rank % 2 == 0) {
+        DALEC_Array_descriptor dc = { .comm = half, .type = MPI_DOUBLE, .ndim = 2, .dims = {NI, NJ}, .name = "test redist c" };
+        DALEC_Create_array(&dc, &c);
+        pc = &c;
+    }
+    DALEC_Fill(&a, &one);
+    DALEC_Redistribute(&b, pc);
+    DALEC_Redistribute(pc, &a);
+
+    errors += check(&a, 4.0);
+
+    if (pc != NULL) DALEC_Destroy_array(pc);
+    MPI_Comm_free(&half);
+    free(buf);
+    DALEC_Destroy_array(&b);
+    DALEC_Destroy_array(&a);
+
+    if (errors) printf("%d: %d errors\n", rank, errors);
+
+    DALEC_Finalize();
+    MPI_Finalize();
+
+    return (errors != 0);
+}
@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2014. See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <mpi.h>
+#include <dalec.h>
+
+/* Element (i,j) of every 2-d array in this test. */
+static double value(size_t i, size_t j)
+{
+    return 1000.0 * i + j;
+}
+
+/* Write, or with check count the mismatches of, the local elements of a 2-d
+ * array in place.  Writing skips the elements inside old, so that they stay
+ * as the resize left them; checking covers only those. */
+static int local_values(DALEC_Array_handle * a, const size_t old[2], int check)
+{
+    if (a->local_dims[0] == 0 || a->local_dims[1] == 0) return 0;
+
+    int errors = 0;
+    double * base = a->base;
+    const size_t row = a->local_dims[1] + 2*a->ghosts[1];
+    for (size_t i=0; i<a->local_dims[0]; i++) {
+        for (size_t j=0; j<a->local_dims[1]; j++) {
+            const size_t gi = a->local_lo[0] + i, gj = a->local_lo[1] + j;
+            const int inside = (gi < old[0] && gj < old[1]);
+            double * e = &base[(i + a->ghosts[0]) * row + a->ghosts[1] + j];
+            if (check) {
+                errors += (inside && *e != value(gi, gj));
+            } else if (!inside) {
+                *e = value(gi, gj);
+            }
+        }
+    }
+    return errors;
+}
+
+int main(int argc, char ** argv)
+{
+    int rank, nproc, errors = 0;
+
+    MPI_Init(&argc, &argv);
+    DALEC_Initialize(MPI_COMM_WORLD);
+
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+
+    if (rank == 0) printf("Starting DALEC resize test with %d processes\n", nproc);
+
+    DALEC_Array_descriptor d = { .comm = MPI_COMM_WORLD, .type = MPI_DOUBLE, .ndim = 2, .dims = {20, 30},
+                                 .ghosts = {1, 1}, .dynamic = 1, .name = "test resize" };
+    DALEC_Array_handle a;
+    DALEC_Create_array(&d, &a);
+
+    const size_t none[2] = {0, 0}, dims[2] = {20, 30};
+    local_values(&a, none, 0);
+    DALEC_Sync(&a);
+
+    /* growing keeps the old elements, and the new ones can be written */
+    const size_t big[2] = {50, 70};
+    DALEC_Resize_array(&a, big);
+    if (a.dims[0] != 50 || a.dims[1] != 70) {
+        printf("%d: dims are %zu x %zu after growing\n", rank, a.dims[0], a.dims[1]);
+        errors++;
+    }
+    errors += local_values(&a, dims, 1);
+    local_values(&a, dims, 0);
+    DALEC_Sync(&a);
+    errors += local_values(&a, big, 1);
+
+    /* ghost cells follow the new blocks */
+    DALEC_Update_ghosts(&a, 1);
+    if (a.local_dims[0] > 0 && a.local_dims[1] > 0) {
+        const double * base = a.base;
+        const size_t row = a.local_dims[1] + 2;
+        for (size_t i=0; i<a.local_dims[0]; i++) {
+            const size_t gi = a.local_lo[0] + i;
+            if (a.local_lo[1] > 0 && base[(i+1)*row] != value(gi, a.local_lo[1]-1)) errors++;
+            if (a.local_lo[1] + a.local_dims[1] < 70 && base[(i+1)*row + row-1] != value(gi, a.local_lo[1]+a.local_dims[1])) errors++;
+        }
+    }
+    DALEC_Sync(&a);
+
+    /* shrinking keeps what is left */
+    const size_t small[2] = {7, 11};
+    DALEC_Resize_array(&a, small);
+    errors += local_values(&a, small, 1);
+
+    /* and a loop of small steps keeps everything */
+    for (size_t k=8; k<=40; k+=4) {
+        const size_t step[2] = {k, 11}, kept[2] = {k-4, 11};
+        DALEC_Resize_array(&a, step);
+        errors += local_values(&a, kept, 1);
+        local_values(&a, kept, 0);
+        DALEC_Sync(&a);
+    }
+    errors += local_values(&a, (const size_t[2]){40, 11}, 1);
+    DALEC_Destroy_array(&a);
+
+    /* a dynamic array among the arrays of a batch gets a window of its own */
+    DALEC_Array_descriptor m[2] = {
+        { .comm = MPI_COMM_WORLD, .type = MPI_DOUBLE, .ndim = 1, .dims = {17}, .dynamic = 1 },
+        { .comm = MPI_COMM_WORLD, .type = MPI_DOUBLE, .ndim = 1, .dims = {23} },
+    };
+    DALEC_Array_handle g[2];
+    DALEC_Create_arrays(2, m, g);
+    if (g[0].win == g[1].win) {
+        printf("%d: a dynamic array shares a window\n", rank);
+        errors++;
+    }
+    DALEC_Fill(&g[0], &(double){3});
+    DALEC_Fill(&g[1], &(double){4});
+    DALEC_Sync(&g[0]);
+    DALEC_Sync(&g[1]);
+    const size_t n = 100;
+    DALEC_Resize_array(&g[0], &n);
+    const size_t glo = 0, ghi = 16;
+    double buf[23];
+    DALEC_Get(&g[0], &glo, &ghi, buf, NULL);
+    for (int j=0; j<17; j++) if (buf[j] != 3) errors++;
+    const size_t ghi1 = 22;
+    DALEC_Get(&g[1], &glo, &ghi1, buf, NULL);
+    for (int j=0; j<23; j++) if (buf[j] != 4) errors++;
+    DALEC_Sync(&g[0]);
+    DALEC_Sync(&g[1]);
+    DALEC_Destroy_array(&g[0]);
+    DALEC_Destroy_array(&g[1]);
+
+    if (errors) printf("%d: %d errors\n", rank, errors);
+
+    DALEC_Finalize();
+    MPI_Finalize();
+
+    return (errors != 0);
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2014. See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <mpi.h>
+#include <dalec.h>
+
+#define NI 37
+#define NJ 23
+
+/* the same pseudo-random element list on every rank */
+static size_t pick(size_t k, int seed, int i)
+{
+    const size_t x = (k * 2654435761u + seed * 40503u + i * 977u) % 1000003u;
+    return (i == 0) ? x % NI : (x / NI) % NJ;
+}
+
+int main(int argc, char ** argv)
+{
+    int rank, nproc, errors = 0;
+
+    MPI_Init(&argc, &argv);
+    DALEC_Initialize(MPI_COMM_WORLD);
+
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+
+    if (rank == 0) printf("Starting DALEC scatter test with %d processes\n", nproc);
+
+    DALEC_Array_descriptor d = { .comm = MPI_COMM_WORLD, .type = MPI_DOUBLE, .ndim = 2, .dims = {NI, NJ}, .name = "test scatter" };
+    DALEC_Array_handle h;
+    DALEC_Create_array(&d, &h);
+
+    const size_t n = 3*NI*NJ;
+    size_t * subs = malloc(2*n * sizeof(size_t));
+    double * buf = malloc(n * sizeof(double));
+    double * mine = calloc(NI*NJ, sizeof(double));
+
+    /* every rank writes the element values for the rows congruent to its rank,
+     * each element three times with only the last value right */
+    size_t m = 0;
+    for (int r=0; r<3; r++) {
+        for (size_t i=rank; i<NI; i+=nproc) {
+            for (size_t j=0; j<NJ; j++) {
+                subs[2*m] = i;
+                subs[2*m+1] = (j*7 + r) % NJ;
+                buf[m] = (r == 2) ? (double)(subs[2*m]*NJ + subs[2*m+1]) : -1.0;
+                m++;
+            }
+        }
+    }
+    DALEC_Scatter(&h, m, subs, buf);
+    DALEC_Sync(&h);
+
+    /* read everything back in a random order with repeats */
+    for (size_t k=0; k<n; k++) {
+        subs[2*k]   = pick(k, rank, 0);
+        subs[2*k+1] = pick(k, rank, 1);
+    }
+    DALEC_Gather(&h, n, subs, buf);
+    for (size_t k=0; k<n; k++) {
+        if (buf[k] != (double)(subs[2*k]*NJ + subs[2*k+1])) errors++;
+    }
+    DALEC_Sync(&h);
+
+    /* everyone adds alpha times one to the same random list */
+    const double alpha = 0.5;
+    for (size_t k=0; k<n; k++) {
+        subs[2*k]   = pick(k, 17, 0);
+        subs[2*k+1] = pick(k, 17, 1);
+        buf[k] = 1.0;
+        mine[subs[2*k]*NJ + subs[2*k+1]] += 0.5 * nproc;
+    }
+    DALEC_Scatter_acc(&h, n, subs, buf, &alpha);
+    DALEC_Sync(&h);
+
+    const size_t lo[2] = {0, 0}, hi[2] = {NI-1, NJ-1}, ld[1] = {NJ};
+    DALEC_Get(&h, lo, hi, buf, ld);
+    for (size_t k=0; k<NI*NJ; k++) {
+        if (buf[k] != (double)k + mine[k]) errors++;
+    }
+
+    free(mine);
+    free(buf);
+    free(subs);
+    DALEC_Destroy_array(&h);
+
+    if (errors) printf("%d: %d errors\n", rank, errors);
+
+    DALEC_Finalize();
+    MPI_Finalize();
+
+    return (errors != 0);
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2014. See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <mpi.h>
+#include <dalec.h>
+
+/* every task must be handed out exactly once */
+static int drain(DALEC_Taskpool * tp, long ntasks, int nproc)
+{
+    int * seen = calloc(ntasks > 0 ? ntasks : 1, sizeof(int));
+    long first, count;
+    for (;;) {
+        DALEC_Taskpool_next(tp, &first, &count);
+        if (count == 0) break;
+        for (long t=first; t<first+count; t++) seen[t]++;
+    }
+    MPI_Allreduce(MPI_IN_PLACE, seen, (int)ntasks, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+
+    int errors = 0;
+    for (long t=0; t<ntasks; t++) {
+        if (seen[t] != 1) errors++;
+    }
+
+    long * executed = malloc(nproc * sizeof(long));
+    DALEC_Taskpool_report(tp, executed);
+    long total = 0;
+    for (int i=0; i<nproc; i++) total += executed[i];
+    if (total != ntasks) errors++;
+
+    free(executed);
+    free(seen);
+    return errors;
+}
+
+int main(int argc, char ** argv)
+{
+    int rank, nproc, errors = 0;
+
+    MPI_Init(&argc, &argv);
+    DALEC_Initialize(MPI_COMM_WORLD);
+
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+
+    if (rank == 0) printf("Starting DALEC taskpool test with %d processes\n", nproc);
+
+    {
+        const long ntasks = 10007;
+        DALEC_Taskpool tp;
+        DALEC_Taskpool_create(MPI_COMM_WORLD, ntasks, 1, &tp);
+        errors += drain(&tp, ntasks, nproc);
+        DALEC_Taskpool_reset(&tp);
+        errors += drain(&tp, ntasks, nproc);
+        DALEC_Taskpool_destroy(&tp);
+    }
+    {
+        /* fewer tasks than ranks */
+        const long ntasks = 3;
+        DALEC_Taskpool tp;
+        DALEC_Taskpool_create(MPI_COMM_WORLD, ntasks, 4, &tp);
+        errors += drain(&tp, ntasks, nproc);
+        DALEC_Taskpool_destroy(&tp);
+    }
+
+    if (errors) printf("%d: %d errors\n", rank, errors);
+
+    DALEC_Finalize();
+    MPI_Finalize();
+
+    return (errors != 0);
+}
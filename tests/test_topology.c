@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2014. See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <mpi.h>
+#include <dalec.h>
+
+/* Global index of local index l along dimension i. */
+static size_t global(const DALEC_Array_handle * h, int i, size_t l)
+{
+    if (!h->cyclic) return h->local_lo[i] + l;
+    const size_t bs = h->blocksizes[i];
+    return ((l / bs) * h->pedims[i] + h->coords[i]) * bs + l % bs;
+}
+
+/* Store the row-major global index of every element of the local block in
+ * place, or with check set count the elements that do not hold it. */
+static int local_values(const DALEC_Array_handle * h, int check)
+{
+    if (h->coords[0] < 0) return 0;
+
+    const int ndim = h->ndim;
+    size_t n = 1;
+    for (int i=0; i<ndim; i++) n *= h->local_dims[i];
+
+    int errors = 0;
+    double * base = h->base;
+    for (size_t k=0; k<n; k++) {
+        size_t l[DALEC_ARRAY_MAX_DIM], rest = k, off = 0, g = 0;
+        for (int i=ndim-1; i>=0; i--) {
+            l[i] = rest % h->local_dims[i];
+            rest /= h->local_dims[i];
+        }
+        for (int i=0; i<ndim; i++) {
+            off = off * (h->local_dims[i] + 2*h->ghosts[i]) + h->ghosts[i] + l[i];
+            g   = g * h->dims[i] + global(h, i, l[i]);
+        }
+        if (check) {
+            errors += (base[off] != (double)g);
+        } else {
+            base[off] = (double)g;
+        }
+    }
+    return errors;
+}
+
+/* Check that the ranks of each node own a box of nsize blocks, that the
+ * ranks of the array agree with Locate and Distribution, and that the
+ * blocks land where they belong when the array is redistributed to one
+ * without node placement, whose ranks are in another order. */
+static int check(DALEC_Array_descriptor * d, int nsize)
+{
+    int errors = 0, rank, nproc;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+
+    setenv("DALEC_NODE_GRID", "1", 1);
+    DALEC_Array_handle a;
+    DALEC_Create_array(d, &a);
+    unsetenv("DALEC_NODE_GRID");
+
+    const int ndim = a.ndim;
+    int grid_size = 1;
+    for (int i=0; i<ndim; i++) grid_size *= a.pedims[i];
+
+    /* the coordinates of every rank, in the order of the user communicator */
+    int * coords = malloc(nproc * DALEC_ARRAY_MAX_DIM * sizeof(int));
+    MPI_Allgather(a.coords, DALEC_ARRAY_MAX_DIM, MPI_INT, coords, DALEC_ARRAY_MAX_DIM, MPI_INT, MPI_COMM_WORLD);
+    if (grid_size == nproc) {
+        for (int node=0; node<nproc/nsize; node++) {
+            int volume = 1;
+            for (int i=0; i<ndim; i++) {
+                int lo = coords[node*nsize*DALEC_ARRAY_MAX_DIM + i], hi = lo;
+                for (int r=node*nsize; r<(node+1)*nsize; r++) {
+                    const int c = coords[r*DALEC_ARRAY_MAX_DIM + i];
+                    lo = (c < lo) ? c : lo;
+                    hi = (c > hi) ? c : hi;
+                }
+                volume *= hi - lo + 1;
+            }
+            if (volume != nsize) {
+                if (rank == 0) printf("node %d spans %d blocks\n", node, volume);
+                errors++;
+            }
+        }
+    }
+    free(coords);
+
+    int me;
+    MPI_Comm_rank(a.comm, &me);
+    size_t lo[DALEC_ARRAY_MAX_DIM], ext[DALEC_ARRAY_MAX_DIM];
+    DALEC_Distribution(&a, me, lo, ext);
+    size_t n = 1;
+    for (int i=0; i<ndim; i++) {
+        if (lo[i] != a.local_lo[i] || ext[i] != a.local_dims[i]) errors++;
+        n *= ext[i];
+    }
+    if (n > 0) {
+        int owner;
+        DALEC_Locate(&a, lo, &owner, NULL);
+        if (owner != me) errors++;
+    }
+
+    local_values(&a, 0);
+    DALEC_Array_descriptor db = *d;
+    db.name = "test topology b";
+    DALEC_Array_handle b;
+    DALEC_Create_array(&db, &b);
+    DALEC_Redistribute(&a, &b);
+    errors += local_values(&b, 1);
+
+    DALEC_Destroy_array(&a);
+    DALEC_Destroy_array(&b);
+
+    return errors;
+}
+
+int main(int argc, char ** argv)
+{
+    int rank, nproc, errors = 0;
+
+    MPI_Init(&argc, &argv);
+    DALEC_Initialize(MPI_COMM_WORLD);
+
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+
+    if (rank == 0) printf("Starting DALEC node placement test with %d processes\n", nproc);
+
+    /* pretend that nodes have two or three ranks */
+    int nsize = (nproc % 2 == 0 && nproc > 2) ? 2 : (nproc % 3 == 0 && nproc > 3) ? 3 : 1;
+    char nranks[16];
+    snprintf(nranks, sizeof(nranks), "%d", nsize);
+    setenv("DALEC_NODE_RANKS", nranks, 1);
+
+    DALEC_Array_descriptor d2 = { .comm = MPI_COMM_WORLD, .type = MPI_DOUBLE, .ndim = 2, .dims = {24, 18},
+                                  .ghosts = {1, 1}, .periodic = {1, 0}, .name = "test topology 2d" };
+    errors += check(&d2, nsize);
+
+    DALEC_Array_descriptor d3 = { .comm = MPI_COMM_WORLD, .type = MPI_DOUBLE, .ndim = 3, .dims = {8, 6, 10},
+                                  .name = "test topology 3d" };
+    errors += check(&d3, nsize);
+
+    DALEC_Array_descriptor dc = { .comm = MPI_COMM_WORLD, .type = MPI_DOUBLE, .ndim = 2, .dims = {15, 13},
+                                  .blks = {2, 3}, .cyclic = 1, .name = "test topology cyclic" };
+    errors += check(&dc, nsize);
+
+    if (errors) printf("%d: %d errors\n", rank, errors);
+
+    DALEC_Finalize();
+    MPI_Finalize();
+
+    return (errors != 0);
+}